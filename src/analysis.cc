@@ -0,0 +1,134 @@
+
+#include "analysis.h"
+#include <algorithm>
+
+//
+// analysis -- longest paths and levels in topological order
+//
+// Tasks are visited in Kahn order: a task is visited once all of its
+// dependencies have been.  Its longest path to a finish is its execution
+// time plus the longest of its dependencies', and its level is one more
+// than the deepest of its dependencies'.  The critical path is recovered
+// by following the dependency that set each task's longest path back from
+// the task that finishes last.
+//
+analysis::analysis(const sim_model& model)
+    : _critical_length(0)
+{
+    typedef sim_model::index_t index_t;
+    const std::vector<uint64_t>& ticks(model.execution_times());
+    index_t n(model.task_count());
+
+    std::vector<uint64_t> finish(n, 0);
+    std::vector<index_t> level(n, 0);
+    std::vector<index_t> pred(n, sim_model::none);
+    std::vector<index_t> deps_left(n);
+    std::vector<index_t> ready;
+    ready.reserve(n);
+    for (index_t ix(0); ix < n; ++ix) {
+        deps_left[ix] = model.dependencies_end(ix) - model.dependencies_begin(ix);
+        if (deps_left[ix] == 0) {
+            ready.push_back(ix);
+        }
+    }
+
+    index_t last(sim_model::none);
+    for (uint64_t next(0); next < ready.size(); ++next) {
+        index_t t(ready[next]);
+        for (const index_t* dep(model.dependencies_begin(t));
+                dep != model.dependencies_end(t);
+                ++dep) {
+            if (pred[t] == sim_model::none || finish[*dep] > finish[pred[t]]) {
+                pred[t] = *dep;
+            }
+            level[t] = std::max(level[t], level[*dep] + 1);
+        }
+        finish[t] = ticks[t] + (pred[t] == sim_model::none ? 0 : finish[pred[t]]);
+        if (last == sim_model::none || finish[t] > finish[last]) {
+            last = t;
+        }
+
+        if (_level_width.size() <= level[t]) {
+            _level_width.resize(level[t] + 1, 0);
+        }
+        ++_level_width[level[t]];
+
+        for (const index_t* w(model.waiters_begin(t)); w != model.waiters_end(t); ++w) {
+            if (--deps_left[*w] == 0) {
+                ready.push_back(*w);
+            }
+        }
+    }
+
+    if (last != sim_model::none) {
+        _critical_length = finish[last];
+        for (index_t t(last); t != sim_model::none; t = pred[t]) {
+            _critical_path.push_back(t);
+        }
+        std::reverse(_critical_path.begin(), _critical_path.end());
+    }
+}
+
+uint64_t
+analysis::get_critical_length() const
+{
+    return _critical_length;
+}
+
+const std::vector<sim_model::index_t>&
+analysis::get_critical_path() const
+{
+    return _critical_path;
+}
+
+const std::vector<uint64_t>&
+analysis::get_level_widths() const
+{
+    return _level_width;
+}
+
+//
+// cores_in_use -- core ticks per time bucket
+//
+// A task adds its cores times its overlap to the buckets at either end of
+// its run.  The buckets it covers completely get the same amount each, so
+// they are added as a difference, summed up at the end.  There may be
+// fewer buckets than asked for, so that none starts after the makespan.
+//
+std::vector<uint64_t>
+analysis::cores_in_use(const task::list& tasks, uint64_t makespan,
+        uint64_t buckets, uint64_t* width)
+{
+    *width = std::max<uint64_t>(1, (makespan + buckets - 1) / std::max<uint64_t>(1, buckets));
+    // rounding the width up can leave trailing buckets past the makespan
+    buckets = std::min(buckets, (makespan + *width - 1) / *width);
+    std::vector<uint64_t> used(buckets, 0);
+    if (buckets == 0) {
+        return used;
+    }
+    std::vector<int64_t> full(buckets + 1, 0);
+    for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+        uint64_t start((*itr)->get_start_tick());
+        uint64_t finish((*itr)->get_finish_tick());
+        if (finish <= start) {
+            continue;
+        }
+        uint64_t cores((*itr)->get_cores_required());
+        uint64_t first(std::min(start / *width, buckets - 1));
+        uint64_t last(std::min((finish - 1) / *width, buckets - 1));
+        if (first == last) {
+            used[first] += cores * (finish - start);
+            continue;
+        }
+        used[first] += cores * ((first + 1) * *width - start);
+        used[last] += cores * (finish - last * *width);
+        full[first + 1] += cores * *width;
+        full[last] -= cores * *width;
+    }
+    int64_t running(0);
+    for (uint64_t bx(0); bx < buckets; ++bx) {
+        running += full[bx];
+        used[bx] += running;
+    }
+    return used;
+}
@@ -0,0 +1,81 @@
+
+#ifndef _analysis_h_
+#define _analysis_h_
+
+#include "sim.h"
+#include "task.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class analysis
+ *
+ * Shape of a task graph and of a plan for it: the critical path, how many
+ * tasks each topological level holds, and how many cores the plan keeps
+ * busy over time.
+ *
+ * Everything is computed in one pass over the flat arrays of a sim_model,
+ * in time linear in the number of tasks and dependencies.  The time series
+ * has a fixed number of buckets, however long the plan.
+ */
+class analysis
+{
+public:
+    /*
+     * analysis
+     *
+     * Finds the critical path and the level widths of the model's graph.
+     *
+     * @param[in]  model  validated task graph
+     */
+    analysis(const sim_model& model);
+
+    /*
+     * get_critical_length
+     *
+     * @return ticks of the longest chain of dependent tasks at their
+     *         execution times, a lower bound on any plan's makespan
+     */
+    uint64_t get_critical_length() const;
+
+    /*
+     * get_critical_path
+     *
+     * @return indexes of the tasks on the critical path, first task first
+     */
+    const std::vector<sim_model::index_t>& get_critical_path() const;
+
+    /*
+     * get_level_widths
+     *
+     * A task's level is the length of the longest chain of dependencies
+     * leading to it; tasks without dependencies are on level 0.  Tasks on
+     * the same level never depend on each other.
+     *
+     * @return number of tasks on each level
+     */
+    const std::vector<uint64_t>& get_level_widths() const;
+
+    /*
+     * cores_in_use
+     *
+     * Adds up the cores a plan keeps busy into equal time buckets.  The
+     * width is rounded up, so there may be fewer buckets than asked for.
+     *
+     * @param[in]  tasks     planned tasks, with start and finish ticks
+     * @param[in]  makespan  ticks the plan takes
+     * @param[in]  buckets   most buckets
+     * @param[out] width     ticks per bucket
+     *
+     * @return core ticks used in each bucket
+     */
+    static std::vector<uint64_t> cores_in_use(const task::list& tasks,
+            uint64_t makespan, uint64_t buckets, uint64_t* width);
+
+private:
+    uint64_t _critical_length;
+    std::vector<sim_model::index_t> _critical_path;
+    std::vector<uint64_t> _level_width;
+};
+
+#endif // _analysis_h_
@@ -0,0 +1,698 @@
+#include "branch_bound.h"
+#include "parallel.h"
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <time.h>
+
+namespace {
+    typedef sim_model::index_t index_t;
+
+    // subtrees per thread to share out, so a thread that finishes early
+    // has more to take
+    const uint64_t subtrees_per_thread = 16;
+    // branches between looks at the clock, the limits and the best makespan
+    const uint64_t check_interval = 256;
+
+    // longest path to the end first; stable, so ties keep topological order
+    class longer_tail {
+    public:
+        longer_tail(const std::vector<uint64_t>& tail)
+            : _tail(tail)
+        {
+        }
+        bool operator()(index_t lt, index_t rt) const
+        {
+            return _tail[lt] > _tail[rt];
+        }
+    private:
+        const std::vector<uint64_t>& _tail;
+    };
+
+    double
+    now_seconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+}
+
+// a task to place next, where and when, and the bound of the plans below;
+// the earliest start comes first, then the task first in priority, then
+// the node it finishes on first
+struct branch_bound::_branch {
+    uint64_t start;
+    index_t priority;
+    uint64_t finish;
+    index_t node;
+    index_t task;
+    uint64_t bound;
+
+    bool operator<(const _branch& rhs) const
+    {
+        if (start != rhs.start) {
+            return start < rhs.start;
+        }
+        if (priority != rhs.priority) {
+            return priority < rhs.priority;
+        }
+        if (finish != rhs.finish) {
+            return finish < rhs.finish;
+        }
+        return node < rhs.node;
+    }
+};
+
+// the cores and resources free on a node from a tick to the next segment
+struct branch_bound::_segment {
+    uint64_t begin;
+    int64_t cores;
+    resource_set res;
+
+    // for lower_bound to find the first segment starting after a tick
+    bool operator<(uint64_t tick) const
+    {
+        return begin <= tick;
+    }
+};
+
+// the tasks placed so far by one thread
+struct branch_bound::_state {
+    std::vector<char> placed;
+    std::vector<index_t> deps_left;     // unplaced dependencies
+    std::vector<uint64_t> start;
+    std::vector<uint64_t> finish;
+    std::vector<index_t> node;
+    std::vector<std::vector<index_t> > on_node; // tasks placed on each node
+    std::vector<std::vector<_segment> > profile; // free cores over time on each node
+    std::vector<index_t> path;          // tasks in placement order
+    std::vector<uint64_t> makespan;     // after each placement
+    uint64_t work_left;                 // core ticks of the unplaced tasks, at best
+    std::vector<uint64_t> head;         // earliest start of unplaced tasks, for _bound
+    std::vector<index_t> tried_by;      // last task to try an empty node of a kind
+};
+
+// the search shared by the threads, under lock
+struct branch_bound::_shared {
+    boost::mutex lock;
+    double stop_at;                     // 0 for no time limit
+    uint64_t max_branches;              // 0 for no limit
+    std::vector<std::vector<_branch> > subtrees;    // placements leading to each
+    std::vector<uint64_t> subtree_bound;
+    uint64_t next_subtree;
+    uint64_t best;
+    std::vector<index_t> best_rank;
+    std::vector<index_t> best_node;
+    std::vector<uint64_t> best_start;
+    uint64_t branches;
+    uint64_t granted;                   // branches threads may search before sharing
+    ending end;
+    uint64_t open_bound;                // least bound of the branches left unsearched
+};
+
+branch_bound::branch_bound(const sim_model& model)
+    : _model(model), _total_cores(0)
+{
+    index_t n(model.task_count());
+    index_t nodes(model.node_count());
+
+    // nodes that can host each task and its shortest execution time
+    _host_begin.reserve(n + 1);
+    _min_ticks.resize(n, UINT64_MAX);
+    for (index_t ix(0); ix < n; ++ix) {
+        _host_begin.push_back(_hosts.size());
+        for (index_t node(0); node < nodes; ++node) {
+            if (model.can_host(ix, node)) {
+                _hosts.push_back(node);
+                _min_ticks[ix] = std::min(_min_ticks[ix], model.ticks_on(ix, node));
+            }
+        }
+    }
+    _host_begin.push_back(_hosts.size());
+
+    // topological order, then the longest path from each task to the end
+    std::vector<index_t> left(n);
+    _topo.reserve(n);
+    for (index_t ix(0); ix < n; ++ix) {
+        left[ix] = model.dependencies_end(ix) - model.dependencies_begin(ix);
+        if (left[ix] == 0) {
+            _topo.push_back(ix);
+        }
+    }
+    for (index_t head(0); head < _topo.size(); ++head) {
+        for (const index_t* w(model.waiters_begin(_topo[head]));
+                w != model.waiters_end(_topo[head]);
+                ++w) {
+            if (--left[*w] == 0) {
+                _topo.push_back(*w);
+            }
+        }
+    }
+    _tail.resize(n);
+    for (index_t pos(n); pos-- > 0; ) {
+        index_t t(_topo[pos]);
+        uint64_t after(0);
+        for (const index_t* w(model.waiters_begin(t)); w != model.waiters_end(t); ++w) {
+            after = std::max(after, _tail[*w]);
+        }
+        _tail[t] = _min_ticks[t] + after;
+    }
+    std::vector<index_t> by_priority(_topo);
+    std::stable_sort(by_priority.begin(), by_priority.end(), longer_tail(_tail));
+    _priority.resize(n);
+    for (index_t pos(0); pos < n; ++pos) {
+        _priority[by_priority[pos]] = pos;
+    }
+
+    // nodes with the same cores, speed and resources
+    _twin.resize(nodes);
+    for (index_t node(0); node < nodes; ++node) {
+        _twin[node] = node;
+        for (index_t other(0); other < node; ++other) {
+            if (model.node_cores(other) == model.node_cores(node) &&
+                    model.node_speed(other) == model.node_speed(node) &&
+                    (!model.has_resources() ||
+                     (model.node_resources(other).fits(model.node_resources(node)) &&
+                      model.node_resources(node).fits(model.node_resources(other))))) {
+                _twin[node] = other;
+                break;
+            }
+        }
+        _total_cores += model.node_cores(node);
+    }
+}
+
+//
+// run -- split the tree into subtrees and search them on several threads
+//
+// 1. expand the tree breadth first until there are enough subtrees to
+//    share out, or it is searched
+// 2. threads take the subtrees in the order a depth first search reaches
+//    them, so the first plans found are the ones it would find first
+// 3. if a limit stopped the search, the least bound of the branches left
+//    unsearched is the proven bound
+//
+branch_bound::result
+branch_bound::run(uint64_t initial, double seconds, uint64_t max_branches,
+        unsigned threads) const
+{
+    index_t n(_model.task_count());
+    _shared sh;
+    sh.stop_at = seconds > 0 ? now_seconds() + seconds : 0;
+    sh.max_branches = max_branches;
+    sh.next_subtree = 0;
+    sh.best = initial;
+    sh.branches = 0;
+    sh.granted = 0;
+    sh.end = searched;
+    sh.open_bound = UINT64_MAX;
+
+    _state st;
+    _reset(&st);
+    uint64_t root(n ? _bound(&st) : 0);
+
+    // 1. split; a subtree is the placements leading to it
+    std::deque<std::vector<_branch> > open;
+    if (n && root < sh.best) {
+        open.push_back(std::vector<_branch>());
+    }
+    std::vector<_branch> children;
+    while (!open.empty() && open.size() < static_cast<uint64_t>(threads) * subtrees_per_thread &&
+            !_out_of_time(&sh) && !(sh.max_branches && sh.branches >= sh.max_branches)) {
+        std::vector<_branch> path(open.front());
+        open.pop_front();
+        for (std::vector<_branch>::iterator itr(path.begin()); itr != path.end(); ++itr) {
+            _place(&st, itr->task, itr->node, itr->start);
+        }
+        uint64_t bound(std::max(path.empty() ? root : path.back().bound, _bound(&st)));
+        children.clear();
+        if (bound < sh.best) {
+            _branches(&st, sh.best, bound, &children);
+        }
+        ++sh.branches;
+        for (std::vector<_branch>::iterator itr(children.begin()); itr != children.end(); ++itr) {
+            if (path.size() + 1 == n) {
+                _place(&st, itr->task, itr->node, itr->start);
+                _record(&sh, st);
+                _unplace(&st);
+                continue;
+            }
+            open.push_back(path);
+            open.back().push_back(*itr);
+        }
+        while (!st.path.empty()) {
+            _unplace(&st);
+        }
+    }
+
+    // 2. search in depth first order, which is the order of the paths
+    sh.subtrees.assign(open.begin(), open.end());
+    std::sort(sh.subtrees.begin(), sh.subtrees.end());
+    for (uint64_t ix(0); ix < sh.subtrees.size(); ++ix) {
+        sh.subtree_bound.push_back(sh.subtrees[ix].empty() ? root :
+                sh.subtrees[ix].back().bound);
+    }
+    if (!sh.subtrees.empty()) {
+        parallel::parallel_for(threads, threads,
+                boost::bind(&branch_bound::_search, this, _1, _2, &sh));
+    }
+
+    // 3. bound the plans not searched
+    for (uint64_t ix(sh.next_subtree); ix < sh.subtrees.size(); ++ix) {
+        sh.open_bound = std::min(sh.open_bound, sh.subtree_bound[ix]);
+    }
+
+    result res;
+    res.initial = initial;
+    res.makespan = sh.best;
+    res.lower_bound = std::min(sh.best, std::max(root, sh.open_bound));
+    res.found = sh.best < initial;
+    res.end = sh.end;
+    res.rank.swap(sh.best_rank);
+    res.node.swap(sh.best_node);
+    res.start.swap(sh.best_start);
+    res.branches = sh.branches;
+    return res;
+}
+
+void
+branch_bound::_reset(_state* st) const
+{
+    index_t n(_model.task_count());
+    st->placed.assign(n, 0);
+    st->deps_left.resize(n);
+    st->work_left = 0;
+    for (index_t ix(0); ix < n; ++ix) {
+        st->deps_left[ix] = _model.dependencies_end(ix) - _model.dependencies_begin(ix);
+        st->work_left += _model.cores_required(ix) * _min_ticks[ix];
+    }
+    st->start.assign(n, 0);
+    st->finish.assign(n, 0);
+    st->node.assign(n, sim_model::none);
+    st->on_node.assign(_model.node_count(), std::vector<index_t>());
+    st->profile.assign(_model.node_count(), std::vector<_segment>());
+    st->path.clear();
+    st->makespan.clear();
+    st->head.assign(n, 0);
+    st->tried_by.assign(_model.node_count(), sim_model::none);
+}
+
+void
+branch_bound::_place(_state* st, index_t t, index_t node, uint64_t start) const
+{
+    st->placed[t] = 1;
+    st->start[t] = start;
+    st->finish[t] = start + _model.ticks_on(t, node);
+    st->node[t] = node;
+    st->on_node[node].push_back(t);
+    for (const index_t* w(_model.waiters_begin(t)); w != _model.waiters_end(t); ++w) {
+        --st->deps_left[*w];
+    }
+    st->work_left -= _model.cores_required(t) * _min_ticks[t];
+    st->makespan.push_back(std::max(st->makespan.empty() ? 0 : st->makespan.back(),
+                st->finish[t]));
+    st->path.push_back(t);
+}
+
+void
+branch_bound::_unplace(_state* st) const
+{
+    index_t t(st->path.back());
+    st->path.pop_back();
+    st->makespan.pop_back();
+    st->work_left += _model.cores_required(t) * _min_ticks[t];
+    for (const index_t* w(_model.waiters_begin(t)); w != _model.waiters_end(t); ++w) {
+        ++st->deps_left[*w];
+    }
+    st->on_node[st->node[t]].pop_back();
+    st->node[t] = sim_model::none;
+    st->placed[t] = 0;
+}
+
+//
+// _profile -- the free cores and resources of a node over time
+//
+// A segment starts wherever a task placed on the node starts or finishes;
+// the last one starts when the node becomes empty.
+//
+void
+branch_bound::_profile(_state* st, index_t node) const
+{
+    std::vector<_segment>& prof(st->profile[node]);
+    const std::vector<index_t>& there(st->on_node[node]);
+    std::vector<uint64_t> at;
+    for (std::vector<index_t>::const_iterator itr(there.begin()); itr != there.end(); ++itr) {
+        at.push_back(st->start[*itr]);
+        at.push_back(st->finish[*itr]);
+    }
+    std::sort(at.begin(), at.end());
+    at.erase(std::unique(at.begin(), at.end()), at.end());
+
+    bool res(_model.has_resources());
+    prof.resize(at.size());
+    for (index_t ix(0); ix < at.size(); ++ix) {
+        _segment& seg(prof[ix]);
+        seg.begin = at[ix];
+        seg.cores = _model.node_cores(node);
+        if (res) {
+            seg.res = _model.node_resources(node);
+        }
+        for (std::vector<index_t>::const_iterator itr(there.begin());
+                itr != there.end();
+                ++itr) {
+            if (st->start[*itr] <= at[ix] && at[ix] < st->finish[*itr]) {
+                seg.cores -= _model.cores_required(*itr);
+                if (res) {
+                    seg.res -= _model.task_resources(*itr);
+                }
+            }
+        }
+    }
+}
+
+//
+// _earliest -- first tick a task can run on a node among those placed
+//
+// From when its dependencies finish, move the start past every segment of
+// the node's profile that the task would overlap and not fit in.  The
+// last segment is empty, so the task fits there at the latest.
+//
+uint64_t
+branch_bound::_earliest(const _state& st, index_t t, index_t node) const
+{
+    uint64_t start(0);
+    for (const index_t* d(_model.dependencies_begin(t)); d != _model.dependencies_end(t); ++d) {
+        start = std::max(start, st.finish[*d]);
+    }
+    const std::vector<_segment>& prof(st.profile[node]);
+    uint64_t ticks(_model.ticks_on(t, node));
+    int64_t cores(_model.cores_required(t));
+    bool res(_model.has_resources());
+    if (ticks == 0) {
+        return start;
+    }
+
+    std::vector<_segment>::const_iterator seg(
+            std::lower_bound(prof.begin(), prof.end(), start));
+    if (seg != prof.begin()) {
+        --seg;
+    }
+    for (; seg != prof.end() && seg->begin < start + ticks; ++seg) {
+        if (seg->cores < cores || (res && !_model.task_resources(t).fits(seg->res))) {
+            start = (seg + 1)->begin;
+        }
+    }
+    return start;
+}
+
+//
+// _bound -- least makespan of any plan that places the rest after these
+//
+// The tasks left start no earlier than the last one placed, so the plan
+// takes at least
+// 1. the longest path through the tasks left, at their best speeds
+// 2. the work left plus the work of placed tasks still running, spread
+//    over every core
+// from there, and no less than the tasks already placed.
+//
+uint64_t
+branch_bound::_bound(_state* st) const
+{
+    uint64_t from(st->path.empty() ? 0 : st->start[st->path.back()]);
+    uint64_t bound(st->makespan.empty() ? 0 : st->makespan.back());
+
+    // 1. longest path
+    for (std::vector<index_t>::const_iterator itr(_topo.begin()); itr != _topo.end(); ++itr) {
+        index_t t(*itr);
+        if (st->placed[t]) {
+            continue;
+        }
+        uint64_t head(from);
+        for (const index_t* d(_model.dependencies_begin(t));
+                d != _model.dependencies_end(t);
+                ++d) {
+            head = std::max(head, st->placed[*d] ? st->finish[*d] :
+                    st->head[*d] + _min_ticks[*d]);
+        }
+        st->head[t] = head;
+        bound = std::max(bound, head + _tail[t]);
+    }
+
+    // 2. work
+    uint64_t work(st->work_left);
+    for (std::vector<index_t>::const_iterator itr(st->path.begin());
+            itr != st->path.end();
+            ++itr) {
+        if (st->finish[*itr] > from) {
+            work += _model.cores_required(*itr) * (st->finish[*itr] - from);
+        }
+    }
+    if (_total_cores) {
+        bound = std::max(bound, from + (work + _total_cores - 1) / _total_cores);
+    }
+    return bound;
+}
+
+//
+// _branches -- the placements that may lead below the best makespan
+//
+// 1. for each task whose dependencies are placed and each node that can
+//    host it, trying only the first of identical empty nodes,
+// 2. find the earliest start, and skip the placement if it would come
+//    before the last one in start order
+// 3. bound the plans below it by the bound of the plans here and by the
+//    path from the task, and keep it if the bound beats the best; the full
+//    bound is left until the search takes the branch
+// 4. earliest start first
+//
+void
+branch_bound::_branches(_state* st, uint64_t best, uint64_t bound,
+        std::vector<_branch>* out) const
+{
+    out->clear();
+    for (index_t node(0); node < _model.node_count(); ++node) {
+        _profile(st, node);
+    }
+    index_t last(st->path.empty() ? sim_model::none : st->path.back());
+    for (index_t t(0); t < _model.task_count(); ++t) {
+        if (st->placed[t] || st->deps_left[t]) {
+            continue;
+        }
+        for (index_t h(_host_begin[t]); h < _host_begin[t + 1]; ++h) {
+            // 1. nodes
+            index_t node(_hosts[h]);
+            if (st->on_node[node].empty()) {
+                if (st->tried_by[_twin[node]] == t) {
+                    continue;
+                }
+                st->tried_by[_twin[node]] = t;
+            }
+
+            // 2. start
+            uint64_t start(_earliest(*st, t, node));
+            if (last != sim_model::none && (start < st->start[last] ||
+                        (start == st->start[last] && _priority[t] < _priority[last]))) {
+                continue;
+            }
+
+            // 3. bound
+            _branch b;
+            b.start = start;
+            b.priority = _priority[t];
+            b.finish = start + _model.ticks_on(t, node);
+            b.node = node;
+            b.task = t;
+            b.bound = std::max(bound, b.finish + _tail[t] - _min_ticks[t]);
+            if (b.bound < best) {
+                out->push_back(b);
+            }
+        }
+    }
+    std::fill(st->tried_by.begin(), st->tried_by.end(), sim_model::none);
+
+    // 4. order
+    std::sort(out->begin(), out->end());
+}
+
+// _record -- keep a complete plan if it is the shortest yet
+void
+branch_bound::_record(_shared* sh, const _state& st) const
+{
+    boost::mutex::scoped_lock lock(sh->lock);
+    if (st.makespan.back() >= sh->best) {
+        return;
+    }
+    sh->best = st.makespan.back();
+    sh->best_rank.resize(st.path.size());
+    for (index_t pos(0); pos < st.path.size(); ++pos) {
+        sh->best_rank[st.path[pos]] = pos;
+    }
+    sh->best_node = st.node;
+    sh->best_start = st.start;
+}
+
+//
+// _share -- add a thread's branches to the count, under lock
+//
+// A thread gives back what is left of its last grant, so the grants never
+// add up to more than the branches left under the limit, and the threads
+// together never search more than the limit.  Once nothing is left to
+// grant the search stops, with at most the other threads' grants unused.
+//
+// @return branches the thread may search before sharing again, 0 if the
+//         branch limit is reached
+//
+uint64_t
+branch_bound::_share(_shared* sh, uint64_t* count, uint64_t allowed) const
+{
+    sh->branches += *count;
+    sh->granted -= allowed;
+    *count = 0;
+    if (!sh->max_branches) {
+        return check_interval;
+    }
+    uint64_t left(sh->max_branches - std::min(sh->max_branches, sh->branches + sh->granted));
+    if (left == 0) {
+        if (sh->end == searched) {
+            sh->end = node_limit;
+        }
+        return 0;
+    }
+    uint64_t grant(std::min(check_interval, left));
+    sh->granted += grant;
+    return grant;
+}
+
+// _out_of_time -- stop the search if the time limit passed
+bool
+branch_bound::_out_of_time(_shared* sh) const
+{
+    if (!sh->stop_at || now_seconds() < sh->stop_at) {
+        return false;
+    }
+    boost::mutex::scoped_lock lock(sh->lock);
+    if (sh->end == searched) {
+        sh->end = time_limit;
+    }
+    return true;
+}
+
+//
+// _search -- search subtrees depth first until none are left, one thread
+//
+// 1. take the next subtree and place the tasks leading to it
+// 2. descend into the next branch whose bound is below the best makespan,
+//    recording complete plans, and back up when none is left
+// 3. when the grant of branches is used up, share the count, pick up the
+//    best makespan found by other threads and take a new grant under the
+//    branch limit; check the time limit at every branch, as one may take
+//    long on a big graph
+// 4. at a limit, leave the least bound of the branches not searched
+//
+void
+branch_bound::_search(uint64_t, uint64_t, _shared* sh) const
+{
+    index_t n(_model.task_count());
+    _state st;
+    _reset(&st);
+    std::vector<std::vector<_branch> > level(n + 1);
+    std::vector<uint64_t> next(n + 1);
+    uint64_t count(0);
+    uint64_t allowed(0);
+    uint64_t best;
+    for (;;) {
+        // 1. take a subtree
+        uint64_t subtree;
+        {
+            boost::mutex::scoped_lock lock(sh->lock);
+            if (sh->next_subtree == sh->subtrees.size()) {
+                sh->branches += count;
+                sh->granted -= allowed;
+                return;
+            }
+            allowed = _share(sh, &count, allowed);
+            if (sh->end != searched) {
+                sh->granted -= allowed;
+                return;
+            }
+            subtree = sh->next_subtree++;
+            best = sh->best;
+        }
+        if (sh->subtree_bound[subtree] >= best) {
+            continue;
+        }
+        const std::vector<_branch>& path(sh->subtrees[subtree]);
+        for (std::vector<_branch>::const_iterator itr(path.begin()); itr != path.end(); ++itr) {
+            _place(&st, itr->task, itr->node, itr->start);
+        }
+
+        // 2. depth first
+        uint64_t depth(0);
+        uint64_t bound(std::max(sh->subtree_bound[subtree], _bound(&st)));
+        level[0].clear();
+        if (bound < best) {
+            _branches(&st, best, bound, &level[0]);
+        }
+        next[0] = 0;
+        bool stopped(false);
+        for (;;) {
+            if (next[depth] == level[depth].size()) {
+                if (depth == 0) {
+                    break;
+                }
+                --depth;
+                _unplace(&st);
+                continue;
+            }
+
+            // 3. share and check
+            if (count == allowed) {
+                boost::mutex::scoped_lock lock(sh->lock);
+                allowed = _share(sh, &count, allowed);
+                best = sh->best;
+                stopped = sh->end != searched;
+            }
+            if (stopped || _out_of_time(sh)) {
+                stopped = true;
+                break;
+            }
+
+            const _branch& b(level[depth][next[depth]++]);
+            if (b.bound >= best) {
+                continue;
+            }
+            ++count;
+            _place(&st, b.task, b.node, b.start);
+            if (st.path.size() == n) {
+                _record(sh, st);
+                best = std::min(best, st.makespan.back());
+                _unplace(&st);
+                continue;
+            }
+            bound = std::max(b.bound, _bound(&st));
+            if (bound >= best) {
+                _unplace(&st);
+                continue;
+            }
+            ++depth;
+            _branches(&st, best, bound, &level[depth]);
+            next[depth] = 0;
+        }
+
+        // 4. bound what is left
+        if (stopped) {
+            uint64_t left(UINT64_MAX);
+            for (uint64_t d(0); d <= depth; ++d) {
+                for (uint64_t ix(next[d]); ix < level[d].size(); ++ix) {
+                    left = std::min(left, level[d][ix].bound);
+                }
+            }
+            boost::mutex::scoped_lock lock(sh->lock);
+            sh->open_bound = std::min(sh->open_bound, left);
+        }
+        while (!st.path.empty()) {
+            _unplace(&st);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef _branch_bound_h_
+#define _branch_bound_h_
+
+#include "sim.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class branch_bound
+ *
+ * Searches for a plan of least makespan by branch and bound.  A branch
+ * places one more task, on one node, at the earliest tick the task's
+ * dependencies and the node's cores and resources allow, after the tasks
+ * placed before it (a serial list schedule).  Tasks are placed in order of
+ * start tick, ties in priority order, which still reaches every plan that
+ * can't start a task earlier without moving another, and so an optimal
+ * plan, while reaching each of them only once.  The priority is the
+ * longest path to the end, as in critical path list scheduling, and the
+ * search tries the earliest start first, so its first plan is the one
+ * such a scheduler would make.
+ *
+ * A branch is pruned when a lower bound on the makespan of every plan
+ * below it reaches the best makespan found: the longest path of the
+ * unplaced tasks from the start tick of the last one placed, or the work
+ * left spread over every core of the pool.  Identical nodes that are
+ * still empty are interchangeable, so a task only tries the first.
+ *
+ * The tree is split into subtrees that threads take in turn.  The search
+ * stops at a time or branch limit and then returns the best plan found and
+ * the least bound of the branches it didn't search, so the bound is
+ * proven either way.
+ */
+class branch_bound
+{
+public:
+    typedef sim_model::index_t index_t;
+
+    enum ending {
+        searched,       // every branch searched or pruned, the best is optimal
+        node_limit,
+        time_limit
+    };
+
+    /*
+     * @struct _result
+     *
+     * The best plan found, as a node and start tick per task, and the
+     * bound proven for the optimum.
+     */
+    struct _result {
+        uint64_t initial;       // makespan to beat
+        uint64_t makespan;      // makespan of the best plan, initial if none beat it
+        uint64_t lower_bound;   // no plan is shorter
+        bool found;             // a plan shorter than initial was found
+        ending end;
+        std::vector<index_t> rank;      // placement order of the best plan
+        std::vector<index_t> node;
+        std::vector<uint64_t> start;
+        uint64_t branches;      // branches searched, over all threads
+    };
+    typedef _result result;
+
+    /*
+     * branch_bound
+     *
+     * @param[in]  model  simulation model of the validated tasks
+     */
+    branch_bound(const sim_model& model);
+
+    /*
+     * run
+     *
+     * @param[in]  initial     makespan of a known plan; only shorter plans are
+     *                         searched for
+     * @param[in]  seconds     time limit, 0 for none
+     * @param[in]  max_branches  branch limit, 0 for none
+     * @param[in]  threads     number of threads to search on
+     *
+     * @return the best plan found and the proven lower bound
+     */
+    result run(uint64_t initial, double seconds, uint64_t max_branches,
+            unsigned threads) const;
+
+private:
+    struct _shared;
+    struct _state;
+    struct _branch;
+    struct _segment;
+
+    void _reset(_state* st) const;
+    void _place(_state* st, index_t t, index_t node, uint64_t start) const;
+    void _unplace(_state* st) const;
+    void _profile(_state* st, index_t node) const;
+    uint64_t _earliest(const _state& st, index_t t, index_t node) const;
+    uint64_t _bound(_state* st) const;
+    void _branches(_state* st, uint64_t best, uint64_t bound,
+            std::vector<_branch>* out) const;
+    void _record(_shared* sh, const _state& st) const;
+    uint64_t _share(_shared* sh, uint64_t* count, uint64_t allowed) const;
+    bool _out_of_time(_shared* sh) const;
+    void _search(uint64_t begin, uint64_t end, _shared* sh) const;
+
+    const sim_model& _model;
+    std::vector<index_t> _topo;         // a topological order
+    std::vector<index_t> _priority;     // position by longest path, then _topo
+    std::vector<uint64_t> _min_ticks;   // on the fastest node that can host the task
+    std::vector<uint64_t> _tail;        // longest path from the task's start to the end
+    std::vector<index_t> _host_begin;   // CSR offsets into _hosts
+    std::vector<index_t> _hosts;        // nodes that can host each task
+    std::vector<index_t> _twin;         // first node identical to each node
+    uint64_t _total_cores;
+};
+
+#endif // _branch_bound_h_
@@ -1,23 +1,55 @@
 
 #include "compute.h"
+#include "tick_kernel.h"
 #include <yaml.h>
+#include <algorithm>
+#include <assert.h>
 #include <iostream>
 
 compute::compute(const std::string& name, const uint64_t& cores) 
     : _name(name), _cores_total(cores),
-    _cores_available(cores), _cumulative_busy_ticks(0),
+    _cores_available(cores), _speed(task::unit_speed), _cumulative_busy_ticks(0),
     _cumulative_idle_ticks(0), _completed_tasks(0), _state(free), _assign_count(0)
 {
 } 
 
+compute::compute(const std::string& name, const uint64_t& cores,
+        const resource_set& res)
+    : _name(name), _cores_total(cores),
+    _cores_available(cores), _res_total(res), _res_available(res),
+    _speed(task::unit_speed), _cumulative_busy_ticks(0),
+    _cumulative_idle_ticks(0), _completed_tasks(0), _state(free), _assign_count(0)
+{
+}
+
 // assign_task -- take ownership of this task, allocate resources
 void
 compute::assign_task(task* t)
 {
     assert(t->get_state() == task::not_started);
     t->set_state(task::running);
+    t->set_speed(_speed);
     _current_tasks.push_back(t);
+    _current_work.push_back(t->get_work_remaining());
+    _current_cores.push_back(t->get_cores_required());
     _cores_available -= t->get_cores_required();
+    _res_available -= t->get_resources();
+    assert(_cores_available >= 0);
+    ++_assign_count;
+}
+
+void
+compute::assign_part(task* t, uint64_t cores, uint64_t ticks)
+{
+    if (t->get_state() == task::not_started) {
+        t->set_state(task::running);
+        t->set_speed(_speed);
+    }
+    _current_tasks.push_back(t);
+    _current_work.push_back(ticks * _speed);
+    _current_cores.push_back(cores);
+    _cores_available -= cores;
+    _res_available -= t->get_resources();
     assert(_cores_available >= 0);
     ++_assign_count;
 }
@@ -32,60 +64,289 @@ compute::get_assign_count() const
 // tick -- run the tasks associated with this compute resource
 //
 // Since this is a simulation, we run many ticks at once keep
-// the numbers in order.
+// the numbers in order.  Every task on the node does the same
+// amount of work in that time, so all of them advance in one
+// pass over the work and core arrays (see tick_kernel).
 //
-// For each task:
-//    1. "Run" the task
+//    1. "Run" the tasks, counting completions and the cores in use
 //    2. record how time was spent
-//    3. clean up tasks that have completed
+//    3. clean up tasks that have completed, keeping the others in order
 //    4. when done with tasks, check timings for consistency
 //
 int64_t
 compute::tick(uint64_t ticks)
 {
     assert(ticks>0);
-    int64_t cores_used(0);
-    int64_t tasks_completed(0);
-    uint64_t this_run_idle_ticks(0);
-    uint64_t this_run_busy_ticks(0);
-    for (task::ptr_llist::iterator task_itr(_current_tasks.begin());
-                task_itr != _current_tasks.end();
-                ) {
-        // run the task
-        task::tick_stat ts((*task_itr)->run_for(ticks));
-
-        // account for idle time and core use
-        cores_used += (*task_itr)->get_cores_required();
-        this_run_idle_ticks += ts.idle_ticks * (*task_itr)->get_cores_required();
-        this_run_busy_ticks += ts.busy_ticks * (*task_itr)->get_cores_required();
-
-        // task completed:
-        //   put the cores back in service
-        //   remove the task from our current execution list
-        //   increment the completed counter
-        if (ts.remaining_ticks == 0) {
-            task::ptr_llist::iterator rem(task_itr);
-            _cores_available += (*task_itr)->get_cores_required();
-            assert(_cores_available <= _cores_total);
-            ++task_itr;
-            _current_tasks.erase(rem);
-            ++tasks_completed;
-            continue;
+    uint64_t count(_current_tasks.size());
+    tick_kernel::advance_result res = { 0, 0, 0 };
+    if (count) {
+        res = tick_kernel::advance(&_current_work[0], &_current_cores[0], count,
+                static_cast<int64_t>(ticks * _speed));
+    }
+    // other parts of a gang task finish with the part on its own node
+    uint64_t parts_completed(0);
+    for (uint64_t ix(0); ix < count; ++ix) {
+        compute* placed(_current_tasks[ix]->get_compute());
+        if (placed == NULL || placed == this) {
+            _current_tasks[ix]->set_work_remaining(_current_work[ix]);
+        } else if (_current_work[ix] == 0) {
+            ++parts_completed;
+        }
+    }
+
+    // put the cores of completed tasks back in service
+    if (res.completed) {
+        uint64_t kept(0);
+        for (uint64_t ix(0); ix < count; ++ix) {
+            if (_current_work[ix] == 0) {
+                _res_available += _current_tasks[ix]->get_resources();
+                continue;
+            }
+            _current_tasks[kept] = _current_tasks[ix];
+            _current_work[kept] = _current_work[ix];
+            _current_cores[kept] = _current_cores[ix];
+            ++kept;
         }
-        // non-completed task
-        ++task_itr;
+        _current_tasks.resize(kept);
+        _current_work.resize(kept);
+        _current_cores.resize(kept);
+        _cores_available += res.cores_released;
+        assert(_cores_available <= _cores_total);
     }
-    // account for totally idle cores
-    assert(_cores_total >= cores_used);
-    this_run_idle_ticks = (_cores_total - cores_used) * ticks;
+
+    // account for busy and totally idle cores
+    assert(_cores_total >= res.cores_used);
+    uint64_t this_run_busy_ticks(res.cores_used * ticks);
+    uint64_t this_run_idle_ticks((_cores_total - res.cores_used) * ticks);
 
     // verify that no ticks are missing
     assert((_cores_total * ticks) == (this_run_idle_ticks + this_run_busy_ticks));
 
     _cumulative_idle_ticks += this_run_idle_ticks;
     _cumulative_busy_ticks += this_run_busy_ticks;
-    _completed_tasks += tasks_completed;
-    return tasks_completed;
+    _completed_tasks += res.completed - parts_completed;
+    return res.completed - parts_completed;
+}
+
+uint64_t
+compute::get_ticks_to_completion() const
+{
+    if (_current_work.empty()) {
+        return never_fits;
+    }
+    uint64_t work(tick_kernel::min_work(&_current_work[0], _current_work.size()));
+    return (work + _speed - 1) / _speed;
+}
+
+void
+compute::account(uint64_t busy_ticks, uint64_t ticks, uint64_t tasks)
+{
+    assert(busy_ticks <= _cores_total * ticks);
+    _cumulative_busy_ticks += busy_ticks;
+    _cumulative_idle_ticks += _cores_total * ticks - busy_ticks;
+    _assign_count += tasks;
+    _completed_tasks += tasks;
+}
+
+void
+compute::reserve(task* t, uint64_t start)
+{
+    _reservations.insert(std::make_pair(start, t));
+}
+
+void
+compute::clear_reservations()
+{
+    _reservations.clear();
+}
+
+bool
+compute::has_reservations() const
+{
+    return !_reservations.empty();
+}
+
+namespace {
+    // a change in free capacity at some tick
+    struct capacity_event {
+        uint64_t tick;
+        bool release;
+        int64_t cores;
+        const resource_set* res;
+
+        bool operator<(const capacity_event& rhs) const
+        {
+            if (tick == rhs.tick) {
+                return release && !rhs.release;
+            }
+            return tick < rhs.tick;
+        }
+    };
+}
+
+//
+// earliest_start -- walk the node's capacity profile
+//
+// 1. build a list of capacity events: running tasks release their cores when
+//    they finish, reservations hold cores from their start until their end
+// 2. replay the events in time order to find the free capacity at each tick
+//    where it changes
+// 3. the earliest start is the first of those ticks (or now, or not_before,
+//    or the end of a window the node is down) from which the task fits and
+//    the node stays up until it would complete
+//
+uint64_t
+compute::earliest_start(const task* t, uint64_t now, uint64_t not_before) const
+{
+    if (!can_host(t)) {
+        return never_fits;
+    }
+    uint64_t duration(t->get_ticks_at(_speed));
+    if (_reservations.empty() && fits(t)) {
+        // free capacity only grows until the next reservation
+        return next_up(std::max(now, not_before), duration);
+    }
+
+    std::vector<capacity_event> events;
+    for (uint64_t ix(0); ix < _current_tasks.size(); ++ix) {
+        capacity_event ev = {
+            now + (_current_work[ix] + _speed - 1) / _speed, true,
+            _current_cores[ix], &_current_tasks[ix]->get_resources() };
+        events.push_back(ev);
+    }
+    for (reservation_list::const_iterator itr(_reservations.begin());
+            itr != _reservations.end();
+            ++itr) {
+        capacity_event hold = { itr->first, false,
+            static_cast<int64_t>(itr->second->get_cores_required()),
+            &itr->second->get_resources() };
+        capacity_event release = { itr->first + itr->second->get_ticks_at(_speed), true,
+            hold.cores, hold.res };
+        events.push_back(hold);
+        events.push_back(release);
+    }
+    std::sort(events.begin(), events.end());
+
+    // free capacity from each distinct tick onward
+    std::vector<uint64_t> ticks(1, now);
+    std::vector<int64_t> free_cores(1, _cores_available);
+    std::vector<resource_set> free_res(1, _res_available);
+    for (std::vector<capacity_event>::const_iterator ev(events.begin());
+            ev != events.end();
+            ++ev) {
+        if (ev->tick > ticks.back()) {
+            ticks.push_back(ev->tick);
+            free_cores.push_back(free_cores.back());
+            free_res.push_back(free_res.back());
+        }
+        if (ev->release) {
+            free_cores.back() += ev->cores;
+            free_res.back() += *ev->res;
+        } else {
+            free_cores.back() -= ev->cores;
+            free_res.back() -= *ev->res;
+        }
+    }
+
+    for (size_t start(0); start < ticks.size(); ++start) {
+        uint64_t begin(next_up(std::max(ticks[start], not_before), duration));
+        if (start + 1 < ticks.size() && ticks[start + 1] <= begin) {
+            continue;
+        }
+        bool ok(true);
+        for (size_t ix(start);
+                ix < ticks.size() && ticks[ix] < begin + duration;
+                ++ix) {
+            if (static_cast<int64_t>(t->get_cores_required()) > free_cores[ix] ||
+                    !t->get_resources().fits(free_res[ix])) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            return begin;
+        }
+    }
+    // everything has been released by the last event, so this is unreachable
+    assert(false);
+    return never_fits;
+}
+
+void
+compute::add_unavailable(uint64_t start, uint64_t end)
+{
+    assert(start < end);
+    // absorb the windows this one overlaps or touches
+    window_map::iterator itr(_down.upper_bound(start));
+    if (itr != _down.begin()) {
+        window_map::iterator prev(itr);
+        --prev;
+        if (prev->second >= start) {
+            start = prev->first;
+            end = std::max(end, prev->second);
+            itr = prev;
+        }
+    }
+    while (itr != _down.end() && itr->first <= end) {
+        end = std::max(end, itr->second);
+        _down.erase(itr++);
+    }
+    _down[start] = end;
+}
+
+const compute::window_map&
+compute::get_unavailable() const
+{
+    return _down;
+}
+
+bool
+compute::has_unavailable() const
+{
+    return !_down.empty();
+}
+
+//
+// next_up -- skip the windows that overlap [start, start + ticks)
+//
+// Windows are disjoint and sorted, so only the window holding start and
+// those that begin before the task would finish are visited.
+//
+uint64_t
+compute::next_up(uint64_t start, uint64_t ticks) const
+{
+    if (_down.empty()) {
+        return start;
+    }
+    window_map::const_iterator itr(_down.upper_bound(start));
+    if (itr != _down.begin()) {
+        window_map::const_iterator prev(itr);
+        --prev;
+        start = std::max(start, prev->second);
+    }
+    for (; itr != _down.end() && itr->first < start + ticks; ++itr) {
+        start = itr->second;
+    }
+    return start;
+}
+
+void
+compute::reset()
+{
+    for (uint64_t ix(0); ix < _current_tasks.size(); ++ix) {
+        _cores_available += _current_cores[ix];
+        _res_available += _current_tasks[ix]->get_resources();
+    }
+    _current_tasks.clear();
+    _current_work.clear();
+    _current_cores.clear();
+    _reservations.clear();
+    assert(_cores_available == _cores_total);
+    _cumulative_busy_ticks = 0;
+    _cumulative_idle_ticks = 0;
+    _completed_tasks = 0;
+    _state = free;
+    _assign_count = 0;
 }
 
 // getters
@@ -96,18 +357,84 @@ compute::get_name() const
     return _name;
 }
 
+boost::string_view
+compute::name() const
+{
+    return _name;
+}
+
 compute::state
 compute::get_state() const
 {
     return _state;
 }
 
+void
+compute::set_speed(uint32_t speed)
+{
+    assert(speed > 0);
+    _speed = speed;
+}
+
+uint32_t
+compute::get_speed() const
+{
+    return _speed;
+}
+
 int64_t
 compute::get_cores_available() const
 {
     return _cores_available;
 }
 
+const resource_set&
+compute::get_resources() const
+{
+    return _res_total;
+}
+
+const resource_set&
+compute::get_resources_available() const
+{
+    return _res_available;
+}
+
+bool
+compute::fits(const task* t) const
+{
+    return static_cast<int64_t>(t->get_cores_required()) <= _cores_available &&
+        t->get_resources().fits(_res_available);
+}
+
+bool
+compute::can_host(const task* t) const
+{
+    return static_cast<int64_t>(t->get_cores_required()) <= _cores_total &&
+        t->get_resources().fits(_res_total);
+}
+
+double
+compute::residual_share(const task* t) const
+{
+    assert(fits(t));
+    double share(0.0);
+    if (_cores_total) {
+        share = static_cast<double>(_cores_available - t->get_cores_required()) /
+            static_cast<double>(_cores_total);
+    }
+    for (resource_set::dim_t dim(0); dim < resource_set::dimension_count(); ++dim) {
+        uint64_t total(_res_total.get(dim));
+        if (total == 0) {
+            continue;
+        }
+        double free_share = static_cast<double>(_res_available.get(dim) -
+                t->get_resources().get(dim)) / static_cast<double>(total);
+        share = std::max(share, free_share);
+    }
+    return share;
+}
+
 uint64_t
 compute::get_cores() const
 {
@@ -137,7 +464,13 @@ operator<<(std::ostream& os, const compute& comp)
 {
     os << "name: " << comp._name << "; cores: " << comp._cores_available << "/"
         << comp._cores_total << "; state: " << comp._state;
-    for (task::ptr_llist::const_iterator itr(comp._current_tasks.begin());
+    if (comp._speed != task::unit_speed) {
+        os << "; speed: " << static_cast<double>(comp._speed) / task::unit_speed;
+    }
+    if (!comp._res_total.empty()) {
+        os << "; resources: " << comp._res_available << " of " << comp._res_total;
+    }
+    for (task::ptr_list::const_iterator itr(comp._current_tasks.begin());
             itr != comp._current_tasks.end();
             ++itr) {
         os << "\n\t" << *itr;
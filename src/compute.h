@@ -1,9 +1,12 @@
 
 #include <boost/shared_ptr.hpp>
+#include <boost/utility/string_view.hpp>
+#include <map>
 #include <ostream>
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include "resource.h"
 #include "task.h"
 
 #ifndef _compute_h_
@@ -37,6 +40,19 @@ public:
      */
     compute(const std::string& name, const uint64_t& cores);
 
+    /*
+     * compute
+     *
+     * Constructor for a compute node that also provides non-core
+     * resources.
+     *
+     * @param[in]  name  Name of compute resource.
+     * @param[in]  cores  Number of cores present.
+     * @param[in]  res  Non-core resources present (memory, scratch, ...).
+     */
+    compute(const std::string& name, const uint64_t& cores,
+            const resource_set& res);
+
     /* 
      * get_name 
      *
@@ -46,6 +62,13 @@ public:
      */
     std::string get_name() const;
 
+    /*
+     * name
+     *
+     * @return view of the name, valid as long as the compute node
+     */
+    boost::string_view name() const;
+
     /*
      * returns the current state of the compute
      *
@@ -60,6 +83,23 @@ public:
      */
     uint64_t get_cores() const;
 
+    /*
+     * set_speed
+     *
+     * Sets this node's speed factor relative to the nodes that task
+     * execution times were measured on.
+     *
+     * @param[in]  speed  speed factor in thousandths, task::unit_speed is nominal
+     */
+    void set_speed(uint32_t speed);
+
+    /*
+     * get_speed
+     *
+     * @return speed factor in thousandths, task::unit_speed is nominal
+     */
+    uint32_t get_speed() const;
+
     /*
      * get_cores_available
      *
@@ -67,6 +107,51 @@ public:
      */
     int64_t get_cores_available() const;
 
+    /*
+     * get_resources
+     *
+     * @return non-core resources present on this node
+     */
+    const resource_set& get_resources() const;
+
+    /*
+     * get_resources_available
+     *
+     * @return non-core resources currently free
+     */
+    const resource_set& get_resources_available() const;
+
+    /*
+     * fits
+     *
+     * @param[in]  t  task to check
+     *
+     * @return true if the task's cores and resources are free right now
+     */
+    bool fits(const task* t) const;
+
+    /*
+     * can_host
+     *
+     * @param[in]  t  task to check
+     *
+     * @return true if the task fits on this node when the node is idle
+     */
+    bool can_host(const task* t) const;
+
+    /*
+     * residual_share
+     *
+     * Computes the largest fraction of this node's capacity, over cores and
+     * each resource dimension, that would be left free after placing the
+     * task.  Lower values mean a tighter fit.
+     *
+     * @param[in]  t  task to check, must fit on this node
+     *
+     * @return dominant free share after placement, 0.0 - 1.0
+     */
+    double residual_share(const task* t) const;
+
     /*
      * assign_task
      *
@@ -80,6 +165,20 @@ public:
      */
     void assign_task(task* task);
 
+    /*
+     * assign_part
+     *
+     * Assigns this node's part of a gang task that spans several nodes.
+     * The part holds the given cores, and the task's resources, for the
+     * given ticks, so that every part finishes on the same tick.  Only the
+     * node the task was placed on reports progress back to the task.
+     *
+     * @param[in]  task   gang task, running or about to start
+     * @param[in]  cores  cores of this part
+     * @param[in]  ticks  ticks every part of the task runs for
+     */
+    void assign_part(task* task, uint64_t cores, uint64_t ticks);
+
     /*
      * get_assign_count
      *
@@ -92,10 +191,19 @@ public:
      *
      * param[in]  ticks  Run all assigned, tasks for this number of ticks
      *
-     * @return the number of tasks completed during this call
+     * @return the number of tasks placed on this node completed during
+     *         this call; parts of gang tasks placed elsewhere don't count
      */
     int64_t tick(uint64_t ticks = 1);
 
+    /*
+     * get_ticks_to_completion
+     *
+     * @return ticks until the first running task completes, never_fits if
+     *         no tasks are running
+     */
+    uint64_t get_ticks_to_completion() const;
+
     /*
      * get_busy_ticks
      *
@@ -117,6 +225,113 @@ public:
      */
     uint64_t get_total_ticks() const;
 
+    /*
+     * account
+     *
+     * Records ticks that passed on this node outside of tick(), e.g. a
+     * plan replayed from a cache or idle time while other nodes finish.
+     *
+     * @param[in]  busy_ticks  busy core ticks, at most cores * ticks
+     * @param[in]  ticks       ticks that passed
+     * @param[in]  tasks       tasks that were assigned and completed
+     */
+    void account(uint64_t busy_ticks, uint64_t ticks, uint64_t tasks);
+
+    /*
+     * reserve
+     *
+     * Adds a reservation to this node's timeline.  The reserved task's
+     * cores and resources are held from the start tick for the task's
+     * execution time.
+     *
+     * @param[in]  t      task to reserve for
+     * @param[in]  start  planner tick at which the task will start
+     */
+    void reserve(task* t, uint64_t start);
+
+    /*
+     * clear_reservations
+     *
+     * Empties this node's reservation timeline.
+     */
+    void clear_reservations();
+
+    /*
+     * has_reservations
+     *
+     * @return true if the reservation timeline is not empty
+     */
+    bool has_reservations() const;
+
+    /*
+     * earliest_start
+     *
+     * Finds the earliest tick at which the task could start on this node
+     * and hold its cores and resources for its whole execution time,
+     * given the running tasks, the reservation timeline and the windows
+     * the node is unavailable.
+     *
+     * @param[in]  t           task to place
+     * @param[in]  now         current planner tick
+     * @param[in]  not_before  tick the task can't start before (e.g., while
+     *                         its inputs are transferred)
+     *
+     * @return earliest start tick, never_fits if the node can't host the task
+     */
+    uint64_t earliest_start(const task* t, uint64_t now,
+            uint64_t not_before = 0) const;
+    static const uint64_t never_fits = UINT64_MAX;
+
+    /*
+     * add_unavailable
+     *
+     * Takes this node out of service from start until end, e.g. for
+     * maintenance.  No task runs on the node during the window, and the
+     * node rejoins when it ends.  Overlapping windows are merged.
+     *
+     * @param[in]  start  first tick the node is down
+     * @param[in]  end    first tick the node is back, after start
+     */
+    void add_unavailable(uint64_t start, uint64_t end);
+
+    typedef std::map<uint64_t, uint64_t> window_map;  // start to end
+
+    /*
+     * get_unavailable
+     *
+     * @return windows this node is down, by start tick
+     */
+    const window_map& get_unavailable() const;
+
+    /*
+     * has_unavailable
+     *
+     * @return true if this node has any unavailable window
+     */
+    bool has_unavailable() const;
+
+    /*
+     * next_up
+     *
+     * Finds the first tick from start at which this node stays up for
+     * the given number of ticks.
+     *
+     * @param[in]  start  earliest tick to start
+     * @param[in]  ticks  ticks to stay up for
+     *
+     * @return start if the node is up until start + ticks, otherwise the
+     *         end of the last window in the way
+     */
+    uint64_t next_up(uint64_t start, uint64_t ticks) const;
+
+    /*
+     * reset
+     *
+     * Returns this node to its initial, idle state and clears the
+     * accumulated statistics.
+     */
+    void reset();
+
     friend std::ostream& operator<<(std::ostream& os, const compute& comp);
 
     typedef boost::shared_ptr<compute> ptr;
@@ -125,15 +340,26 @@ public:
 
 private:
 
+    typedef std::multimap<uint64_t, task*> reservation_list;
+
     std::string _name;
     int64_t _cores_total;
     int64_t _cores_available;
+    resource_set _res_total;
+    resource_set _res_available;
+    uint32_t _speed;
     uint64_t _cumulative_busy_ticks; // for all cores
     uint64_t _cumulative_idle_ticks; // for all cores
     uint64_t _completed_tasks;
-    task::ptr_llist _current_tasks;
+    // running tasks, in assignment order, and their work left and cores
+    // in arrays that tick() advances in bulk
+    task::ptr_list _current_tasks;
+    std::vector<int64_t> _current_work;
+    std::vector<int64_t> _current_cores;
     state _state;
     uint64_t _assign_count;
+    reservation_list _reservations;
+    window_map _down;
 };
 
 std::ostream& operator<<(std::ostream& os, const compute& comp);
@@ -0,0 +1,28 @@
+
+#ifndef _hash_h_
+#define _hash_h_
+
+#include <stdint.h>
+#include <string>
+
+/*
+ * fnv1a
+ *
+ * 64-bit FNV-1a hash, used to name cache entries after their inputs.
+ *
+ * @param[in]  data  bytes to hash
+ *
+ * @return hash of data
+ */
+inline uint64_t
+fnv1a(const std::string& data)
+{
+    uint64_t hash(14695981039346656037ULL);
+    for (std::string::const_iterator itr(data.begin()); itr != data.end(); ++itr) {
+        hash ^= static_cast<unsigned char>(*itr);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif // _hash_h_
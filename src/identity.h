@@ -1,27 +1,47 @@
-
 #ifndef _id_h_
 #define _id_h_
 
 #include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 /*
  * @class namespace_id
  *
  * Type-based identity generator/assigner used by task code to handle integer
- * IDs needed by the graphing library.
+ * IDs needed by the graphing library.  IDs that are released are handed
+ * out again, lowest first, so IDs stay dense in a process that creates
+ * and destroys many task sets.
  */
 template<typename C, typename T = uint64_t>
 class namespace_id {
 public:
     T next_id()
     {
-        return _next_id_val++;
+        if (_free_ids.empty()) {
+            return _next_id_val++;
+        }
+        std::pop_heap(_free_ids.begin(), _free_ids.end(), std::greater<T>());
+        T id(_free_ids.back());
+        _free_ids.pop_back();
+        return id;
+    }
+
+    static void release_id(T id)
+    {
+        _free_ids.push_back(id);
+        std::push_heap(_free_ids.begin(), _free_ids.end(), std::greater<T>());
     }
 private:
     static T _next_id_val;
+    static std::vector<T> _free_ids;    // min-heap of released IDs
 };
 
 template<typename C, typename T>
 T namespace_id<C,T>::_next_id_val = static_cast<T>(0);
 
+template<typename C, typename T>
+std::vector<T> namespace_id<C,T>::_free_ids;
+
 #endif // _id_h_
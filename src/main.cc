@@ -1,19 +1,31 @@
 
 #include <boost/program_options.hpp>
 #include <boost/program_options/value_semantic.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <utility>
 #include <queue>
+#include <sstream>
 
 #include <string.h>
 
+#include "analysis.h"
+#include "branch_bound.h"
 #include "pparse.h"
 #include "task.h"
 #include "compute.h"
 #include "planner.h"
+#include "montecarlo.h"
+#include "optimizer.h"
+#include "parallel.h"
+#include "plan_cache.h"
+#include "sensitivity.h"
+#include "sim.h"
+#include "tick_kernel.h"
 
 #define DEFAULT_TASK_FILE    "tasks.yaml"
 #define DEFAULT_COMPUTE_FILE "compute.yaml"
@@ -26,20 +38,717 @@ namespace {
             return rc->get_assign_count() > lc->get_assign_count();
         }
     };
+    // fewer waiters first, ties the later task first
     class task_waiters_sort {
     public:
         bool operator()(task* lt, task* rt)
         {
+            if (lt->get_waiter_count() == rt->get_waiter_count()) {
+                return lt->get_id() > rt->get_id();
+            }
             return rt->get_waiter_count() > lt->get_waiter_count();
         }
     };
+    // fewer dependencies first, ties the later task first
     class task_dependencies_sort {
     public:
         bool operator()(task* lt, task* rt)
         {
+            if (lt->get_dependency_count() == rt->get_dependency_count()) {
+                return lt->get_id() > rt->get_id();
+            }
             return rt->get_dependency_count() > lt->get_dependency_count();
         }
     };
+
+    // reverses a sort, so a heap has the least task on top
+    template <class Sort>
+    class reverse_sort {
+    public:
+        bool operator()(task* lt, task* rt)
+        {
+            return _sort(rt, lt);
+        }
+    private:
+        Sort _sort;
+    };
+
+    //
+    // top_tasks -- the count greatest tasks in a sort, greatest first
+    //
+    // Only count + 1 tasks are held at a time, in a heap with the least of
+    // them on top, so this is linear in the number of tasks.
+    //
+    template <class Sort>
+    std::vector<task*>
+    top_tasks(const task::list& tasks, uint64_t count)
+    {
+        reverse_sort<Sort> least_first;
+        std::vector<task*> top;
+        top.reserve(count + 1);
+        for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            top.push_back(itr->get());
+            std::push_heap(top.begin(), top.end(), least_first);
+            if (top.size() > count) {
+                std::pop_heap(top.begin(), top.end(), least_first);
+                top.pop_back();
+            }
+        }
+        std::sort_heap(top.begin(), top.end(), least_first);
+        return top;
+    }
+
+    // makespan, core utilization and tardiness of a finished plan
+    struct plan_summary {
+        uint64_t ticks;
+        uint64_t busy_ticks;
+        uint64_t total_ticks;
+        bool deadlines;
+        uint64_t weighted_tardiness;
+    };
+
+    plan_summary
+    summarize(const planner& plan, const compute::list& comp, const task::list& tasks)
+    {
+        plan_summary ps = { plan.get_required_ticks(), 0, 0, false, 0 };
+        for (compute::list::const_iterator itr(comp.begin());
+                itr != comp.end();
+                ++itr) {
+            ps.busy_ticks += (*itr)->get_busy_ticks();
+            ps.total_ticks += (*itr)->get_total_ticks();
+        }
+        for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            if ((*itr)->get_deadline() != task::no_deadline) {
+                ps.deadlines = true;
+                ps.weighted_tardiness += (*itr)->get_tardiness() * (*itr)->get_priority();
+            }
+        }
+        return ps;
+    }
+
+    // orders tasks by how often they were on the critical chain
+    class critical_count_sort {
+    public:
+        critical_count_sort(const std::vector<uint64_t>& count)
+            : _count(count)
+        {
+        }
+        bool operator()(sim_model::index_t lt, sim_model::index_t rt) const
+        {
+            if (_count[lt] == _count[rt]) {
+                return lt < rt;
+            }
+            return _count[lt] > _count[rt];
+        }
+    private:
+        const std::vector<uint64_t>& _count;
+    };
+
+    //
+    // plan_order -- the start order and nodes of a plan, by model task index
+    //
+    void
+    plan_order(const sim_model& model, const planner::schedule_list& sched,
+            std::vector<sim_model::index_t>* rank, std::vector<sim_model::index_t>* node)
+    {
+        rank->resize(model.task_count());
+        node->resize(model.task_count());
+        for (planner::schedule_list::const_iterator itr(sched.begin());
+                itr != sched.end();
+                ++itr) {
+            planner::schedule_entry entry(*itr);
+            sim_model::index_t ix(model.task_index(entry.get_task()));
+            (*rank)[ix] = itr - sched.begin();
+            (*node)[ix] = model.node_index(entry.get_compute());
+        }
+    }
+
+    //
+    // monte_carlo -- replay the plan or the policy under sampled execution times
+    //
+    void
+    monte_carlo(const compute::list& comp, const task::list& tasks,
+            const planner::schedule_list& sched, uint64_t samples,
+            bool replay_plan, unsigned threads, uint64_t seed)
+    {
+        const unsigned max_show_count = 10;
+        sim_model model(comp, tasks);
+        std::vector<sim_model::index_t> rank;
+        std::vector<sim_model::index_t> fixed_node;
+        if (replay_plan) {
+            // start order and nodes as planned
+            plan_order(model, sched, &rank, &fixed_node);
+        } else {
+            rank = model.policy_rank();
+        }
+
+        montecarlo mc(model, tasks);
+        montecarlo::report rep(mc.run(samples, threads, seed, rank,
+                    replay_plan ? &fixed_node : NULL));
+
+        std::cout << "== Monte Carlo makespan ==\n";
+        std::cout << "Samples: " << rep.samples << " ("
+            << (replay_plan ? "replaying plan" : "replaying greedy policy")
+            << ", " << threads << " threads)\n";
+        std::cout << "Nominal makespan: " << rep.nominal << "\n";
+        std::cout << "    p50: " << rep.p50 << "\n";
+        std::cout << "    p95: " << rep.p95 << "\n";
+        std::cout << "    p99: " << rep.p99 << "\n";
+        std::cout << "    mean: " << std::fixed << std::setprecision(1) << rep.mean
+            << " (min " << rep.min << ", max " << rep.max << ")\n";
+
+        std::vector<sim_model::index_t> order(model.task_count());
+        for (sim_model::index_t ix(0); ix < order.size(); ++ix) {
+            order[ix] = ix;
+        }
+        uint64_t show(std::min<uint64_t>(max_show_count, order.size()));
+        std::partial_sort(order.begin(), order.begin() + show, order.end(),
+                critical_count_sort(rep.critical_count));
+        std::cout << "Most often on the critical path:\n";
+        for (uint64_t ix(0); ix < show && rep.critical_count[order[ix]]; ++ix) {
+            std::cout << "    " << tasks[order[ix]]->name() << ": "
+                << 100.0 * rep.critical_count[order[ix]] / rep.samples
+                << "% of samples\n";
+        }
+        std::cout.unsetf(std::ios_base::floatfield);
+    }
+
+    //
+    // optimize_unsupported -- what the plan simulation doesn't model, if any
+    //
+    const char*
+    optimize_unsupported(const compute::list& comp, const task::list& tasks,
+            const network& net)
+    {
+        if (!net.is_free()) {
+            return "data transfers";
+        }
+        if (std::find_if(comp.begin(), comp.end(),
+                    bind(&compute::has_unavailable, _1)) != comp.end()) {
+            return "unavailable windows";
+        }
+        for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            if ((*itr)->is_gang()) {
+                return "gang tasks";
+            }
+            if ((*itr)->is_moldable()) {
+                return "moldable tasks";
+            }
+            if ((*itr)->get_release_time()) {
+                return "release times";
+            }
+        }
+        return NULL;
+    }
+
+    //
+    // follow_plan -- plan the tasks again following a plan from the model
+    //
+    // The plan is kept if the planner finds it shorter than the one it
+    // replaces, otherwise the tasks are planned as before.
+    //
+    // @return true if the plan was kept
+    //
+    bool
+    follow_plan(planner& plan, const compute::list& comp, const task::list& tasks,
+            const sim_model& model, const std::vector<sim_model::index_t>& rank,
+            const std::vector<sim_model::index_t>& node,
+            const std::vector<uint64_t>& start, planner::schedule_list* sched)
+    {
+        uint64_t planned(plan.get_required_ticks());
+        task::id_t ids(0);
+        for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            ids = std::max(ids, (*itr)->get_id() + 1);
+        }
+        std::vector<uint64_t> order(ids);
+        std::vector<compute*> nodes(ids);
+        std::vector<uint64_t> starts(start.empty() ? 0 : ids);
+        for (sim_model::index_t ix(0); ix < model.task_count(); ++ix) {
+            order[tasks[ix]->get_id()] = rank[ix];
+            nodes[tasks[ix]->get_id()] = comp[node[ix]].get();
+            if (!start.empty()) {
+                starts[tasks[ix]->get_id()] = start[ix];
+            }
+        }
+        plan.reset();
+        plan.set_fixed_plan(order, nodes, starts);
+        planner::schedule_list replayed(plan.schedule_tasks());
+        plan.set_fixed_plan(std::vector<uint64_t>(), std::vector<compute*>(),
+                std::vector<uint64_t>());
+        if (plan.get_required_ticks() < planned) {
+            sched->swap(replayed);
+            return true;
+        }
+        plan.reset();
+        *sched = plan.schedule_tasks();
+        return false;
+    }
+
+    //
+    // optimize -- search for a shorter plan and replay it in the planner
+    //
+    // The search runs on the simulation model, so the best plan it finds is
+    // planned again with the planner following it, and kept only if it is
+    // also shorter there.
+    //
+    void
+    optimize(planner& plan, const compute::list& comp, const task::list& tasks,
+            planner::schedule_list* sched, double seconds, unsigned threads,
+            uint64_t seed, std::ostream& out)
+    {
+        sim_model model(comp, tasks);
+        std::vector<sim_model::index_t> rank;
+        std::vector<sim_model::index_t> node;
+        plan_order(model, *sched, &rank, &node);
+        uint64_t planned(plan.get_required_ticks());
+        optimizer::result best(optimizer(model).run(seconds, threads, seed, rank, node));
+
+        bool kept(best.makespan < best.initial &&
+                follow_plan(plan, comp, tasks, model, best.rank, best.node,
+                    std::vector<uint64_t>(), sched));
+
+        out << "== Plan optimization ==\n";
+        out << "Searched " << best.moves << " plans for " << seconds << " seconds on "
+            << threads << " threads, " << best.improvements << " improvements\n";
+        if (kept) {
+            out << "Makespan: " << planned << " -> " << plan.get_required_ticks()
+                << " (" << std::fixed << std::setprecision(1)
+                << 100.0 * (planned - plan.get_required_ticks()) / planned
+                << "% shorter)\n";
+        } else {
+            out << "Makespan: " << planned << ", no shorter plan found\n";
+        }
+    }
+
+    //
+    // solve_exact -- search for an optimal plan and replay it in the planner
+    //
+    // The current plan's makespan is the one to beat.  Unless the search
+    // ran to the end, the optimum is only known to lie between the lower
+    // bound and the best plan, and the gap is reported instead.
+    //
+    void
+    solve_exact(planner& plan, const compute::list& comp, const task::list& tasks,
+            planner::schedule_list* sched, double seconds, uint64_t max_branches,
+            unsigned threads, std::ostream& out)
+    {
+        static const char* ending_str[] = {
+            "search complete",
+            "stopped at the branch limit",
+            "stopped at the time limit"
+        };
+        sim_model model(comp, tasks);
+        uint64_t planned(plan.get_required_ticks());
+        branch_bound::result best(branch_bound(model).run(planned, seconds, max_branches,
+                    threads));
+
+        bool kept(best.found &&
+                follow_plan(plan, comp, tasks, model, best.rank, best.node, best.start, sched));
+        uint64_t makespan(plan.get_required_ticks());
+        bool optimal(best.end == branch_bound::searched && (kept || !best.found));
+
+        out << "== Exact search ==\n";
+        out << "Searched " << best.branches << " branches on " << threads << " threads, "
+            << ending_str[best.end] << "\n";
+        out << "Makespan: " << planned;
+        if (kept) {
+            out << " -> " << makespan;
+        }
+        out << std::fixed << std::setprecision(1);
+        if (optimal) {
+            out << ", optimal\n";
+        } else {
+            out << ", lower bound " << best.lower_bound << " ("
+                << 100.0 * (makespan - best.lower_bound) / std::max<uint64_t>(best.lower_bound, 1)
+                << "% gap)\n";
+        }
+        out << "Planned makespan " << (optimal ? "was " : "is at most ")
+            << 100.0 * (planned - best.lower_bound) / std::max<uint64_t>(best.lower_bound, 1)
+            << "% above optimal\n";
+        out.unsetf(std::ios_base::floatfield);
+    }
+
+    //
+    // slack_report -- slack of each task and what shortening it would save
+    //
+    // The ranking is printed when show is set and written to path, one
+    // tab-separated line per task, when path isn't empty.  Slack is of the
+    // replayed plan, whose makespan can differ a little from the planned
+    // one, so both are printed.  A confirmed gain can be negative: list
+    // scheduling sometimes runs longer when a task gets shorter.
+    //
+    // @return false if the file couldn't be written
+    //
+    bool
+    slack_report(const compute::list& comp, const task::list& tasks,
+            const planner::schedule_list& sched, uint64_t planned, uint64_t confirm,
+            unsigned threads, bool show, const std::string& path)
+    {
+        const uint64_t max_show_count = 10;
+        sim_model model(comp, tasks);
+        std::vector<sim_model::index_t> rank;
+        std::vector<sim_model::index_t> node;
+        plan_order(model, sched, &rank, &node);
+        sensitivity::report rep(sensitivity(model).run(rank, node, confirm, threads));
+
+        if (show) {
+            std::cout << "== Slack and sensitivity ==\n";
+            std::cout << "Replayed makespan: " << rep.makespan << " (planned " << planned
+                << "), " << rep.critical << " of " << tasks.size() << " tasks without slack\n";
+            if (confirm) {
+                std::cout << "Confirmed by " << std::min<uint64_t>(confirm, tasks.size())
+                    << " simulations on " << threads << " threads\n";
+            }
+            uint64_t show_count(std::max(max_show_count, confirm));
+            for (uint64_t ix(0); ix < show_count && ix < rep.ranked.size(); ++ix) {
+                sim_model::index_t t(rep.ranked[ix]);
+                if (!rep.estimate[t] && !rep.shortened[t]) {
+                    break;
+                }
+                if (ix == 0) {
+                    std::cout << "Tasks that would shorten the plan most in half the time:\n";
+                }
+                std::cout << "    " << tasks[t]->name() << ": ran " << rep.finish[t] - rep.start[t]
+                    << " ticks, slack " << rep.latest_start[t] - rep.start[t]
+                    << ", saves up to " << rep.estimate[t];
+                if (rep.shortened[t]) {
+                    int64_t gain(static_cast<int64_t>(rep.makespan - rep.shortened[t]));
+                    std::cout << ", confirmed " << gain << (gain > 0 ? "" : " (no gain)");
+                }
+                std::cout << "\n";
+            }
+            std::cout << "\n";
+        }
+
+        if (path.empty()) {
+            return true;
+        }
+        std::ofstream out(path.c_str());
+        out << "task\tnode\tstart\tfinish\tlatest_start\tslack\testimated_gain\tconfirmed_gain\n";
+        for (std::vector<sim_model::index_t>::const_iterator itr(rep.ranked.begin());
+                itr != rep.ranked.end();
+                ++itr) {
+            out << tasks[*itr]->name() << "\t" << comp[rep.node[*itr]]->name()
+                << "\t" << rep.start[*itr] << "\t" << rep.finish[*itr]
+                << "\t" << rep.latest_start[*itr]
+                << "\t" << rep.latest_start[*itr] - rep.start[*itr]
+                << "\t" << rep.estimate[*itr] << "\t";
+            if (rep.shortened[*itr]) {
+                out << static_cast<int64_t>(rep.makespan - rep.shortened[*itr]);
+            } else {
+                out << "-";
+            }
+            out << "\n";
+        }
+        out.close();
+        if (!out) {
+            std::cerr << "Error: can't write slack file " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    //
+    // parallelism_profile -- critical path, level widths and cores in use
+    //
+    // Output is bounded: long paths are elided and levels and time are
+    // grouped into at most profile_rows rows each.
+    //
+    void
+    parallelism_profile(const compute::list& comp, const task::list& tasks,
+            uint64_t makespan)
+    {
+        const uint64_t profile_rows = 20;
+        const uint64_t max_show_count = 10;
+        const int bar_width = 40;
+        sim_model model(comp, tasks);
+        analysis an(model);
+
+        std::cout << "== Parallelism profile ==\n";
+        const std::vector<sim_model::index_t>& path(an.get_critical_path());
+        std::cout << "Critical path: " << an.get_critical_length() << " ticks over "
+            << path.size() << " tasks";
+        if (an.get_critical_length()) {
+            std::cout << " (makespan is " << std::fixed << std::setprecision(2)
+                << static_cast<double>(makespan) / an.get_critical_length() << "x)";
+            std::cout.unsetf(std::ios_base::floatfield);
+        }
+        std::cout << "\n    ";
+        for (uint64_t ix(0); ix < path.size(); ++ix) {
+            if (ix == max_show_count / 2 && path.size() > max_show_count) {
+                std::cout << "... (" << path.size() - max_show_count << " more) -> ";
+                ix = path.size() - max_show_count / 2;
+            }
+            std::cout << tasks[path[ix]]->name()
+                << (ix + 1 < path.size() ? " -> " : "\n");
+        }
+
+        const std::vector<uint64_t>& width(an.get_level_widths());
+        std::vector<uint64_t>::const_iterator widest(
+                std::max_element(width.begin(), width.end()));
+        if (widest != width.end()) {
+            std::cout << "Topological levels: " << width.size() << ", widest: level "
+                << widest - width.begin() << " with " << *widest << " tasks\n";
+            uint64_t per_row((width.size() + profile_rows - 1) / profile_rows);
+            std::cout << "Tasks per level:\n";
+            for (uint64_t lo(0); lo < width.size(); lo += per_row) {
+                uint64_t hi(std::min<uint64_t>(width.size(), lo + per_row));
+                uint64_t most(*std::max_element(width.begin() + lo, width.begin() + hi));
+                std::ostringstream levels;
+                levels << lo;
+                if (hi - lo > 1) {
+                    levels << "-" << hi - 1;
+                }
+                std::cout << "    levels " << std::setw(13) << levels.str() << ": "
+                    << std::setw(8) << most << " " << std::string(
+                            bar_width * most / *widest, '#') << "\n";
+            }
+        }
+
+        uint64_t total_cores(0);
+        for (compute::list::const_iterator itr(comp.begin()); itr != comp.end(); ++itr) {
+            total_cores += (*itr)->get_cores();
+        }
+        uint64_t bucket;
+        std::vector<uint64_t> used(analysis::cores_in_use(tasks, makespan,
+                    std::min(profile_rows, makespan), &bucket));
+        std::cout << "Cores in use (" << total_cores << " cores, "
+            << bucket << " ticks per row):\n";
+        for (uint64_t bx(0); bx < used.size(); ++bx) {
+            uint64_t lo(bx * bucket);
+            uint64_t hi(std::min(makespan, lo + bucket));
+            double avg(static_cast<double>(used[bx]) / (hi - lo));
+            std::ostringstream ticks;
+            ticks << lo << "-" << hi - 1;
+            std::cout << "    ticks " << std::setw(14) << ticks.str() << ": "
+                << std::fixed << std::setprecision(1) << std::setw(8) << avg << " "
+                << std::string(total_cores ? bar_width * avg / total_cores : 0, '#')
+                << "\n";
+            std::cout.unsetf(std::ios_base::floatfield);
+        }
+        std::cout << "\n";
+    }
+
+    // tardiness_sort -- least weighted tardiness on top of a priority queue
+    struct tardiness_sort {
+        bool operator()(const task* rt, const task* lt) const
+        {
+            return rt->get_tardiness() * rt->get_priority() >
+                lt->get_tardiness() * lt->get_priority();
+        }
+    };
+
+    //
+    // deadline_report -- missed deadlines and tardiness of a finished plan
+    //
+    // Prints nothing when no task has a deadline.
+    //
+    void
+    deadline_report(const task::list& tasks)
+    {
+        const uint64_t max_show_count = 10;
+        uint64_t with_deadline(0);
+        uint64_t missed(0);
+        uint64_t tardiness(0);
+        uint64_t weighted(0);
+        std::priority_queue<task*, std::vector<task*>, tardiness_sort> latest;
+        for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            if ((*itr)->get_deadline() == task::no_deadline) {
+                continue;
+            }
+            ++with_deadline;
+            uint64_t late((*itr)->get_tardiness());
+            if (late == 0) {
+                continue;
+            }
+            ++missed;
+            tardiness += late;
+            weighted += late * (*itr)->get_priority();
+            latest.push(itr->get());
+            if (latest.size() > max_show_count) {
+                latest.pop();
+            }
+        }
+        if (with_deadline == 0) {
+            return;
+        }
+        std::cout << "Deadlines missed: " << missed << " of " << with_deadline << "\n";
+        std::cout << "    total tardiness: " << tardiness << " ticks\n";
+        std::cout << "    weighted tardiness: " << weighted << "\n";
+        std::vector<task*> worst;
+        for (; !latest.empty(); latest.pop()) {
+            worst.push_back(latest.top());
+        }
+        for (std::vector<task*>::reverse_iterator itr(worst.rbegin());
+                itr != worst.rend();
+                ++itr) {
+            std::cout << "    " << (*itr)->name() << ": finished "
+                << (*itr)->get_finish_tick() << ", deadline " << (*itr)->get_deadline()
+                << ", priority " << (*itr)->get_priority() << "\n";
+        }
+    }
+
+    // print one schedule entry, with the cores chosen for a moldable task
+    // and every node of a gang task
+    void
+    print_entry(planner::schedule_entry entry)
+    {
+        const task* t(entry.get_task());
+        std::cout << t->name() << ": ";
+        const task::gang_list& parts(t->get_gang_parts());
+        if (parts.size() > 1) {
+            for (task::gang_list::const_iterator part(parts.begin());
+                    part != parts.end();
+                    ++part) {
+                std::cout << (part == parts.begin() ? "" : ", ") << part->first->name()
+                    << " (" << part->second << " cores)";
+            }
+        } else {
+            std::cout << entry.get_compute()->name();
+            if (t->is_moldable()) {
+                std::cout << " (" << t->get_cores_required() << " cores)";
+            }
+        }
+        std::cout << "\n";
+    }
+
+    // print_sink -- prints schedule entries as soon as they are decided
+    class print_sink : public planner::schedule_sink {
+    public:
+        void decided(planner::schedule_entry entry)
+        {
+            print_entry(entry);
+        }
+    };
+
+    // print schedule entries that haven't been printed yet
+    void
+    emit_schedule(const planner::schedule_list& sched, uint64_t* emitted)
+    {
+        for (; *emitted < sched.size(); ++*emitted) {
+            print_entry(sched[*emitted]);
+        }
+        std::cout.flush();
+    }
+
+    //
+    // plan_online -- schedule tasks while they are still arriving
+    //
+    // Before a task is added the simulation runs up to its release time.
+    // Tasks arrive in release time order, so every decision made before
+    // that tick is final and is printed right away.  A task released
+    // earlier than the current tick is released now.
+    //
+    int
+    plan_online(planner& plan, const std::string& source,
+            planner::schedule_list* sched)
+    {
+        std::ifstream file;
+        std::istream* in(&std::cin);
+        if (source != "-") {
+            file.open(source.c_str());
+            if (!file) {
+                std::cerr << "Error: can't open task stream " << source << "\n";
+                return 1;
+            }
+            in = &file;
+        }
+        pparse::task_stream stream(*in, source, in != &std::cin);
+
+        uint64_t emitted(0);
+        std::cout << "# task schedule:\n";
+        for (;;) {
+            task::ptr t;
+            if (stream.next(&t)) {
+                return 1;
+            }
+            if (!t) {
+                break;
+            }
+            uint64_t release(std::max(t->get_release_time(), plan.get_required_ticks()));
+            t->set_release_time(release);
+            emit_schedule(plan.schedule_until(release), &emitted);
+
+            planner::status rc(plan.add_task(t));
+            if (rc != planner::ok) {
+                std::cout << "Planner failed: " << planner::status_str[rc]
+                    << " (" << t->name() << ")\n";
+                return 1;
+            }
+        }
+        *sched = plan.schedule_until(planner::unbounded);
+        emit_schedule(*sched, &emitted);
+        return 0;
+    }
+
+    //
+    // output_capture -- keep a copy of everything written to a stream
+    //
+    // The output still goes through to the stream as it is written.  The
+    // stream is restored when the capture goes away.
+    //
+    class output_capture : public std::streambuf {
+    public:
+        output_capture(std::ostream& os)
+            : _os(os),
+            _orig(os.rdbuf(this))
+        {
+        }
+        ~output_capture()
+        {
+            _os.rdbuf(_orig);
+        }
+        const std::string& str() const
+        {
+            return _copy;
+        }
+    protected:
+        int overflow(int c)
+        {
+            if (c == EOF) {
+                return 0;
+            }
+            _copy += static_cast<char>(c);
+            return _orig->sputc(static_cast<char>(c));
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n)
+        {
+            _copy.append(s, n);
+            return _orig->sputn(s, n);
+        }
+        int sync()
+        {
+            return _orig->pubsync();
+        }
+    private:
+        std::ostream& _os;
+        std::streambuf* _orig;
+        std::string _copy;
+    };
+
+    void
+    print_cache_stats(const plan_cache::stats& st)
+    {
+        std::cout << "== Plan cache ==\n";
+        std::cout << "Hits: " << st.hits << "  misses: " << st.misses
+            << "  evictions: " << st.evictions << "\n";
+        std::cout << "Entries: " << st.entries << " (" << st.bytes << " bytes)\n";
+    }
+
+    void
+    print_summary(const char* mode, const plan_summary& ps)
+    {
+        float util = ps.total_ticks ? 100.0 * static_cast<float>(ps.busy_ticks) /
+            static_cast<float>(ps.total_ticks) : 0.0;
+        std::cout << "    " << std::left << std::setw(24) << mode << std::right
+            << " makespan: " << std::setw(10) << ps.ticks
+            << "  utilization: " << std::fixed << std::setprecision(2) << util << "%";
+        if (ps.deadlines) {
+            std::cout << "  weighted tardiness: " << ps.weighted_tardiness;
+        }
+        std::cout << "\n";
+        std::cout.unsetf(std::ios_base::floatfield);
+    }
 }
 
 using namespace boost;
@@ -53,8 +762,39 @@ int main(int argc, char** argv)
 
     std::string tasks_file; 
     std::string compute_file;
+    std::string mode_name;
+    planner::mode mode = planner::greedy;
     bool analyze = false;
+    bool compare = false;
     bool verbose = false;
+    uint64_t mc_samples = 0;
+    std::string mc_replay;
+    double optimize_seconds = 0;
+    double exact_seconds = 0;
+    uint64_t exact_branches = 0;
+    bool show_slack = false;
+    uint64_t sensitivity_count = 0;
+    std::string slack_file;
+    std::string online_source;
+    bool partition = false;
+    bool reduce_deps = false;
+    bool node_classes = false;
+    bool level_order = false;
+    bool gang_fewest_nodes = false;
+    std::string kernel_name;
+    std::string component_cache;
+    std::string plan_cache_dir;
+    uint64_t plan_cache_mb = 64;
+    bool plan_cache_stats = false;
+    unsigned threads = parallel::default_threads();
+    uint64_t seed = 1;
+
+    std::string mode_help("scheduling mode (");
+    for (int ix(0); ix < planner::mode_count; ++ix) {
+        mode_help += ix ? ", " : "";
+        mode_help += planner::mode_str[ix];
+    }
+    mode_help += ")";
 
     opt_desc.add_options()
         ("help",     "display this message")
@@ -62,8 +802,56 @@ int main(int argc, char** argv)
              "name of task description file")
         ("compute",  opt::value<std::string>()->default_value(DEFAULT_COMPUTE_FILE),
              "name of compute description file (default: compute.yaml)")
+        ("mode",     opt::value<std::string>()->default_value(planner::mode_str[planner::greedy]),
+             mode_help.c_str())
+        ("compare",  opt::bool_switch(&compare),
+             "re-plan in greedy mode and compare makespan and utilization")
+        ("online",   opt::value<std::string>(&online_source),
+             "read tasks as they arrive from this file (followed as it grows) or - for stdin, "
+             "printing decisions as soon as they are final")
+        ("partition", opt::bool_switch(&partition),
+             "plan independent parts of the task graph on separate slices of the compute nodes in parallel")
+        ("component-cache", opt::value<std::string>(&component_cache),
+             "directory for reusing the plans of unchanged slices with --partition")
+        ("plan-cache", opt::value<std::string>(&plan_cache_dir),
+             "directory for reusing the output of earlier runs on the same input and options")
+        ("plan-cache-size", opt::value<uint64_t>(&plan_cache_mb),
+             "size limit of the plan cache in megabytes (default: 64)")
+        ("plan-cache-stats", opt::bool_switch(&plan_cache_stats),
+             "print plan cache statistics")
+        ("reduce-deps", opt::bool_switch(&reduce_deps),
+             "remove dependencies implied by other dependencies before planning")
+        ("level-order", opt::bool_switch(&level_order),
+             "order tasks level by level rather than depth-first before planning")
+        ("node-classes", opt::bool_switch(&node_classes),
+             "plan against classes of identical compute nodes instead of each node (greedy mode)")
+        ("gang-fewest-nodes", opt::bool_switch(&gang_fewest_nodes),
+             "spread gang tasks over as few compute nodes as possible")
         ("analyze",  opt::bool_switch(&analyze),
              "analyze compute utilization and task dependencies")
+        ("monte-carlo", opt::value<uint64_t>(&mc_samples),
+             "estimate the makespan distribution from this many sampled execution time sets")
+        ("replay",   opt::value<std::string>(&mc_replay)->default_value("plan"),
+             "what Monte Carlo samples replay: plan (nodes and order) or policy")
+        ("optimize-for", opt::value<double>(&optimize_seconds),
+             "improve the plan by local search for this many seconds")
+        ("exact-for", opt::value<double>(&exact_seconds),
+             "search for an optimal plan by branch and bound for at most this many seconds")
+        ("exact-branches", opt::value<uint64_t>(&exact_branches),
+             "search for an optimal plan by branch and bound over at most this many branches")
+        ("slack",    opt::bool_switch(&show_slack),
+             "print the tasks that would shorten the plan most if they ran faster, by slack")
+        ("sensitivity", opt::value<uint64_t>(&sensitivity_count),
+             "confirm the slack analysis by simulating the plan with each of this many "
+             "top ranked tasks running in half the time (implies --slack)")
+        ("slack-file", opt::value<std::string>(&slack_file),
+             "write the slack and sensitivity of every task to this file, tab-separated")
+        ("threads",  opt::value<unsigned>(&threads),
+             "number of threads for parallel work (default: hardware threads)")
+        ("seed",     opt::value<uint64_t>(&seed),
+             "random seed")
+        ("tick-kernel", opt::value<std::string>(&kernel_name)->default_value(tick_kernel::kind_str[tick_kernel::automatic]),
+             "kernel for advancing running tasks (auto, scalar, sse4.2, avx2)")
         ("verbose",  opt::bool_switch(&verbose),
              "print details of task and compute input");
 
@@ -87,14 +875,41 @@ int main(int argc, char** argv)
             compute_file = vmap["compute"].as<std::string>();
         }
 
+        if (vmap.count("mode")) {
+            mode_name = vmap["mode"].as<std::string>();
+            if (!planner::parse_mode(mode_name, &mode)) {
+                std::cerr << "Error: unknown scheduling mode " << mode_name << "\n";
+                return 1;
+            }
+        }
+
         if (vmap.count("analyze")) {
             analyze = vmap["analyze"].as<bool>(); 
         }
 
+        if (vmap.count("compare")) {
+            compare = vmap["compare"].as<bool>(); 
+        }
+
         if (vmap.count("verbose")) {
             verbose = vmap["verbose"].as<bool>(); 
         }
 
+        opt::notify(vmap);
+        if (mc_replay != "plan" && mc_replay != "policy") {
+            std::cerr << "Error: --replay must be plan or policy\n";
+            return 1;
+        }
+        tick_kernel::kind kernel;
+        if (!tick_kernel::parse_kind(kernel_name, &kernel)) {
+            std::cerr << "Error: unknown tick kernel " << kernel_name << "\n";
+            return 1;
+        }
+        tick_kernel::kind selected(tick_kernel::select(kernel));
+        if (verbose) {
+            std::cout << "Tick kernel: " << tick_kernel::kind_str[selected] << "\n";
+        }
+
     } catch (opt::error& err) {
         std::cerr << "Error: " << err.what() << "\n";
         std::cout << "Usage:" << argv[0] << " --tasks <tasks.yaml>"
@@ -109,12 +924,16 @@ int main(int argc, char** argv)
     }
     int err = 0;
 
-    err = pparse::read_compute_file(&comp, compute_file);
+    network net;
+    err = pparse::read_compute_file(&comp, compute_file, &net);
     if (err) {
         return 1;
     }
 
     if (verbose) {
+        if (!net.is_free()) {
+            std::cout << "Network: " << net << "\n";
+        }
         std::cout << "Compute Resources:\n";
         for (compute::list::iterator itr(comp.begin()) ; 
                 itr != comp.end();
@@ -123,14 +942,16 @@ int main(int argc, char** argv)
         }
     }
 
-    // read the task yaml file
+    // read the task yaml file, unless tasks arrive online
     task::list tasks;
-    if (verbose) {
-        std::cout << "Using tasks file " << tasks_file << ".\n";
-    }
-    err = pparse::read_tasks_file(&tasks, tasks_file);
-    if (err) {
-        return 1;
+    if (online_source.empty()) {
+        if (verbose) {
+            std::cout << "Using tasks file " << tasks_file << ".\n";
+        }
+        err = pparse::read_tasks_file(&tasks, tasks_file);
+        if (err) {
+            return 1;
+        }
     }
 
     if (verbose) {
@@ -142,27 +963,122 @@ int main(int argc, char** argv)
         }
     }
 
+    // reuse the output of an earlier run on the same input and options; the
+    // key holds every option that changes the output, and runs whose output
+    // also depends on the component cache's contents aren't cached
+    boost::scoped_ptr<plan_cache> cache;
+    boost::scoped_ptr<output_capture> capture;
+    std::string cache_key;
+    bool exact(exact_seconds > 0 || exact_branches > 0);
+    if (!plan_cache_dir.empty() && online_source.empty() && optimize_seconds <= 0 && !exact &&
+            slack_file.empty() && component_cache.empty()) {
+        std::ostringstream options;
+        options << planner::mode_str[mode] << " analyze " << analyze
+            << " compare " << compare << " partition " << partition
+            << " reduce-deps " << reduce_deps << " node-classes " << node_classes
+            << " level-order " << level_order << " gang-fewest-nodes " << gang_fewest_nodes
+            << " monte-carlo " << mc_samples << " slack " << show_slack
+            << " sensitivity " << sensitivity_count << " verbose " << verbose
+            << " threads " << threads;
+        if (mc_samples) {
+            options << " replay " << mc_replay << " seed " << seed;
+        }
+        cache.reset(new plan_cache(plan_cache_dir, plan_cache_mb << 20));
+        cache_key = plan_cache::key(comp, tasks, net, options.str());
+        std::string output;
+        if (cache->load(cache_key, &output)) {
+            std::cout << output;
+            if (plan_cache_stats) {
+                print_cache_stats(cache->get_stats());
+            }
+            return 0;
+        }
+        capture.reset(new output_capture(std::cout));
+    }
+
     // initialize planner
     planner plan(&comp, &tasks);
+    plan.set_mode(mode);
+    plan.set_network(net);
+    plan.set_threads(threads);
+    plan.set_level_order(level_order);
+    plan.set_partitioned(partition, threads);
+    plan.set_component_cache(component_cache);
+    plan.set_reduce_dependencies(reduce_deps, threads);
+    plan.set_node_classes(node_classes);
+    plan.set_gang_fewest_nodes(gang_fewest_nodes);
+    if (verbose) {
+        plan.set_edge_log(&std::cout);
+    }
 
     // validate tasks and compute
     planner::status rc = plan.validate_tasks();
 
     if (rc != planner::ok) {
-        std::cout << "Planner failed: " << planner::status_str[rc] << "\n";
+        std::cout << "Planner failed: " << planner::status_str[rc];
+        if (rc == planner::circular_dependency) {
+            const task::ptr_list& cycle(plan.get_cycle());
+            std::cout << " (";
+            for (task::ptr_list::const_iterator itr(cycle.begin());
+                    itr != cycle.end();
+                    ++itr) {
+                std::cout << (*itr)->name() << " -> ";
+            }
+            std::cout << cycle.front()->name() << ")";
+        } else if (plan.get_last_task()) {
+            std::cout << " (" << plan.get_last_task()->name() << ")";
+        }
+        std::cout << "\n";
         return 1;
     }
 
-    // build the plan
-    planner::schedule_list sched(plan.schedule_tasks());
-
-    std::cout << "# task schedule:\n";
-    for (planner::schedule_list::iterator itr(sched.begin()) ; 
-            itr != sched.end();
-            ++itr) {
-        task* t = itr->get_task();
-        compute* c = itr->get_compute();
-        std::cout << t->get_name() << ": "  << c->get_name() << "\n";
+    // build the plan, printing it as it is decided unless Monte Carlo
+    // simulation or slack analysis needs to replay it or the optimizer or
+    // exact search to improve it afterward
+    planner::schedule_list sched;
+    print_sink printer;
+    const char* unsupported(NULL);
+    show_slack = show_slack || sensitivity_count > 0;
+    bool slack(show_slack || !slack_file.empty());
+    if (optimize_seconds > 0 || exact || slack) {
+        unsupported = online_source.empty() ?
+            optimize_unsupported(comp, tasks, net) : "online planning";
+    }
+    bool optimizing(optimize_seconds > 0 && !unsupported);
+    bool solving(exact && !unsupported);
+    if (!mc_samples && !optimizing && !solving && !(slack && !unsupported)) {
+        plan.set_schedule_sink(&printer);
+    }
+    if (!online_source.empty()) {
+        if (plan_online(plan, online_source, &sched)) {
+            return 1;
+        }
+    } else {
+        std::cout << "# task schedule:\n";
+        sched = plan.schedule_tasks();
+        if (optimizing || solving) {
+            std::ostringstream report;
+            if (optimizing) {
+                optimize(plan, comp, tasks, &sched, optimize_seconds, threads, seed, report);
+            }
+            if (solving) {
+                solve_exact(plan, comp, tasks, &sched, exact_seconds, exact_branches,
+                        threads, report);
+            }
+            uint64_t emitted(0);
+            emit_schedule(sched, &emitted);
+            std::cout << report.str();
+        } else {
+            uint64_t emitted(0);
+            emit_schedule(sched, &emitted);
+        }
+    }
+    plan.set_schedule_sink(NULL);
+    if (unsupported && optimize_seconds > 0) {
+        std::cout << "Plan optimization doesn't model " << unsupported << ", skipped\n";
+    }
+    if (unsupported && exact) {
+        std::cout << "Exact search doesn't model " << unsupported << ", skipped\n";
     }
 
     // very basic analysis of tasks, compute and planning
@@ -174,6 +1090,9 @@ int main(int argc, char** argv)
         uint64_t total_comp_busy(0);
         uint64_t total_comp_idle(0);
         uint64_t compute_nodes(0);
+        uint64_t total_comp_down(0);
+        uint64_t down_windows(0);
+        uint64_t down_nodes(0);
         typedef std::priority_queue<compute*, std::vector<compute*>, compute_assign_count> hot_compute_list;
         hot_compute_list hot_compute;
         for (compute::list::iterator comp_itr(comp.begin());
@@ -185,6 +1104,17 @@ int main(int argc, char** argv)
             total_comp_idle += (*comp_itr)->get_idle_ticks();
             ++compute_nodes;
             hot_compute.push(comp_itr->get());
+
+            // core ticks lost to windows within the plan
+            const compute::window_map& down((*comp_itr)->get_unavailable());
+            for (compute::window_map::const_iterator win(down.begin());
+                    win != down.end() && win->first < plan.get_required_ticks();
+                    ++win) {
+                total_comp_down += (*comp_itr)->get_cores() *
+                    (std::min(win->second, plan.get_required_ticks()) - win->first);
+                ++down_windows;
+            }
+            down_nodes += !down.empty();
         }
         
         float avg_cores =
@@ -194,6 +1124,10 @@ int main(int argc, char** argv)
         std::cout << "Total ticks needed (across all cores):" << total_comp_ticks << "\n";
         std::cout << "    busy ticks: " << total_comp_busy << "\n";
         std::cout << "    idle ticks: " << total_comp_idle << "\n";
+        if (down_nodes) {
+            std::cout << "    unavailable ticks: " << total_comp_down << " (" << down_windows
+                << " windows on " << down_nodes << " nodes)\n";
+        }
         std::cout.precision(4);
         std::cout << "Avg. cores per node: " << std::setw(5) << avg_cores << "\n";
         std::cout << "Hot compute nodes:\n";
@@ -203,7 +1137,7 @@ int main(int argc, char** argv)
             if (c->get_assign_count() == 0) {
                 break;
             }
-            std::cout << "    node: " << c->get_name() << " (" << c->get_cores() <<
+            std::cout << "    node: " << c->name() << " (" << c->get_cores() <<
                 " cores) ran " << c->get_assign_count() << " tasks\n";
         }
         std::cout << "Planner ticks: " << plan.get_required_ticks() << "\n";
@@ -211,60 +1145,123 @@ int main(int argc, char** argv)
         std::cout << "    not runnable, unmet dependencies: " << plan.get_count_dependency_wait() << "\n";
         std::cout << "    runnable, but waited for compute: " << plan.get_count_compute_wait() << "\n";
         std::cout << "Schedulings when all cores were busy: " << plan.get_count_all_cores_busy() << "\n";
+        if (!net.is_free()) {
+            std::cout << "Output moved between nodes: " << plan.get_transfer_size() << "\n";
+        }
+        if (reduce_deps) {
+            std::cout << "Implied dependencies removed: " << plan.get_reduced_dependency_count() << "\n";
+        }
+        if (plan.get_partition_count()) {
+            std::cout << "Partitions planned in parallel: " << plan.get_partition_count()
+                << " (" << plan.get_partition_cache_hits() << " reused)\n";
+        }
+        if (plan.get_node_class_count()) {
+            std::cout << "Node classes planned against: " << plan.get_node_class_count()
+                << " (" << comp.size() << " nodes)\n";
+        }
+        deadline_report(tasks);
 
         std::cout << "== Task analysis ==\n";
-        typedef std::priority_queue<task*, std::vector<task*>, task_waiters_sort> most_waited_list;
-        typedef std::priority_queue<task*, std::vector<task*>, task_dependencies_sort> most_dependent_list;
-        most_waited_list most_waited_on;
-        most_dependent_list most_dependencies;
-        for (task::list::iterator task_itr(tasks.begin());
-                task_itr != tasks.end();
-                ++task_itr) {
-            most_waited_on.push(task_itr->get());
-            most_dependencies.push(task_itr->get());
-        }
-
-        for (uint64_t ix(0); ix < max_show_count && ix < most_waited_on.size(); ++ix) {
-            task* t(most_waited_on.top());
-            task::ptr_list waiters(t->get_waiter_list());
+        std::vector<task*> most_waited_on(top_tasks<task_waiters_sort>(tasks, max_show_count));
+        std::vector<task*> most_dependencies(
+                top_tasks<task_dependencies_sort>(tasks, max_show_count));
+
+        for (uint64_t ix(0); ix < most_waited_on.size(); ++ix) {
+            task* t(most_waited_on[ix]);
+            task::ptr_range waiters(t->waiters());
             if (waiters.empty()) {
                 break;
             }
             if (ix == 0) {
                 std::cout << "Most waited on tasks:\n";
             }
-            std::cout << "    " << t->get_name() << ": " << t->get_waiter_count() << " waiters (";
-            for (task::ptr_list::iterator wait_itr(waiters.begin());
+            // dependency reduction unlinks waiters that still count
+            std::cout << "    " << t->name() << ": " << t->get_waiter_count() << " waiters";
+            if (waiters.size() != t->get_waiter_count()) {
+                std::cout << ", " << waiters.size() << " direct after dependency reduction";
+            }
+            std::cout << " (";
+            for (task::ptr_list::const_iterator wait_itr(waiters.begin());
                     wait_itr != waiters.end();
                     ++wait_itr) {
-                std::cout << (*wait_itr)->get_name() << ((wait_itr+1 != waiters.end()) ? ", " : ")\n");
-            }
-            most_waited_on.pop();
-            if (most_waited_on.empty()) {
-                break;
+                std::cout << (*wait_itr)->name() << ((wait_itr+1 != waiters.end()) ? ", " : ")\n");
             }
         }
-        for (uint64_t ix(0); ix < max_show_count && ix < most_dependencies.size(); ++ix) {
-            task* t(most_dependencies.top());
-            task::ptr_list deps(t->get_dependencies());
+        for (uint64_t ix(0); ix < most_dependencies.size(); ++ix) {
+            task* t(most_dependencies[ix]);
+            task::ptr_range deps(t->dependencies());
             if (deps.empty()) {
                 break;
             }
             if (ix == 0) {
                 std::cout << "Tasks with the most dependencies:\n";
             }
-            std::cout << "    " << t->get_name() << ": " << t->get_dependency_count() << " dependencies (";
-            for (task::ptr_list::iterator dep_itr(deps.begin());
+            std::cout << "    " << t->name() << ": " << t->get_dependency_count() << " dependencies (";
+            for (task::ptr_list::const_iterator dep_itr(deps.begin());
                     dep_itr != deps.end();
                     ++dep_itr) {
-                std::cout << (*dep_itr)->get_name() << ((dep_itr+1 != deps.end()) ? ", " : ")\n");
-            }
-            most_dependencies.pop();
-            if (most_dependencies.empty()) {
-                break;
+                std::cout << (*dep_itr)->name() << ((dep_itr+1 != deps.end()) ? ", " : ")\n");
             }
         }
         std::cout << "\n";
+
+        parallelism_profile(comp, tasks, plan.get_required_ticks());
+    }
+
+    if (slack && unsupported) {
+        std::cout << "Slack analysis doesn't model " << unsupported << ", skipped\n";
+    } else if (slack && !slack_report(comp, tasks, sched, plan.get_required_ticks(),
+                sensitivity_count, threads, show_slack, slack_file)) {
+        return 1;
+    }
+
+    if (mc_samples) {
+        if (std::find_if(tasks.begin(), tasks.end(), bind(&task::is_gang, _1)) != tasks.end()) {
+            std::cout << "Monte Carlo simulation doesn't model gang tasks, skipped\n";
+        } else if (std::find_if(comp.begin(), comp.end(),
+                    bind(&compute::has_unavailable, _1)) != comp.end()) {
+            std::cout << "Monte Carlo simulation doesn't model unavailable windows, skipped\n";
+        } else if (!net.is_free()) {
+            std::cout << "Monte Carlo simulation doesn't model data transfers, skipped\n";
+        } else if (std::find_if(tasks.begin(), tasks.end(),
+                    bind(&task::get_release_time, _1)) != tasks.end()) {
+            std::cout << "Monte Carlo simulation doesn't model release times, skipped\n";
+        } else {
+            monte_carlo(comp, tasks, sched, mc_samples, mc_replay == "plan",
+                    threads, seed);
+        }
+    }
+
+    // re-plan the same tasks in greedy mode to compare against this mode
+    if (compare) {
+        plan_summary mode_run(summarize(plan, comp, tasks));
+        bool partitioned(plan.get_partition_count() != 0);
+        bool classes(plan.get_node_class_count() != 0);
+        plan.reset();
+        plan.set_mode(planner::greedy);
+        plan.set_partitioned(false, threads);
+        plan.set_node_classes(false);
+        plan.schedule_tasks();
+        plan_summary greedy_run(summarize(plan, comp, tasks));
+        std::cout << "== Mode comparison ==\n";
+        std::string label(planner::mode_str[mode]);
+        if (partitioned) {
+            label += " partitioned";
+        }
+        if (classes) {
+            label += " node classes";
+        }
+        print_summary(label.c_str(), mode_run);
+        print_summary(planner::mode_str[planner::greedy], greedy_run);
+    }
+
+    if (cache) {
+        std::string output(capture->str());
+        capture.reset();
+        cache->store(cache_key, output);
+        if (plan_cache_stats) {
+            print_cache_stats(cache->get_stats());
+        }
     }
     return 0;
 }
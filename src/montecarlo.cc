@@ -0,0 +1,140 @@
+
+#include "montecarlo.h"
+#include "parallel.h"
+#include <algorithm>
+#include <assert.h>
+#include <boost/random/lognormal_distribution.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <cmath>
+
+namespace {
+    // draw an execution time, never less than one tick
+    uint64_t
+    sample_ticks(boost::random::mt19937& gen, task::distribution dist,
+            uint64_t mean, uint64_t spread)
+    {
+        double m(static_cast<double>(mean));
+        double s(static_cast<double>(spread));
+        double ticks(m);
+        switch (dist) {
+        case task::normal:
+            ticks = boost::random::normal_distribution<double>(m, s)(gen);
+            break;
+        case task::lognormal: {
+            // parameters of the underlying normal giving this mean and spread
+            double sigma2(std::log(1.0 + (s * s) / (m * m)));
+            double mu(std::log(m) - sigma2 / 2.0);
+            ticks = boost::random::lognormal_distribution<double>(
+                    mu, std::sqrt(sigma2))(gen);
+            break;
+        }
+        case task::uniform:
+            ticks = boost::random::uniform_real_distribution<double>(m - s, m + s)(gen);
+            break;
+        case task::fixed:
+            break;
+        }
+        if (ticks < 1.0) {
+            return 1;
+        }
+        return static_cast<uint64_t>(ticks + 0.5);
+    }
+
+    // value at the given percentile of a sorted list
+    uint64_t
+    percentile(const std::vector<uint64_t>& sorted, double pct)
+    {
+        assert(!sorted.empty());
+        size_t ix(static_cast<size_t>(std::ceil(pct / 100.0 * sorted.size())));
+        return sorted[ix ? ix - 1 : 0];
+    }
+}
+
+montecarlo::montecarlo(const sim_model& model, const task::list& tasks)
+    : _model(model)
+{
+    _dist.reserve(tasks.size());
+    _spread.reserve(tasks.size());
+    for (task::list::const_iterator itr(tasks.begin());
+            itr != tasks.end();
+            ++itr) {
+        _dist.push_back((*itr)->get_distribution());
+        _spread.push_back((*itr)->get_duration_spread());
+    }
+}
+
+//
+// run -- simulate the samples on several threads and summarize them
+//
+// Each thread fills its own slice of the makespan list and adds its
+// critical chain counts to the totals when it is done.
+//
+montecarlo::report
+montecarlo::run(uint64_t samples, unsigned threads, uint64_t seed,
+        const std::vector<sim_model::index_t>& rank,
+        const std::vector<sim_model::index_t>* fixed_node) const
+{
+    assert(samples > 0);
+    report rep;
+    rep.samples = samples;
+    rep.nominal = _model.simulate(_model.execution_times(), rank, fixed_node, NULL);
+    rep.critical_count.assign(_model.task_count(), 0);
+
+    std::vector<uint64_t> makespans(samples);
+    boost::mutex lock;
+    parallel::parallel_for(samples, threads,
+            boost::bind(&montecarlo::_run_range, this, _1, _2, seed, &rank,
+                fixed_node, &makespans, &rep.critical_count, &lock));
+
+    std::sort(makespans.begin(), makespans.end());
+    double total(0.0);
+    for (std::vector<uint64_t>::const_iterator itr(makespans.begin());
+            itr != makespans.end();
+            ++itr) {
+        total += *itr;
+    }
+    rep.min = makespans.front();
+    rep.max = makespans.back();
+    rep.mean = total / samples;
+    rep.p50 = percentile(makespans, 50.0);
+    rep.p95 = percentile(makespans, 95.0);
+    rep.p99 = percentile(makespans, 99.0);
+    return rep;
+}
+
+void
+montecarlo::_run_range(uint64_t begin, uint64_t end, uint64_t seed,
+        const std::vector<sim_model::index_t>* rank,
+        const std::vector<sim_model::index_t>* fixed_node,
+        std::vector<uint64_t>* makespans,
+        std::vector<uint64_t>* critical_count,
+        boost::mutex* lock) const
+{
+    const std::vector<uint64_t>& nominal(_model.execution_times());
+    std::vector<uint64_t> duration(nominal);
+    std::vector<uint64_t> counts(_model.task_count(), 0);
+    std::vector<sim_model::index_t> chain;
+    sim_model::result res;
+
+    for (uint64_t sample(begin); sample < end; ++sample) {
+        boost::random::mt19937 gen(static_cast<uint32_t>(seed + sample));
+        for (sim_model::index_t ix(0); ix < duration.size(); ++ix) {
+            duration[ix] = _dist[ix] == task::fixed ? nominal[ix] :
+                sample_ticks(gen, _dist[ix], nominal[ix], _spread[ix]);
+        }
+        (*makespans)[sample] = _model.simulate(duration, *rank, fixed_node, &res);
+        sim_model::critical_chain(res, &chain);
+        for (std::vector<sim_model::index_t>::const_iterator itr(chain.begin());
+                itr != chain.end();
+                ++itr) {
+            ++counts[*itr];
+        }
+    }
+
+    boost::mutex::scoped_lock guard(*lock);
+    for (sim_model::index_t ix(0); ix < counts.size(); ++ix) {
+        (*critical_count)[ix] += counts[ix];
+    }
+}
@@ -0,0 +1,82 @@
+
+#ifndef _montecarlo_h_
+#define _montecarlo_h_
+
+#include "sim.h"
+#include "task.h"
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class montecarlo
+ *
+ * Estimates the makespan distribution of a plan when task execution times
+ * are uncertain.  Each sample draws every task's execution time from its
+ * distribution (see task::set_duration_spread) and simulates either a fixed
+ * plan (same nodes, same start order) or the scheduling policy itself.
+ *
+ * Samples are split across threads.  Sample i always uses random seed
+ * seed + i, so results don't depend on the number of threads.
+ */
+class montecarlo
+{
+public:
+    /*
+     * @struct _report
+     *
+     * Summary of a Monte Carlo run.  critical_count[i] is the number of
+     * samples in which task i was on the critical chain.
+     */
+    struct _report {
+        uint64_t samples;
+        uint64_t nominal;       // makespan with nominal execution times
+        uint64_t min;
+        uint64_t max;
+        double mean;
+        uint64_t p50;
+        uint64_t p95;
+        uint64_t p99;
+        std::vector<uint64_t> critical_count;
+    };
+    typedef _report report;
+
+    /*
+     * montecarlo
+     *
+     * @param[in]  model  simulation model of the validated tasks
+     * @param[in]  tasks  tasks the model was built from, for their
+     *                    execution time distributions
+     */
+    montecarlo(const sim_model& model, const task::list& tasks);
+
+    /*
+     * run
+     *
+     * @param[in]  samples     number of sampled execution time sets
+     * @param[in]  threads     number of threads to simulate on
+     * @param[in]  seed        base random seed
+     * @param[in]  rank        task priority, lower values start first
+     * @param[in]  fixed_node  node of each task to replay a plan, or NULL to
+     *                         pick nodes as the policy would
+     *
+     * @return report of the makespan distribution
+     */
+    report run(uint64_t samples, unsigned threads, uint64_t seed,
+            const std::vector<sim_model::index_t>& rank,
+            const std::vector<sim_model::index_t>* fixed_node) const;
+
+private:
+    void _run_range(uint64_t begin, uint64_t end, uint64_t seed,
+            const std::vector<sim_model::index_t>* rank,
+            const std::vector<sim_model::index_t>* fixed_node,
+            std::vector<uint64_t>* makespans,
+            std::vector<uint64_t>* critical_count,
+            boost::mutex* lock) const;
+
+    const sim_model& _model;
+    std::vector<task::distribution> _dist;
+    std::vector<uint64_t> _spread;
+};
+
+#endif // _montecarlo_h_
@@ -0,0 +1,45 @@
+
+#include "network.h"
+
+network::network()
+    : _bandwidth(0), _latency(0)
+{
+}
+
+network::network(uint64_t bandwidth, uint64_t latency)
+    : _bandwidth(bandwidth), _latency(latency)
+{
+}
+
+bool
+network::is_free() const
+{
+    return _bandwidth == 0 && _latency == 0;
+}
+
+uint64_t
+network::transfer_ticks(uint64_t size) const
+{
+    if (size == 0) {
+        return 0;
+    }
+    if (_bandwidth == 0) {
+        return _latency;
+    }
+    return _latency + (size + _bandwidth - 1) / _bandwidth;
+}
+
+// friend ostream operator
+
+std::ostream&
+operator<<(std::ostream& os, const network& net)
+{
+    os << "bandwidth: ";
+    if (net._bandwidth) {
+        os << net._bandwidth;
+    } else {
+        os << "unlimited";
+    }
+    os << "; latency: " << net._latency;
+    return os;
+}
@@ -0,0 +1,59 @@
+
+#ifndef _network_h_
+#define _network_h_
+
+#include <ostream>
+#include <stdint.h>
+
+/*
+ * @class network
+ *
+ * Models the network between compute nodes.  When a task runs on a
+ * different node than one of its parent tasks, the parent's output has to
+ * be shipped first, which takes the latency plus the output size divided
+ * by the bandwidth.  The default network is free: transfers take no time.
+ */
+class network
+{
+public:
+    /*
+     * network
+     *
+     * Constructs a free network.
+     */
+    network();
+
+    /*
+     * network
+     *
+     * @param[in]  bandwidth  output size units transferred per tick
+     * @param[in]  latency    ticks added to every transfer
+     */
+    network(uint64_t bandwidth, uint64_t latency);
+
+    /*
+     * is_free
+     *
+     * @return true if transfers take no time
+     */
+    bool is_free() const;
+
+    /*
+     * transfer_ticks
+     *
+     * @param[in]  size  size of the data to move
+     *
+     * @return ticks to move the data between two nodes, 0 if size is 0
+     */
+    uint64_t transfer_ticks(uint64_t size) const;
+
+    friend std::ostream& operator<<(std::ostream& os, const network& net);
+
+private:
+    uint64_t _bandwidth;    // 0 is unlimited
+    uint64_t _latency;
+};
+
+std::ostream& operator<<(std::ostream& os, const network& net);
+
+#endif // _network_h_
@@ -0,0 +1,215 @@
+#include "optimizer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <cmath>
+#include <time.h>
+
+namespace {
+    typedef sim_model::index_t index_t;
+
+    // farthest a move takes a task in the start order
+    const index_t max_shift = 32;
+    // starting temperature, as a fraction of the starting makespan
+    const double start_temperature = 0.002;
+    // moves between looks at the clock
+    const uint64_t clock_interval = 16;
+    // accepted moves that keep the makespan between critical chain updates
+    const uint64_t chain_interval = 32;
+
+    double
+    now_seconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    // uniform pick from [0, count)
+    index_t
+    pick(boost::random::mt19937& gen, index_t count)
+    {
+        return boost::random::uniform_int_distribution<index_t>(0, count - 1)(gen);
+    }
+
+    // move the task at one position of the start order to another
+    void
+    shift_task(std::vector<index_t>* order, std::vector<index_t>* rank,
+            index_t from, index_t to)
+    {
+        index_t first(std::min(from, to));
+        index_t last(std::max(from, to));
+        if (to < from) {
+            std::rotate(order->begin() + to, order->begin() + from,
+                    order->begin() + from + 1);
+        } else {
+            std::rotate(order->begin() + from, order->begin() + from + 1,
+                    order->begin() + to + 1);
+        }
+        for (index_t pos(first); pos <= last; ++pos) {
+            (*rank)[(*order)[pos]] = pos;
+        }
+    }
+}
+
+optimizer::optimizer(const sim_model& model)
+    : _model(model)
+{
+    _host_begin.reserve(model.task_count() + 1);
+    for (index_t ix(0); ix < model.task_count(); ++ix) {
+        _host_begin.push_back(_hosts.size());
+        for (index_t node(0); node < model.node_count(); ++node) {
+            if (model.can_host(ix, node)) {
+                _hosts.push_back(node);
+            }
+        }
+    }
+    _host_begin.push_back(_hosts.size());
+}
+
+//
+// run -- search on several threads and keep the best plan
+//
+// Ties go to the lowest thread, so the choice doesn't depend on which
+// thread finishes first.
+//
+optimizer::result
+optimizer::run(double seconds, unsigned threads, uint64_t seed,
+        const std::vector<index_t>& rank, const std::vector<index_t>& node) const
+{
+    result start;
+    start.rank = rank;
+    start.node = node;
+    start.initial = _model.simulate(_model.execution_times(), rank, &node, NULL);
+    start.makespan = start.initial;
+    start.moves = 0;
+    start.improvements = 0;
+    if (_model.task_count() == 0 || threads == 0) {
+        return start;
+    }
+
+    std::vector<result> found(threads);
+    parallel::parallel_for(threads, threads,
+            boost::bind(&optimizer::_search, this, _1, _2, now_seconds() + seconds,
+                seed, &start, &found));
+
+    result* best(&start);
+    uint64_t moves(0);
+    uint64_t improvements(0);
+    for (std::vector<result>::iterator itr(found.begin()); itr != found.end(); ++itr) {
+        moves += itr->moves;
+        improvements += itr->improvements;
+        if (itr->makespan < best->makespan) {
+            best = &*itr;
+        }
+    }
+    best->moves = moves;
+    best->improvements = improvements;
+    return *best;
+}
+
+//
+// _search -- simulated annealing from the starting plan, one thread each
+//
+// 1. pick a task, from the critical chain half of the time
+// 2. move it up to max_shift places earlier or later in the start order,
+//    or onto another node that can host it
+// 3. simulate the plan; keep the move if the makespan didn't grow, or by
+//    chance if it did, more likely while the temperature is high
+// 4. otherwise undo the move
+// 5. cool linearly to 0 as the time runs out
+//
+void
+optimizer::_search(uint64_t begin, uint64_t end, double stop, uint64_t seed,
+        const result* start, std::vector<result>* found) const
+{
+    const std::vector<uint64_t>& duration(_model.execution_times());
+    index_t n(_model.task_count());
+    index_t window(std::min<index_t>(n - 1, max_shift));
+
+    for (uint64_t thread(begin); thread < end; ++thread) {
+        boost::random::mt19937 gen(static_cast<uint32_t>(seed + thread));
+        boost::random::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::vector<index_t> rank(start->rank);
+        std::vector<index_t> node(start->node);
+        std::vector<index_t> order(n);
+        for (index_t ix(0); ix < n; ++ix) {
+            order[rank[ix]] = ix;
+        }
+        sim_model::result res;
+        std::vector<index_t> chain;
+        uint64_t current(_model.simulate(duration, rank, &node, &res));
+        sim_model::critical_chain(res, &chain);
+
+        result& best((*found)[thread]);
+        best = *start;
+        double started(now_seconds());
+        double hottest(std::max(1.0, current * start_temperature));
+        double temperature(hottest);
+        uint64_t since_chain(0);
+        for (uint64_t move(0); ; ++move) {
+            if (move % clock_interval == 0) {
+                double now(now_seconds());
+                if (now >= stop) {
+                    break;
+                }
+                temperature = hottest * (stop - now) / std::max(stop - started, 1e-9);
+            }
+
+            // 1-2. pick a task and a move
+            index_t t(!chain.empty() && coin(gen) < 0.5 ?
+                    chain[pick(gen, chain.size())] : pick(gen, n));
+            index_t hosts(_host_begin[t + 1] - _host_begin[t]);
+            index_t kind(pick(gen, hosts > 1 ? 3 : 2));
+            index_t from(rank[t]);
+            index_t to(from);
+            index_t old_node(node[t]);
+            if (kind == 2) {
+                // any host but the current one
+                index_t h(pick(gen, hosts - 1));
+                node[t] = _hosts[_host_begin[t] + h];
+                if (node[t] == old_node) {
+                    node[t] = _hosts[_host_begin[t] + hosts - 1];
+                }
+            } else {
+                if (window == 0) {
+                    continue;
+                }
+                index_t shift(1 + pick(gen, window));
+                to = kind == 0 ? (from > shift ? from - shift : 0) :
+                    std::min<index_t>(n - 1, from + shift);
+                if (to == from) {
+                    continue;
+                }
+                shift_task(&order, &rank, from, to);
+            }
+
+            // 3. simulate and accept or 4. undo
+            uint64_t makespan(_model.simulate(duration, rank, &node, NULL));
+            ++best.moves;
+            if (makespan <= current ||
+                    coin(gen) < std::exp((static_cast<double>(current) - makespan) /
+                        temperature)) {
+                bool changed(makespan != current);
+                current = makespan;
+                if (current < best.makespan) {
+                    best.makespan = current;
+                    best.rank = rank;
+                    best.node = node;
+                    ++best.improvements;
+                }
+                if (changed || ++since_chain == chain_interval) {
+                    _model.simulate(duration, rank, &node, &res);
+                    sim_model::critical_chain(res, &chain);
+                    since_chain = 0;
+                }
+            } else if (kind == 2) {
+                node[t] = old_node;
+            } else {
+                shift_task(&order, &rank, to, from);
+            }
+        }
+    }
+}
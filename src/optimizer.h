@@ -0,0 +1,72 @@
+#ifndef _optimizer_h_
+#define _optimizer_h_
+
+#include "sim.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class optimizer
+ *
+ * Improves a plan by local search within a time budget.  A plan is a start
+ * order and a node for every task, replayed with sim_model::simulate().
+ * Moves take a task earlier or later in the order or onto another node
+ * that can host it; half of them pick a task on the critical chain of the
+ * current plan, as only those can shorten it.  A move that makes the plan
+ * longer is kept with a probability that falls with the time left
+ * (simulated annealing), so the search can leave a local minimum.
+ *
+ * Each thread searches from the same plan with its own random seed, seed
+ * + thread, and the shortest plan any of them found is returned.
+ */
+class optimizer
+{
+public:
+    /*
+     * @struct _result
+     *
+     * The best plan found, as a start position and a node per task.
+     */
+    struct _result {
+        uint64_t initial;       // makespan of the starting plan
+        uint64_t makespan;      // makespan of the best plan
+        std::vector<sim_model::index_t> rank;
+        std::vector<sim_model::index_t> node;
+        uint64_t moves;         // plans simulated, over all threads
+        uint64_t improvements;  // times a thread found a shorter plan
+    };
+    typedef _result result;
+
+    /*
+     * optimizer
+     *
+     * @param[in]  model  simulation model of the validated tasks
+     */
+    optimizer(const sim_model& model);
+
+    /*
+     * run
+     *
+     * @param[in]  seconds  time budget
+     * @param[in]  threads  number of threads to search on
+     * @param[in]  seed     base random seed
+     * @param[in]  rank     start position of each task in the starting plan,
+     *                      a permutation of the task indexes
+     * @param[in]  node     node of each task in the starting plan
+     *
+     * @return the best plan found, the starting plan if none was shorter
+     */
+    result run(double seconds, unsigned threads, uint64_t seed,
+            const std::vector<sim_model::index_t>& rank,
+            const std::vector<sim_model::index_t>& node) const;
+
+private:
+    void _search(uint64_t begin, uint64_t end, double stop, uint64_t seed,
+            const result* start, std::vector<result>* found) const;
+
+    const sim_model& _model;
+    std::vector<sim_model::index_t> _host_begin;    // CSR offsets into _hosts
+    std::vector<sim_model::index_t> _hosts;         // nodes that can host each task
+};
+
+#endif // _optimizer_h_
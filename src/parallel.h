@@ -0,0 +1,59 @@
+
+#ifndef _parallel_h_
+#define _parallel_h_
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <stdint.h>
+
+namespace parallel {
+    /*
+     * default_threads
+     *
+     * @return number of hardware threads, at least 1
+     */
+    inline unsigned
+    default_threads()
+    {
+        unsigned n(boost::thread::hardware_concurrency());
+        return n ? n : 1;
+    }
+
+    /*
+     * parallel_for
+     *
+     * Splits the range [0, count) into one contiguous chunk per thread and
+     * calls fn(begin, end) for each chunk on its own thread.  The calling
+     * thread runs the first chunk and waits for the others to finish.
+     *
+     * @param[in]  count    size of the range
+     * @param[in]  threads  number of threads to use
+     * @param[in]  fn       functor called as fn(uint64_t begin, uint64_t end)
+     */
+    template<typename F>
+    void
+    parallel_for(uint64_t count, unsigned threads, F fn)
+    {
+        if (threads == 0) {
+            threads = 1;
+        }
+        if (threads > count) {
+            threads = count ? count : 1;
+        }
+        uint64_t chunk((count + threads - 1) / threads);
+        boost::thread_group group;
+        for (unsigned ix(1); ix < threads; ++ix) {
+            uint64_t begin(ix * chunk);
+            uint64_t end(std::min(count, begin + chunk));
+            if (begin >= end) {
+                break;
+            }
+            group.create_thread(boost::bind<void>(fn, begin, end));
+        }
+        fn(static_cast<uint64_t>(0), std::min(count, chunk));
+        group.join_all();
+    }
+}
+
+#endif // _parallel_h_
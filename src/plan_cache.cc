@@ -0,0 +1,255 @@
+
+#include "plan_cache.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <vector>
+
+namespace {
+    const char* entry_suffix = ".plan";
+    const char* entry_header = "# plan_cache ";
+
+    struct cache_entry {
+        std::string path;
+        uint64_t size;
+        time_t sec;
+        long nsec;
+    };
+
+    // orders entries from least to most recently used
+    bool lru_sort(const cache_entry& lhs, const cache_entry& rhs)
+    {
+        if (lhs.sec != rhs.sec) {
+            return lhs.sec < rhs.sec;
+        }
+        if (lhs.nsec != rhs.nsec) {
+            return lhs.nsec < rhs.nsec;
+        }
+        return lhs.path < rhs.path;
+    }
+
+    std::vector<cache_entry>
+    list_entries(const std::string& dir)
+    {
+        std::vector<cache_entry> entries;
+        DIR* dp(opendir(dir.c_str()));
+        if (dp == NULL) {
+            return entries;
+        }
+        const std::string suffix(entry_suffix);
+        struct dirent* de;
+        while ((de = readdir(dp)) != NULL) {
+            std::string name(de->d_name);
+            if (name.size() <= suffix.size() ||
+                    name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            cache_entry e;
+            e.path = dir + "/" + name;
+            struct stat st;
+            if (stat(e.path.c_str(), &st) != 0) {
+                continue;
+            }
+            e.size = st.st_size;
+            e.sec = st.st_mtim.tv_sec;
+            e.nsec = st.st_mtim.tv_nsec;
+            entries.push_back(e);
+        }
+        closedir(dp);
+        return entries;
+    }
+}
+
+plan_cache::plan_cache(const std::string& dir, uint64_t max_bytes)
+    : _dir(dir),
+    _max_bytes(max_bytes)
+{
+}
+
+//
+// key -- hash of the canonical form of the inputs
+//
+// The canonical form lists every parsed field of each node and task in
+// file order, so only the content of the files matters, not the way it is
+// written.  The entry name holds the hash and the length of that form.
+//
+std::string
+plan_cache::key(const compute::list& comp, const task::list& tasks,
+        const network& net, const std::string& options)
+{
+    std::ostringstream canon;
+    canon << options << "\n" << net << "\n";
+    for (compute::list::const_iterator itr(comp.begin()); itr != comp.end(); ++itr) {
+        canon << (*itr)->name() << " " << (*itr)->get_cores() << " "
+            << (*itr)->get_speed() << " " << (*itr)->get_resources();
+        const compute::window_map& down((*itr)->get_unavailable());
+        for (compute::window_map::const_iterator win(down.begin()); win != down.end(); ++win) {
+            canon << " " << win->first << "-" << win->second;
+        }
+        canon << "\n";
+    }
+    for (task::list::const_iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+        canon << (*itr)->name() << " " << (*itr)->get_cores_required() << " "
+            << (*itr)->get_execution_time() << " "
+            << task::distribution_str[(*itr)->get_distribution()] << " "
+            << (*itr)->get_duration_spread() << " " << (*itr)->get_resources() << " "
+            << (*itr)->get_output_size() << " " << (*itr)->get_release_time() << " "
+            << (*itr)->get_deadline() << " " << (*itr)->get_priority();
+        if ((*itr)->is_gang()) {
+            canon << " gang " << (*itr)->get_max_nodes();
+        }
+        if ((*itr)->is_moldable()) {
+            canon << " " << (*itr)->get_min_cores() << "-" << (*itr)->get_max_cores();
+            for (uint64_t cores((*itr)->get_min_cores());
+                    cores <= (*itr)->get_max_cores();
+                    ++cores) {
+                canon << " " << (*itr)->get_execution_time_on(cores);
+            }
+        }
+        std::vector<std::string> parents((*itr)->get_parent_names());
+        for (std::vector<std::string>::const_iterator parent(parents.begin());
+                parent != parents.end();
+                ++parent) {
+            canon << " " << *parent;
+        }
+        canon << "\n";
+    }
+    std::string data(canon.str());
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%08llx",
+            static_cast<unsigned long long>(fnv1a(data)),
+            static_cast<unsigned long long>(data.size() & 0xffffffffULL));
+    return name;
+}
+
+bool
+plan_cache::load(const std::string& key, std::string* output)
+{
+    std::string path(_path(key));
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string header;
+    if (!in || !std::getline(in, header) || header != entry_header + key) {
+        _count(&stats::misses, 1);
+        return false;
+    }
+    std::ostringstream body;
+    body << in.rdbuf();
+    *output = body.str();
+
+    // mark as recently used
+    utime(path.c_str(), NULL);
+    _count(&stats::hits, 1);
+    return true;
+}
+
+void
+plan_cache::store(const std::string& key, const std::string& output)
+{
+    std::string header(entry_header + key + "\n");
+    if (header.size() + output.size() > _max_bytes) {
+        return;
+    }
+    std::string path(_path(key));
+    std::string tmp(path + ".tmp");
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary);
+        out << header << output;
+        if (!out) {
+            remove(tmp.c_str());
+            return;
+        }
+    }
+    rename(tmp.c_str(), path.c_str());
+    _evict();
+}
+
+plan_cache::stats
+plan_cache::get_stats() const
+{
+    stats st(_read_counters());
+    std::vector<cache_entry> entries(list_entries(_dir));
+    for (std::vector<cache_entry>::const_iterator itr(entries.begin());
+            itr != entries.end();
+            ++itr) {
+        ++st.entries;
+        st.bytes += itr->size;
+    }
+    return st;
+}
+
+std::string
+plan_cache::_path(const std::string& key) const
+{
+    return _dir + "/" + key + entry_suffix;
+}
+
+plan_cache::stats
+plan_cache::_read_counters() const
+{
+    stats st = { 0, 0, 0, 0, 0 };
+    std::ifstream in((_dir + "/stats").c_str());
+    std::string label;
+    uint64_t value;
+    while (in >> label >> value) {
+        if (label == "hits") {
+            st.hits = value;
+        } else if (label == "misses") {
+            st.misses = value;
+        } else if (label == "evictions") {
+            st.evictions = value;
+        }
+    }
+    return st;
+}
+
+// _evict -- remove least recently used entries until the cache fits
+void
+plan_cache::_evict()
+{
+    std::vector<cache_entry> entries(list_entries(_dir));
+    uint64_t bytes(0);
+    for (std::vector<cache_entry>::const_iterator itr(entries.begin());
+            itr != entries.end();
+            ++itr) {
+        bytes += itr->size;
+    }
+    std::sort(entries.begin(), entries.end(), lru_sort);
+    uint64_t evicted(0);
+    for (std::vector<cache_entry>::const_iterator itr(entries.begin());
+            itr != entries.end() && bytes > _max_bytes;
+            ++itr) {
+        if (remove(itr->path.c_str()) == 0) {
+            bytes -= itr->size;
+            ++evicted;
+        }
+    }
+    if (evicted) {
+        _count(&stats::evictions, evicted);
+    }
+}
+
+// _count -- add to one of the counters kept in the stats file
+void
+plan_cache::_count(uint64_t stats::* counter, uint64_t amount)
+{
+    stats st(_read_counters());
+    st.*counter += amount;
+    std::string path(_dir + "/stats");
+    std::string tmp(path + ".tmp");
+    {
+        std::ofstream out(tmp.c_str());
+        out << "hits " << st.hits << "\nmisses " << st.misses
+            << "\nevictions " << st.evictions << "\n";
+        if (!out) {
+            remove(tmp.c_str());
+            return;
+        }
+    }
+    rename(tmp.c_str(), path.c_str());
+}
@@ -0,0 +1,105 @@
+
+#ifndef _plan_cache_h_
+#define _plan_cache_h_
+
+#include "compute.h"
+#include "network.h"
+#include "task.h"
+#include <stdint.h>
+#include <string>
+
+/*
+ * @class plan_cache
+ *
+ * On-disk cache of planner output.  Each entry is named after a hash of
+ * the parsed compute nodes, network and tasks plus the options that
+ * affect the output, so inputs that only differ in formatting, comments
+ * or key order share an entry.  Entries are evicted least recently used
+ * first once the directory grows past its size limit.
+ *
+ * Hit, miss and eviction counts are kept in the directory across runs.
+ */
+class plan_cache
+{
+public:
+    /*
+     * @struct _stats
+     *
+     * Cache statistics: counts over all runs using the directory and the
+     * entries currently in it.
+     */
+    struct _stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t entries;
+        uint64_t bytes;
+    };
+    typedef _stats stats;
+
+    /*
+     * plan_cache
+     *
+     * @param[in]  dir        existing directory holding the entries
+     * @param[in]  max_bytes  size limit of all entries together
+     */
+    plan_cache(const std::string& dir, uint64_t max_bytes);
+
+    /*
+     * key
+     *
+     * Hashes the parsed inputs into an entry name.  Task and node order is
+     * kept since it breaks ties in the planner.
+     *
+     * @param[in]  comp     compute nodes
+     * @param[in]  tasks    tasks, before validation
+     * @param[in]  net      network between the nodes
+     * @param[in]  options  mode and options that change the output
+     *
+     * @return entry name
+     */
+    static std::string key(const compute::list& comp, const task::list& tasks,
+            const network& net, const std::string& options);
+
+    /*
+     * load
+     *
+     * Looks up an entry and marks it as recently used.
+     *
+     * @param[in]  key     entry name from key()
+     * @param[out] output  stored output
+     *
+     * @return true on a hit
+     */
+    bool load(const std::string& key, std::string* output);
+
+    /*
+     * store
+     *
+     * Saves an entry, then evicts the least recently used entries until
+     * the cache fits its size limit.  An entry larger than the limit is
+     * not stored.
+     *
+     * @param[in]  key     entry name from key()
+     * @param[in]  output  output to store
+     */
+    void store(const std::string& key, const std::string& output);
+
+    /*
+     * get_stats
+     *
+     * @return statistics, including this run
+     */
+    stats get_stats() const;
+
+private:
+    std::string _path(const std::string& key) const;
+    stats _read_counters() const;
+    void _evict();
+    void _count(uint64_t stats::* counter, uint64_t amount);
+
+    std::string _dir;
+    uint64_t _max_bytes;
+};
+
+#endif // _plan_cache_h_
@@ -1,21 +1,43 @@
 
 #include "planner.h"
+#include "hash.h"
+#include "parallel.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <boost/bind.hpp>
 #include <boost/graph/topological_sort.hpp>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <stdio.h>
 #include <unistd.h>
 #include <utility>
 
 const char* planner::status_str[] = {
     "Ok",
     "Core capacity exceeded by task input.",
+    "Resource capacity exceeded by task input.",
     "Missing dependency in task description.",
     "Circular dependency in task description."
 };
 
+const char* planner::mode_str[] = {
+    "greedy",
+    "dominant_fit",
+    "backfill",
+    "conservative_backfill",
+    "eft",
+    "locality",
+    "least_slack"
+};
+
 using namespace boost;
 
 namespace {
@@ -33,12 +55,279 @@ namespace {
         return rt->get_cores_required() < lt->get_cores_required();
     }
 
+    // Earliest finish time order: the longest critical path from the task
+    // to the end of the graph first.
+    class rank_task_sort {
+    public:
+        rank_task_sort(const std::vector<uint64_t>& rank)
+            : _rank(rank)
+        {
+        }
+        bool operator()(const task* rt, const task* lt) const
+        {
+            if (_rank[rt->get_id()] == _rank[lt->get_id()]) {
+                return runnable_task_sort(rt, lt);
+            }
+            return _rank[rt->get_id()] < _rank[lt->get_id()];
+        }
+    private:
+        const std::vector<uint64_t>& _rank;
+    };
+
+    // Fixed plan order: the lowest position first
+    class fixed_task_sort {
+    public:
+        fixed_task_sort(const std::vector<uint64_t>& order)
+            : _order(order)
+        {
+        }
+        bool operator()(const task* rt, const task* lt) const
+        {
+            return _order[rt->get_id()] > _order[lt->get_id()];
+        }
+    private:
+        const std::vector<uint64_t>& _order;
+    };
+
+    // Least slack order: tasks that can no longer meet their effective
+    // deadline by weight, then the others by latest start, then tasks
+    // without a deadline by critical path.
+    class slack_task_sort {
+    public:
+        slack_task_sort(const std::vector<uint64_t>& latest_finish,
+                const std::vector<uint64_t>& weight,
+                const std::vector<uint64_t>& rank, uint64_t now)
+            : _latest_finish(latest_finish), _weight(weight), _rank(rank), _now(now)
+        {
+        }
+        bool operator()(const task* rt, const task* lt) const
+        {
+            int rclass(urgency(rt)), lclass(urgency(lt));
+            if (rclass != lclass) {
+                return rclass < lclass;
+            }
+            if (rclass == late && _weight[rt->get_id()] != _weight[lt->get_id()]) {
+                return _weight[rt->get_id()] < _weight[lt->get_id()];
+            }
+            if (rclass != unbounded && start(rt) != start(lt)) {
+                return start(rt) > start(lt);
+            }
+            if (_weight[rt->get_id()] != _weight[lt->get_id()]) {
+                return _weight[rt->get_id()] < _weight[lt->get_id()];
+            }
+            if (_rank[rt->get_id()] != _rank[lt->get_id()]) {
+                return _rank[rt->get_id()] < _rank[lt->get_id()];
+            }
+            return runnable_task_sort(rt, lt);
+        }
+    private:
+        enum { unbounded, slack, late };
+
+        // latest tick the task can start and still meet its deadline
+        uint64_t start(const task* t) const
+        {
+            uint64_t finish(_latest_finish[t->get_id()]);
+            uint64_t ticks(t->get_ticks_at(task::unit_speed));
+            return finish > ticks ? finish - ticks : 0;
+        }
+        int urgency(const task* t) const
+        {
+            if (_latest_finish[t->get_id()] == task::no_deadline) {
+                return unbounded;
+            }
+            return start(t) <= _now ? late : slack;
+        }
+
+        const std::vector<uint64_t>& _latest_finish;
+        const std::vector<uint64_t>& _weight;
+        const std::vector<uint64_t>& _rank;
+        uint64_t _now;
+    };
+
+    // Dominant resource share of a task: the largest fraction of the
+    // cluster's cores or of any other resource that the task requires.
+    class dominant_task_sort {
+    public:
+        dominant_task_sort(uint64_t cores, const resource_set& res)
+            : _cores(cores), _res(res)
+        {
+        }
+        double share(const task* t) const
+        {
+            double s(static_cast<double>(t->get_cores_required()) /
+                    static_cast<double>(_cores));
+            for (resource_set::dim_t dim(0);
+                    dim < resource_set::dimension_count();
+                    ++dim) {
+                if (_res.get(dim)) {
+                    s = std::max(s, static_cast<double>(t->get_resources().get(dim)) /
+                            static_cast<double>(_res.get(dim)));
+                }
+            }
+            return s;
+        }
+        bool operator()(const task* rt, const task* lt) const
+        {
+            double rs(share(rt));
+            double ls(share(lt));
+            if (rs == ls) {
+                return rt->get_waiter_count() < lt->get_waiter_count();
+            }
+            return rs < ls;
+        }
+    private:
+        uint64_t _cores;
+        resource_set _res;
+    };
+
+    // Conservative backfilling reserves for at most this many blocked tasks
+    // per scheduling round; checking every runnable task against every
+    // node's timeline is quadratic in the number of reservations.
+    const uint64_t conservative_depth = 16;
+
     template<typename T>
-    bool sort_max_cores(T rhs, T lhs) 
+    bool sort_max_cores(const T& rhs, const T& lhs)
     {
         return rhs->get_cores_available() < lhs->get_cores_available();
     }
 
+    template<typename T>
+    bool sort_total_cores(const T& rhs, const T& lhs)
+    {
+        return rhs->get_cores() < lhs->get_cores();
+    }
+
+    // union-find root of a task id, with path halving
+    uint64_t find_root(std::vector<uint64_t>& parent, uint64_t id)
+    {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    }
+
+    // biggest core count and resources of any task in the list
+    void max_requirement(const task::list& tasks, uint64_t* cores,
+            resource_set* res)
+    {
+        *cores = 0;
+        *res = resource_set();
+        for (task::list::const_iterator itr(tasks.begin());
+                itr != tasks.end();
+                ++itr) {
+            *cores = std::max(*cores, (*itr)->get_cores_required());
+            for (resource_set::dim_t dim(0);
+                    dim < resource_set::dimension_count();
+                    ++dim) {
+                res->set(dim, std::max(res->get(dim), (*itr)->get_resources().get(dim)));
+            }
+        }
+    }
+
+    // orders indexes by a key, biggest first
+    class key_sort {
+    public:
+        key_sort(const std::vector<uint64_t>& key)
+            : _key(key)
+        {
+        }
+        bool operator()(uint64_t lhs, uint64_t rhs) const
+        {
+            return _key[lhs] > _key[rhs];
+        }
+    private:
+        const std::vector<uint64_t>& _key;
+    };
+
+    // a task placement read from the component cache
+    struct cached_placement {
+        task* t;
+        compute* c;
+        uint64_t start;
+        uint64_t finish;
+        uint64_t cores;
+    };
+
+    // transitive reduction window, in positions; a multiple of 64
+    const uint64_t reduce_window = 4096;
+    // tasks per thread below which a level of the level sort is expanded
+    // on the calling thread alone
+    const uint64_t level_grain = 1024;
+    // reachability bitsets per thread, in bytes; the window narrows to fit
+    const uint64_t reduce_memory = 64 << 20;
+    const uint64_t no_pos = UINT64_MAX;
+
+    // a task running on a node of a class, until its finish tick
+    struct class_run {
+        uint64_t finish;
+        uint64_t seq;               // placement order, breaks ties
+        task* t;
+        uint64_t node;
+    };
+
+    // orders class runs so that a priority queue yields the first to finish
+    bool class_run_later(const class_run& lhs, const class_run& rhs)
+    {
+        if (lhs.finish == rhs.finish) {
+            return lhs.seq > rhs.seq;
+        }
+        return lhs.finish > rhs.finish;
+    }
+
+    // a runnable task's place in greedy mode's order: the most cores
+    // first, then the most waiters, then job sequence order
+    struct ready_key {
+        uint64_t cores;
+        uint64_t waiters;
+        uint64_t pos;
+        task* t;
+        bool operator<(const ready_key& rhs) const
+        {
+            if (cores != rhs.cores) {
+                return cores > rhs.cores;
+            }
+            if (waiters != rhs.waiters) {
+                return waiters > rhs.waiters;
+            }
+            return pos < rhs.pos;
+        }
+    };
+
+    ready_key make_ready_key(task* t, uint64_t pos)
+    {
+        ready_key key = { t->get_cores_required(), t->get_waiter_count(), pos, t };
+        return key;
+    }
+
+    // orders ready keys so that a priority queue yields the first released
+    bool release_later(const ready_key& lhs, const ready_key& rhs)
+    {
+        if (lhs.t->get_release_time() == rhs.t->get_release_time()) {
+            return lhs.pos > rhs.pos;
+        }
+        return lhs.t->get_release_time() > rhs.t->get_release_time();
+    }
+
+    // moves a node between the free core buckets of its class, keeping
+    // each node's slot in its bucket up to date
+    void move_node(std::vector<std::vector<uint64_t> >& free_nodes,
+            std::vector<uint64_t>& slot, uint64_t node, uint64_t from, uint64_t to)
+    {
+        std::vector<uint64_t>& bucket(free_nodes[from]);
+        bucket[slot[node]] = bucket.back();
+        slot[bucket.back()] = slot[node];
+        bucket.pop_back();
+        slot[node] = free_nodes[to].size();
+        free_nodes[to].push_back(node);
+    }
+
+    // orders schedule entries by the tick their task started on
+    bool start_tick_sort(planner::schedule_entry lhs, planner::schedule_entry rhs)
+    {
+        return lhs.get_task()->get_start_tick() < rhs.get_task()->get_start_tick();
+    }
+
     template<typename T>
     void print_list(const T& cont, const std::string& sep)
     {
@@ -56,9 +345,20 @@ planner::schedule_entry::schedule_entry(task* t, compute* c)
 {
 }
 
+planner::schedule_sink::~schedule_sink()
+{
+}
+
+const uint64_t planner::unbounded;
+
 planner::planner(compute::list* comp, task::list* task)
-    : _comp(comp), _tasks(task), _tasks_validated(false), _required_ticks(0),
-    _count_dep_wait(0), _count_comp_unavail(0), _all_cores_busy(0), _last_task(0)
+    : _comp(comp), _tasks(task), _tasks_validated(false), _mode(greedy),
+    _rank_stale(true), _sink(0), _tasks_remaining(0), _required_ticks(0),
+    _count_dep_wait(0), _count_comp_unavail(0), _all_cores_busy(0),
+    _next_wake(compute::never_fits), _transfer_size(0), _partitioned(false),
+    _threads(1), _partition_count(0), _partition_cache_hits(0), _reduce_deps(false),
+    _reduced_deps(0), _level_order(false), _node_classes(false), _node_class_count(0),
+    _max_cores(0), _gang_fewest_nodes(false), _edge_log(NULL), _last_task(0)
 {                                                                             
 }
 
@@ -66,51 +366,80 @@ planner::planner(compute::list* comp, task::list* task)
 // validate_tasks -- check all tasks and compute for validity, build initial schedule
 //
 // 1. find the max core count; we can't run tasks that exceed this number
-// 2. for each task,
+// 2. for each task, in parallel,
 //   3. verify core count is ok
-//   4. map the task dependencies
-//   5. create graph edges representing each task and its dependencies
-// 6. add all dependency edges to the graph
-// 7. perform a topological sort
+//   4. look up the task dependencies
+// 5. link the tasks to the dependencies they wait on
+// 6. create graph edges representing each task and its dependencies
+// 7. add all dependency edges to the graph
+// 8. sort the tasks level by level, finding their depths and any cycle
+// 9. perform a topological sort, unless the level order is used
+// 10. optionally remove implied dependencies
 //
 planner::status
 planner::validate_tasks()
 {
+    task::ptr_list disconnected_nodes;
+    task* artificial_dep = NULL;
+
     // find the most compute we have on any compute resource
     compute::list::const_iterator max_comp(std::max_element(
-            _comp->begin(), _comp->end(), sort_max_cores<compute::ptr>));
+            _comp->begin(), _comp->end(), sort_total_cores<compute::ptr>));
+    _max_cores = max_comp == _comp->end() ? 0 : (*max_comp)->get_cores();
+    std::vector<uint64_t> node_cores;
+    for (compute::list::const_iterator itr(_comp->begin()); itr != _comp->end(); ++itr) {
+        node_cores.push_back((*itr)->get_cores());
+    }
+    std::sort(node_cores.begin(), node_cores.end(), std::greater<uint64_t>());
+    _top_cores.assign(1, 0);
+    for (uint64_t ix(0); ix < node_cores.size(); ++ix) {
+        _top_cores.push_back(_top_cores.back() + node_cores[ix]);
+    }
 
-    task::ptr_list disconnected_nodes;
-    task* artificial_dep = NULL;
+    // check capacities and look up dependencies concurrently, then report
+    // the first task that fails, as checking them in order would
+    std::vector<status> task_rc(_tasks->size(), ok);
+    parallel::parallel_for(_tasks->size(), _threads,
+            bind(&planner::_map_tasks, this, _1, _2, &task_rc));
+    uint64_t failed(std::find_if(task_rc.begin(), task_rc.end(),
+                bind(std::not_equal_to<status>(), _1, ok)) - task_rc.begin());
+    uint64_t mapped(failed);
+    if (failed < _tasks->size() && task_rc[failed] == missing_dependency) {
+        ++mapped;       // its dependencies that were found are kept
+    }
+    for (uint64_t ix(mapped); ix < _tasks->size(); ++ix) {
+        (*_tasks)[ix]->unresolve_dependencies();
+    }
+    task::link_waiters(*_tasks, mapped, _threads);
+    if (failed < _tasks->size()) {
+        _last_task = (*_tasks)[failed].get();
+        return task_rc[failed];
+    }
+
+    // by task id, whether a task seen so far depends on it
+    std::vector<char> waited_on;
 
     _edge.reserve(_tasks->size()*4);
-    for (task::list::iterator itr(_tasks->begin()) ; 
+    for (task::list::iterator itr(_tasks->begin()) ;
             itr != _tasks->end();
             ++itr) {
 
-        // validate that cores requirements aren't exceeded
-        if ((*itr)->get_cores_required() > (*max_comp)->get_cores()) {
-            return compute_exceeded;
-        }
-        
-        // validate that task dependencies are met
-        bool ok = (*itr)->map_dependencies();
-        if (!ok) {
-            _last_task = (*itr).get();
-            return missing_dependency;
-        }
-
         // add all edges to the list
-        task::ptr_list all_deps((*itr)->get_dependencies()); 
+        task::ptr_range all_deps((*itr)->dependencies());
         for (task::ptr_list::const_iterator dep(all_deps.begin());
                 dep != all_deps.end();
                 ++dep) {
             _edge.push_back(std::make_pair((*itr)->get_id(), (*dep)->get_id()));
+            if (waited_on.size() <= (*dep)->get_id()) {
+                waited_on.resize((*dep)->get_id() + 1, 0);
+            }
+            waited_on[(*dep)->get_id()] = 1;
         }
 
-        // keep track of disconnected tasks
-        if ((*itr)->get_waiter_count() == 0 &&
-                    (*itr)->get_dependency_count() == 0) {
+        // keep track of disconnected tasks: no dependencies, and no task
+        // before it depends on it
+        if ((*itr)->get_dependency_count() == 0 &&
+                ((*itr)->get_id() >= waited_on.size() || !waited_on[(*itr)->get_id()])) {
             disconnected_nodes.push_back(itr->get());
         }
 
@@ -121,6 +450,7 @@ planner::validate_tasks()
 
     // add nodes that are disconnected from the graph back with an artificial
     // dependency
+    uint64_t dep_edges(_edge.size());
     for (task::ptr_list::iterator dis_itr(disconnected_nodes.begin());
             dis_itr != disconnected_nodes.end();
             ++dis_itr) {
@@ -134,38 +464,476 @@ planner::validate_tasks()
     for (graph_edge_list::const_iterator itr(_edge.begin());
                 itr != _edge.end();
                 ++itr) {
-        boost::add_edge(itr->first, itr->second, _tg);
-        std::cout << "adding edge: " << itr->first << " -> " << itr->second << "\n";
+        if (!_level_order) {
+            boost::add_edge(itr->first, itr->second, _tg);
+        }
+        if (_edge_log) {
+            *_edge_log << "adding edge: " << itr->first << " -> " << itr->second << "\n";
+        }
+    }
+
+    // sort the tasks level by level, which finds their depths and any cycle
+    sched_container levels;
+    status rc(_sort_levels(&levels));
+    if (rc != ok) {
+        return rc;
     }
 
     // topological sort
-    try {
+    if (_level_order) {
+        _job_sequence.swap(levels);
+    } else {
+        // a task alone has no edge to make it a vertex
+        if (_edge.empty() && !_tasks->empty()) {
+            while (boost::num_vertices(_tg) <= _tasks->front()->get_id()) {
+                boost::add_vertex(_tg);
+            }
+        }
         boost::topological_sort(_tg,
                 std::back_inserter(_job_sequence));
-    } catch (boost::not_a_dag e_dag) {
-        return circular_dependency;
+        if (_job_sequence.size() > _tasks->size()) {
+            // the ids of other planners' tasks below ours are vertices too
+            std::vector<char> ours(_job_sequence.size(), 0);
+            for (task::list::const_iterator itr(_tasks->begin());
+                    itr != _tasks->end();
+                    ++itr) {
+                ours[(*itr)->get_id()] = 1;
+            }
+            sched_container kept;
+            kept.reserve(_tasks->size());
+            for (sched_container::const_iterator itr(_job_sequence.begin());
+                    itr != _job_sequence.end();
+                    ++itr) {
+                if (ours[*itr]) {
+                    kept.push_back(*itr);
+                }
+            }
+            _job_sequence.swap(kept);
+        }
     }
 
+    if (_reduce_deps) {
+        _reduce_dependencies(dep_edges);
+    }
+
+    _tasks_remaining = _tasks->size();
     _tasks_validated = true;
     return ok;
 }
 
+//
+// _sort_levels -- level-synchronous topological sort
+//
+// Tasks without dependencies are on level 0.  The tasks of each level are
+// expanded concurrently: each one takes one off the count of unfinished
+// dependencies of every task waiting on it, and a waiter whose count
+// drops to 0 is on the next level.  Which thread finds a waiter depends
+// on timing, so every level is sorted by task id, which makes the order
+// the same on any number of threads.
+//
+// A level only gets as many threads as it has level_grain tasks for, so
+// narrow levels don't pay for starting threads.
+//
+// Tasks on a cycle never get their count down to 0.  If any are left,
+// one cycle is found by following unfinished dependencies from the first
+// of them until a task repeats.
+//
+planner::status
+planner::_sort_levels(sched_container* order)
+{
+    uint64_t id_count(0);
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        id_count = std::max(id_count, (*itr)->get_id() + 1);
+    }
+    std::vector<uint64_t> deps_left(id_count, 0);
+    _depth.assign(id_count, 0);
+    _cycle.clear();
+
+    sched_container frontier;
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        deps_left[(*itr)->get_id()] = (*itr)->get_dependency_count();
+        if (deps_left[(*itr)->get_id()] == 0) {
+            frontier.push_back((*itr)->get_id());
+        }
+    }
+    std::sort(frontier.begin(), frontier.end());
+
+    order->clear();
+    order->reserve(_tasks->size());
+    boost::mutex lock;
+    for (uint64_t level(0); !frontier.empty(); ++level) {
+        sched_container next;
+        order->insert(order->end(), frontier.begin(), frontier.end());
+        unsigned threads(std::min<uint64_t>(_threads,
+                    std::max<uint64_t>(1, frontier.size() / level_grain)));
+        parallel::parallel_for(frontier.size(), threads,
+                bind(&planner::_expand_level, this, _1, _2, level,
+                    &frontier, &deps_left, &next, &lock));
+        std::sort(next.begin(), next.end());
+        frontier.swap(next);
+    }
+    if (order->size() == _tasks->size()) {
+        return ok;
+    }
+
+    // walk back through unfinished dependencies until a task repeats
+    task* t(NULL);
+    for (task::list::const_iterator itr(_tasks->begin());
+            t == NULL && itr != _tasks->end();
+            ++itr) {
+        if (deps_left[(*itr)->get_id()] != 0) {
+            t = itr->get();
+        }
+    }
+    std::vector<uint64_t> visited(id_count, no_pos);
+    task::ptr_list path;
+    while (visited[t->get_id()] == no_pos) {
+        visited[t->get_id()] = path.size();
+        path.push_back(t);
+        task::ptr_range deps(t->dependencies());
+        t = *std::find_if(deps.begin(), deps.end(),
+                bind(&planner::_unfinished, _1, &deps_left));
+    }
+    _cycle.assign(path.begin() + visited[t->get_id()], path.end());
+    _last_task = _cycle.front();
+    return circular_dependency;
+}
+
+// _expand_level -- finish a range of a level's tasks
+void
+planner::_expand_level(uint64_t begin, uint64_t end, uint64_t level,
+        const sched_container* frontier, std::vector<uint64_t>* deps_left,
+        sched_container* next, boost::mutex* lock)
+{
+    sched_container found;
+    for (uint64_t ix(begin); ix < end; ++ix) {
+        uint64_t id((*frontier)[ix]);
+        _depth[id] = level;
+        task::ptr_range waiters(task::lookup_task(id)->waiters());
+        for (task::ptr_list::const_iterator w(waiters.begin());
+                w != waiters.end();
+                ++w) {
+            if ((*w)->get_id() < deps_left->size() &&
+                    __sync_sub_and_fetch(&(*deps_left)[(*w)->get_id()], 1) == 0) {
+                found.push_back((*w)->get_id());
+            }
+        }
+    }
+    boost::mutex::scoped_lock guard(*lock);
+    next->insert(next->end(), found.begin(), found.end());
+}
+
+bool
+planner::_unfinished(const task* t, const std::vector<uint64_t>* deps_left)
+{
+    return t->get_id() < deps_left->size() && (*deps_left)[t->get_id()] != 0;
+}
+
+//
+// _map_tasks -- capacity check and dependency lookup of a range of tasks
+//
+// Only reads the compute nodes and other tasks, so ranges can be mapped
+// concurrently.
+//
+void
+planner::_map_tasks(uint64_t begin, uint64_t end, std::vector<status>* rc) const
+{
+    for (uint64_t ix(begin); ix < end; ++ix) {
+        task* t((*_tasks)[ix].get());
+        (*rc)[ix] = _check_capacity(t);
+        if ((*rc)[ix] == ok && !t->resolve_dependencies()) {
+            (*rc)[ix] = missing_dependency;
+        }
+    }
+}
+
+//
+// _reduce_dependencies -- transitive reduction of the dependency graph
+//
+// A dependency is implied if the task also depends on it through another
+// dependency.  Reachability is tracked with bitsets in _job_sequence
+// order, where every task comes after its dependencies.  Bitsets over all
+// tasks would take n^2 bits, so the tasks are split into windows of
+// reduce_window consecutive positions and each window only tracks which
+// of its own tasks every later task can reach.  Windows are independent
+// and are searched on separate threads.  A window takes a bit per task
+// for each of its positions, so it narrows for large graphs to keep each
+// thread within reduce_memory; the total work stays the same.
+//
+// The job sequence was sorted with all edges, so the plan doesn't change:
+// a task's remaining dependencies only complete after the implied ones.
+// The graph is rebuilt with the remaining edges.
+//
+void
+planner::_reduce_dependencies(uint64_t dep_edges)
+{
+    // tasks in dependency order, and each task's dependencies by position
+    uint64_t ids(0);
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        ids = std::max(ids, (*itr)->get_id() + 1);
+    }
+    std::vector<task*> by_id(ids, static_cast<task*>(NULL));
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        by_id[(*itr)->get_id()] = itr->get();
+    }
+    std::vector<task*> order;
+    std::vector<uint64_t> pos(ids, no_pos);
+    for (sched_container::const_iterator itr(_job_sequence.begin());
+            itr != _job_sequence.end();
+            ++itr) {
+        if (*itr < ids && by_id[*itr]) {
+            pos[*itr] = order.size();
+            order.push_back(by_id[*itr]);
+        }
+    }
+
+    std::vector<uint64_t> first(1, 0);
+    std::vector<uint64_t> dep_pos;
+    std::vector<char> redundant;
+    std::vector<uint64_t> seen_by(order.size(), no_pos);
+    for (uint64_t p(0); p < order.size(); ++p) {
+        task::ptr_range deps(order[p]->dependencies());
+        for (task::ptr_list::const_iterator dep(deps.begin());
+                dep != deps.end();
+                ++dep) {
+            uint64_t id((*dep)->get_id());
+            uint64_t q(id < ids && by_id[id] == *dep ? pos[id] : no_pos);
+            // a repeated dependency is redundant too
+            bool repeat(q != no_pos && seen_by[q] == p);
+            if (q != no_pos) {
+                seen_by[q] = p;
+            }
+            dep_pos.push_back(q);
+            redundant.push_back(repeat);
+        }
+        first.push_back(dep_pos.size());
+    }
+
+    uint64_t window(reduce_window);
+    while (window > 64 && order.size() * (window / 8) > reduce_memory) {
+        window /= 2;
+    }
+    uint64_t windows((order.size() + window - 1) / window);
+    parallel::parallel_for(windows, _threads,
+            bind(&planner::_reduce_windows, this, _1, _2, window, &first, &dep_pos,
+                &redundant));
+
+    // drop what isn't needed for ordering or data
+    _reduced_deps = 0;
+    graph_edge_list edges;
+    for (uint64_t p(0); p < order.size(); ++p) {
+        task::ptr_range deps(order[p]->dependencies());
+        std::vector<char> drop(redundant.begin() + first[p],
+                redundant.begin() + first[p + 1]);
+        for (uint64_t ix(0); ix < deps.size(); ++ix) {
+            if (deps[ix]->get_output_size()) {
+                drop[ix] = 0;
+            }
+        }
+        _reduced_deps += order[p]->drop_dependencies(drop);
+    }
+    if (_reduced_deps == 0) {
+        return;
+    }
+
+    // rebuild the graph with the remaining edges
+    edges.reserve(_edge.size() - _reduced_deps);
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        task::ptr_range deps((*itr)->dependencies());
+        for (task::ptr_list::const_iterator dep(deps.begin());
+                dep != deps.end();
+                ++dep) {
+            edges.push_back(std::make_pair((*itr)->get_id(), (*dep)->get_id()));
+        }
+    }
+    edges.insert(edges.end(), _edge.begin() + dep_edges, _edge.end());
+    _edge.swap(edges);
+    _tg = task_graph();
+    for (graph_edge_list::const_iterator itr(_edge.begin());
+            itr != _edge.end();
+            ++itr) {
+        boost::add_edge(itr->first, itr->second, _tg);
+    }
+}
+
+//
+// _reduce_windows -- find implied dependencies on tasks in some windows
+//
+// reach[p] holds the window's tasks that task p depends on directly or
+// indirectly.  A dependency of p on window task q is implied if q is
+// already in the reach of one of p's dependencies.
+//
+void
+planner::_reduce_windows(uint64_t begin, uint64_t end, uint64_t window,
+        const std::vector<uint64_t>* first, const std::vector<uint64_t>* dep_pos,
+        std::vector<char>* redundant) const
+{
+    const uint64_t words(window / 64);
+    const uint64_t count(first->size() - 1);
+    // tasks before a window can't reach into it, so the first window of
+    // the range needs the most rows
+    std::vector<uint64_t> reach((count - std::min(count, begin * window)) * words);
+    for (uint64_t w(begin); w < end; ++w) {
+        uint64_t lo(w * window);
+        uint64_t hi(std::min(count, lo + window));
+        std::fill(reach.begin(), reach.begin() + (count - lo) * words, 0);
+        for (uint64_t p(lo); p < count; ++p) {
+            uint64_t* rp(&reach[(p - lo) * words]);
+            for (uint64_t s((*first)[p]); s < (*first)[p + 1]; ++s) {
+                uint64_t q((*dep_pos)[s]);
+                if (q >= lo && q < count) {
+                    const uint64_t* rq(&reach[(q - lo) * words]);
+                    for (uint64_t wx(0); wx < words; ++wx) {
+                        rp[wx] |= rq[wx];
+                    }
+                }
+            }
+            for (uint64_t s((*first)[p]); s < (*first)[p + 1]; ++s) {
+                uint64_t q((*dep_pos)[s]);
+                if (q >= lo && q < hi &&
+                        (rp[(q - lo) / 64] & (1ULL << ((q - lo) % 64)))) {
+                    (*redundant)[s] = 1;
+                }
+            }
+            for (uint64_t s((*first)[p]); s < (*first)[p + 1]; ++s) {
+                uint64_t q((*dep_pos)[s]);
+                if (q >= lo && q < hi) {
+                    rp[(q - lo) / 64] |= 1ULL << ((q - lo) % 64);
+                }
+            }
+        }
+    }
+}
+
+//
+// add_task -- validate a task that arrived after validate_tasks
+//
+// The task's dependencies were added before it, so appending it keeps
+// _job_sequence in dependency order and it can't close a cycle unless it
+// depends on itself.
+//
+planner::status
+planner::add_task(const task::ptr& t)
+{
+    assert(_tasks_validated);
+    _last_task = t.get();
+    status rc(_check_capacity(t.get()));
+    if (rc != ok) {
+        return rc;
+    }
+    if (!t->map_dependencies()) {
+        return missing_dependency;
+    }
+    task::ptr_range deps(t->dependencies());
+    if (std::find(deps.begin(), deps.end(), t.get()) != deps.end()) {
+        return circular_dependency;
+    }
+    _tasks->push_back(t);
+    _job_sequence.push_back(t->get_id());
+    if (_depth.size() <= t->get_id()) {
+        _depth.resize(t->get_id() + 1, 0);
+    }
+    for (task::ptr_list::const_iterator dep(deps.begin()); dep != deps.end(); ++dep) {
+        _depth[t->get_id()] = std::max(_depth[t->get_id()], _depth[(*dep)->get_id()] + 1);
+    }
+    ++_tasks_remaining;
+    _rank_stale = true;
+    return ok;
+}
+
+// _check_capacity -- some compute node can host the task
+//
+// A gang needs its resources on every node it spans, so only the nodes
+// holding them count towards its cores.  The task is rejected with
+// resources_exceeded if it would fit but for its resources.
+planner::status
+planner::_check_capacity(task* t) const
+{
+    if (t->is_gang() && _shapes_tasks()) {
+        uint64_t nodes(_top_cores.size() - 1);
+        if (t->get_max_nodes()) {
+            nodes = std::min(nodes, t->get_max_nodes());
+        }
+        if (t->get_cores_required() > _top_cores[nodes]) {
+            return compute_exceeded;
+        }
+        if (t->get_resources().empty()) {
+            return ok;
+        }
+        std::vector<uint64_t> node_cores;
+        for (compute::list::const_iterator itr(_comp->begin()); itr != _comp->end(); ++itr) {
+            if (t->get_resources().fits((*itr)->get_resources())) {
+                node_cores.push_back((*itr)->get_cores());
+            }
+        }
+        nodes = std::min<uint64_t>(nodes, node_cores.size());
+        std::partial_sort(node_cores.begin(), node_cores.begin() + nodes, node_cores.end(),
+                std::greater<uint64_t>());
+        uint64_t cores(std::accumulate(node_cores.begin(), node_cores.begin() + nodes,
+                    uint64_t(0)));
+        return t->get_cores_required() > cores ? resources_exceeded : ok;
+    }
+    if ((_shapes_tasks() ? t->get_min_cores() : t->get_cores_required()) > _max_cores) {
+        return compute_exceeded;
+    }
+    if (!t->get_resources().empty() &&
+            std::find_if(_comp->begin(), _comp->end(),
+                bind(&compute::can_host, _1, t)) == _comp->end()) {
+        return resources_exceeded;
+    }
+    return ok;
+}
+
 // schedule_tasks -- take the validated set of tasks in dependency order and schedule them
 // 
 // Note, validate_tasks must have already been called.
 planner::schedule_list
 planner::schedule_tasks()
 {
-    assert(_tasks_validated);
+    if (_partitioned && _fixed_node.empty()) {
+        return _schedule_partitioned();
+    }
+    if (_node_classes && _fixed_node.empty()) {
+        return _schedule_classes();
+    }
+    return schedule_until(unbounded);
+}
 
-    uint64_t tasks_remaining = _tasks->size();
+const planner::schedule_list&
+planner::schedule_until(uint64_t horizon)
+{
+    assert(_tasks_validated);
 
     task::ptr_list runnable;
-    task::ptr_llist running;
     compute::ptr_list comp_avail(_comp->size());
 
-    while (tasks_remaining) {
+    // cluster capacity, used to rank tasks by dominant resource share
+    uint64_t cluster_cores(0);
+    resource_set cluster_res;
+    for (compute::list::iterator comp_itr(_comp->begin());
+            comp_itr != _comp->end();
+            ++comp_itr) {
+        cluster_cores += (*comp_itr)->get_cores();
+        cluster_res += (*comp_itr)->get_resources();
+    }
+    if ((_mode == eft || _mode == least_slack) && _rank_stale) {
+        _rank_tasks();
+        _rank_stale = false;
+    }
+
+    while (_tasks_remaining && _required_ticks < horizon) {
         uint64_t skip_ticks = 0;
+        _next_wake = compute::never_fits;
 
         // Assign tasks to compute resources.  This is roughly a best-fit bin packing
         // algorithm.  Here are the steps.
@@ -203,7 +971,9 @@ planner::schedule_tasks()
             // the last most recently runnable task.
             task* t(task::lookup_task(*itr));
             if (t->get_state() == task::not_started) {
-                if (t->dependencies_met()) {
+                if (t->get_release_time() > _required_ticks) {
+                    _next_wake = std::min(_next_wake, t->get_release_time());
+                } else if (t->dependencies_met()) {
                     runnable.push_back(t); 
                 } else {
                     ++_count_dep_wait;
@@ -212,68 +982,141 @@ planner::schedule_tasks()
         }
 
         // sort based on waiters and compute requirements
-        std::sort(runnable.begin(), runnable.end(), runnable_task_sort);
+        if (!_fixed_node.empty()) {
+            std::sort(runnable.begin(), runnable.end(), fixed_task_sort(_fixed_order));
+        } else if (_mode == dominant_fit) {
+            std::sort(runnable.begin(), runnable.end(),
+                    dominant_task_sort(cluster_cores, cluster_res));
+        } else if (_mode == eft) {
+            std::sort(runnable.begin(), runnable.end(), rank_task_sort(_rank));
+        } else if (_mode == least_slack) {
+            std::sort(runnable.begin(), runnable.end(),
+                    slack_task_sort(_latest_finish, _weight, _rank, _required_ticks));
+        } else {
+            std::sort(runnable.begin(), runnable.end(), runnable_task_sort);
+        }
 
         // assign each tasks to a compute node's cores, enter the decision in the plan
         int cores_available = comp_avail.size();
-        for (task::ptr_list::reverse_iterator task_itr(runnable.rbegin());
-                task_itr != runnable.rend();
-                ++task_itr) {
-            if ((*task_itr)->get_state() != task::not_started) {
-                continue;
-            }
-            for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
-                    comp_itr != comp_avail.end() && (*comp_itr)->get_cores_available() > 0;
-                    ++comp_itr) {
-                if (static_cast<int64_t>((*task_itr)->get_cores_required()) <=
-                        (*comp_itr)->get_cores_available()) {
-                    _schedule.push_back(schedule_entry(*task_itr, *comp_itr));
-                    (*comp_itr)->assign_task(*task_itr);
-                    running.push_back(*task_itr);
-                    if ((*comp_itr)->get_cores_available() == 0) {
-                        --cores_available;
+        if (!_fixed_node.empty()) {
+            _place_fixed(runnable, cores_available);
+        } else if (_mode == backfill || _mode == conservative_backfill) {
+            _backfill(runnable, comp_avail, cores_available, _running);
+        } else if (_mode == eft) {
+            _earliest_finish(runnable, _running);
+        } else {
+            for (task::ptr_list::reverse_iterator task_itr(runnable.rbegin());
+                    task_itr != runnable.rend();
+                    ++task_itr) {
+                if ((*task_itr)->get_state() != task::not_started) {
+                    continue;
+                }
+                if ((*task_itr)->is_gang()) {
+                    task::gang_list parts;
+                    if (!_gang_fit(*task_itr, comp_avail, &parts)) {
+                        continue;
+                    }
+                    _assign_gang(*task_itr, parts, _running);
+                    for (task::gang_list::const_iterator part(parts.begin());
+                            part != parts.end();
+                            ++part) {
+                        if (part->first->get_cores_available() == 0) {
+                            --cores_available;
+                        }
+                    }
+                    if (cores_available == 0) {
+                        ++_all_cores_busy;
+                        break;
+                    }
+                    continue;
+                }
+                if ((*task_itr)->is_moldable() || _mode == dominant_fit ||
+                        _mode == locality) {
+                    compute* c(NULL);
+                    if ((*task_itr)->is_moldable()) {
+                        c = _moldable_fit(*task_itr, comp_avail);
+                    } else if (_mode == dominant_fit) {
+                        c = _dominant_best_fit(*task_itr, comp_avail);
+                    } else {
+                        c = _locality_fit(*task_itr, comp_avail);
+                    }
+                    if (c) {
+                        _assign(*task_itr, c, _running);
+                        if (c->get_cores_available() == 0) {
+                            --cores_available;
+                        }
+                    }
+                    if (cores_available == 0) {
+                        ++_all_cores_busy;
+                        break;
+                    }
+                    continue;
+                }
+                for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+                        comp_itr != comp_avail.end() && (*comp_itr)->get_cores_available() > 0;
+                        ++comp_itr) {
+                    if (_can_start(*task_itr, *comp_itr)) {
+                        _assign(*task_itr, *comp_itr, _running);
+                        if ((*comp_itr)->get_cores_available() == 0) {
+                            --cores_available;
+                        }
+                        break;
+                    } else {
+                        ++_count_comp_unavail;
                     }
+                }
+                if (cores_available == 0) {
+                    ++_all_cores_busy;
                     break;
-                } else {
-                    ++_count_comp_unavail;
                 }
             }
-            if (cores_available == 0) {
-                ++_all_cores_busy;
-                break;
-            }
         }
 
-        // find the smallest amount of time required to complete a task
-        for (task::ptr_llist::iterator run_itr(running.begin());
-                run_itr != running.end();
-                ++run_itr) {
-            skip_ticks = std::min(skip_ticks,(*run_itr)->get_ticks_remaining());
-            if (skip_ticks == 0) {
-                skip_ticks = (*run_itr)->get_ticks_remaining();
-            } else {
-                skip_ticks = std::min(skip_ticks,
-                        (*run_itr)->get_ticks_remaining());
+        // find the smallest amount of time required to complete a task;
+        // a task without work completes in the next tick
+        for (compute::list::iterator comp_itr(_comp->begin());
+                comp_itr != _comp->end();
+                ++comp_itr) {
+            uint64_t ticks((*comp_itr)->get_ticks_to_completion());
+            if (ticks == compute::never_fits) {
+                continue;
             }
+            ticks = std::max<uint64_t>(ticks, 1);
+            if (skip_ticks == 0 || ticks < skip_ticks) {
+                skip_ticks = ticks;
+            }
+        }
+        // wake up when an input transfer or a reservation is due
+        if (_next_wake != compute::never_fits &&
+                (skip_ticks == 0 || _next_wake - _required_ticks < skip_ticks)) {
+            skip_ticks = _next_wake - _required_ticks;
+        }
+        // idle until more tasks arrive, but don't run past the horizon
+        if (skip_ticks == 0) {
+            assert(horizon != unbounded);
+            skip_ticks = horizon - _required_ticks;
+        } else if (horizon != unbounded && skip_ticks > horizon - _required_ticks) {
+            skip_ticks = horizon - _required_ticks;
         }
 
         // run the tasks by ticking to the next task completion time
         for (compute::list::iterator comp_itr(_comp->begin());
                     comp_itr != _comp->end();
                     ++comp_itr) {
-            tasks_remaining -= (*comp_itr)->tick(skip_ticks);
+            _tasks_remaining -= (*comp_itr)->tick(skip_ticks);
         }
 
         _required_ticks += skip_ticks;
         
         // remove complete tasks from running list
-        for (task::ptr_llist::iterator run_itr(running.begin());
-                run_itr != running.end();
+        for (task::ptr_llist::iterator run_itr(_running.begin());
+                run_itr != _running.end();
                 ) {
             if ((*run_itr)->get_state() == task::complete) {
+                (*run_itr)->set_finish_tick(_required_ticks);
                 task::ptr_llist::iterator rem(run_itr);
                 ++run_itr; 
-                running.erase(rem);
+                _running.erase(rem);
             } else {
                 ++run_itr;
             }
@@ -283,6 +1126,1240 @@ planner::schedule_tasks()
     return _schedule;
 }
 
+//
+// _schedule_partitioned -- plan independent parts of the graph concurrently
+//
+// 1. split the tasks into weakly connected components and the compute
+//    nodes into one slice per large component plus one for the rest
+// 2. plan each slice on its own planner, on worker threads, or reuse a
+//    cached plan for it
+// 3. reconcile the slices' plans into one schedule
+//
+// If the graph doesn't split, or the nodes can't be sliced so that every
+// task can still run, the whole graph is planned as usual.
+//
+planner::schedule_list
+planner::_schedule_partitioned()
+{
+    assert(_tasks_validated);
+    std::vector<partition> parts;
+    if (!_partition_tasks(&parts)) {
+        return schedule_until(unbounded);
+    }
+    parallel::parallel_for(parts.size(), _threads,
+            bind(&planner::_plan_partitions, this, _1, _2, &parts));
+    _reconcile(parts);
+    return _schedule;
+}
+
+bool
+planner::_partition_tasks(std::vector<partition>* parts)
+{
+    // weakly connected components; slices don't plan gang tasks, as the
+    // component cache doesn't record their parts
+    uint64_t ids(0);
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        if ((*itr)->is_gang()) {
+            return false;
+        }
+        ids = std::max(ids, (*itr)->get_id() + 1);
+    }
+    std::vector<uint64_t> parent(ids);
+    std::vector<task::ptr> by_id(ids);
+    for (uint64_t id(0); id < ids; ++id) {
+        parent[id] = id;
+    }
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        by_id[(*itr)->get_id()] = *itr;
+        task::ptr_range deps((*itr)->dependencies());
+        for (task::ptr_list::const_iterator dep(deps.begin());
+                dep != deps.end();
+                ++dep) {
+            parent[find_root(parent, (*itr)->get_id())] =
+                find_root(parent, (*dep)->get_id());
+        }
+    }
+
+    // collect each component's tasks in dependency order
+    std::vector<int64_t> comp_of(ids, -1);
+    std::vector<partition> comps;
+    uint64_t total_work(0);
+    for (sched_container::const_iterator itr(_job_sequence.begin());
+            itr != _job_sequence.end();
+            ++itr) {
+        task* t(task::lookup_task(*itr));
+        uint64_t root(find_root(parent, t->get_id()));
+        if (comp_of[root] < 0) {
+            comp_of[root] = comps.size();
+            comps.push_back(partition());
+            comps.back().work = 0;
+        }
+        partition& comp(comps[comp_of[root]]);
+        comp.tasks.push_back(by_id[t->get_id()]);
+        comp.work += t->get_cores_required() * t->get_execution_time();
+        total_work += t->get_cores_required() * t->get_execution_time();
+    }
+    if (comps.size() < 2) {
+        return false;
+    }
+
+    // components that earn at least one node get a slice, the rest share one
+    uint64_t nodes(_comp->size());
+    std::vector<uint64_t> large;
+    std::vector<uint64_t> work(comps.size());
+    partition rest;
+    rest.work = 0;
+    for (uint64_t ix(0); ix < comps.size(); ++ix) {
+        work[ix] = comps[ix].work;
+        if (work[ix] * nodes >= total_work && work[ix] > 0) {
+            large.push_back(ix);
+        }
+    }
+    std::stable_sort(large.begin(), large.end(), key_sort(work));
+    uint64_t slices(std::min<uint64_t>(large.size(), nodes));
+    if (slices == nodes && comps.size() > slices) {
+        --slices;
+    }
+    std::vector<bool> sliced(comps.size(), false);
+    for (uint64_t ix(0); ix < slices; ++ix) {
+        sliced[large[ix]] = true;
+    }
+    for (uint64_t ix(0); ix < comps.size(); ++ix) {
+        if (sliced[ix]) {
+            parts->push_back(comps[ix]);
+        }
+    }
+    // the shared slice keeps the dependency order across its components
+    for (sched_container::const_iterator itr(_job_sequence.begin());
+            itr != _job_sequence.end();
+            ++itr) {
+        task* t(task::lookup_task(*itr));
+        if (!sliced[comp_of[find_root(parent, t->get_id())]]) {
+            rest.tasks.push_back(by_id[t->get_id()]);
+            rest.work += t->get_cores_required() * t->get_execution_time();
+        }
+    }
+    if (!rest.tasks.empty()) {
+        parts->push_back(rest);
+    }
+    if (parts->size() < 2) {
+        parts->clear();
+        return false;
+    }
+
+    // give each slice the biggest free node that can run all of its tasks
+    std::vector<compute*> by_size;
+    for (compute::list::const_iterator itr(_comp->begin());
+            itr != _comp->end();
+            ++itr) {
+        by_size.push_back(itr->get());
+    }
+    std::stable_sort(by_size.begin(), by_size.end(),
+            bind(sort_total_cores<compute*>, _2, _1));
+    std::vector<int64_t> slice_of(nodes, -1);
+    std::vector<uint64_t> capacity(parts->size(), 0);
+    for (uint64_t ix(0); ix < parts->size(); ++ix) {
+        uint64_t cores;
+        resource_set res;
+        max_requirement((*parts)[ix].tasks, &cores, &res);
+        // the smallest node that fits leaves big nodes for big slices
+        int64_t pick(-1);
+        for (uint64_t nx(0); nx < by_size.size(); ++nx) {
+            if (slice_of[nx] < 0 && by_size[nx]->get_cores() >= cores &&
+                    res.fits(by_size[nx]->get_resources())) {
+                pick = nx;
+            }
+        }
+        if (pick < 0) {
+            parts->clear();
+            return false;
+        }
+        slice_of[pick] = ix;
+        capacity[ix] += by_size[pick]->get_cores() * by_size[pick]->get_speed();
+    }
+
+    // hand out the remaining nodes to the slice with the most work per core
+    for (uint64_t nx(0); nx < by_size.size(); ++nx) {
+        if (slice_of[nx] >= 0) {
+            continue;
+        }
+        uint64_t best(0);
+        for (uint64_t ix(1); ix < parts->size(); ++ix) {
+            // work[ix] / capacity[ix] > work[best] / capacity[best]
+            if (static_cast<double>((*parts)[ix].work) * capacity[best] >
+                    static_cast<double>((*parts)[best].work) * capacity[ix]) {
+                best = ix;
+            }
+        }
+        slice_of[nx] = best;
+        capacity[best] += by_size[nx]->get_cores() * by_size[nx]->get_speed();
+    }
+    for (compute::list::const_iterator itr(_comp->begin());
+            itr != _comp->end();
+            ++itr) {
+        uint64_t nx(std::find(by_size.begin(), by_size.end(), itr->get()) - by_size.begin());
+        (*parts)[slice_of[nx]].nodes.push_back(*itr);
+    }
+    return true;
+}
+
+// _plan_partitions -- plan slices [begin, end), on a worker thread
+void
+planner::_plan_partitions(uint64_t begin, uint64_t end,
+        std::vector<partition>* parts)
+{
+    for (uint64_t ix(begin); ix < end; ++ix) {
+        partition& part((*parts)[ix]);
+        part.cached = false;
+        std::string path;
+        if (!_component_cache.empty()) {
+            path = _component_cache + "/" + _partition_signature(part) + ".plan";
+            if (_load_partition(path, &part)) {
+                part.cached = true;
+                continue;
+            }
+        }
+
+        part.plan.reset(new planner(&part.nodes, &part.tasks));
+        planner& sub(*part.plan);
+        sub._mode = _mode;
+        sub._net = _net;
+        for (task::list::const_iterator itr(part.tasks.begin());
+                itr != part.tasks.end();
+                ++itr) {
+            sub._job_sequence.push_back((*itr)->get_id());
+        }
+        sub._tasks_remaining = part.tasks.size();
+        sub._tasks_validated = true;
+        part.schedule = sub.schedule_until(unbounded);
+        part.ticks = sub._required_ticks;
+
+        if (!path.empty()) {
+            _store_partition(path, part);
+        }
+    }
+}
+
+// _partition_signature -- hash of everything a slice's plan depends on
+std::string
+planner::_partition_signature(const partition& part) const
+{
+    std::ostringstream canon;
+    canon << mode_str[_mode] << "\n" << _net << "\n";
+    for (compute::list::const_iterator itr(part.nodes.begin());
+            itr != part.nodes.end();
+            ++itr) {
+        canon << (*itr)->name() << " " << (*itr)->get_cores() << " "
+            << (*itr)->get_speed() << " " << (*itr)->get_resources();
+        const compute::window_map& down((*itr)->get_unavailable());
+        for (compute::window_map::const_iterator win(down.begin()); win != down.end(); ++win) {
+            canon << " " << win->first << "-" << win->second;
+        }
+        canon << "\n";
+    }
+    for (task::list::const_iterator itr(part.tasks.begin());
+            itr != part.tasks.end();
+            ++itr) {
+        canon << (*itr)->name() << " " << (*itr)->get_cores_required() << " "
+            << (*itr)->get_execution_time() << " " << (*itr)->get_resources() << " "
+            << (*itr)->get_output_size() << " " << (*itr)->get_release_time() << " "
+            << (*itr)->get_deadline() << " " << (*itr)->get_priority();
+        if ((*itr)->is_moldable()) {
+            canon << " " << (*itr)->get_min_cores() << "-" << (*itr)->get_max_cores();
+            for (uint64_t cores((*itr)->get_min_cores());
+                    cores <= (*itr)->get_max_cores();
+                    ++cores) {
+                canon << " " << (*itr)->get_execution_time_on(cores);
+            }
+        }
+        task::ptr_range deps((*itr)->dependencies());
+        for (task::ptr_list::const_iterator dep(deps.begin());
+                dep != deps.end();
+                ++dep) {
+            canon << " " << (*dep)->name();
+        }
+        canon << "\n";
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx",
+            static_cast<unsigned long long>(fnv1a(canon.str())));
+    return hex;
+}
+
+//
+// _load_partition -- replay a slice's plan from the cache
+//
+// The file holds the slice's makespan and a line per task in schedule
+// order: task name, node name, start tick, finish tick and cores.
+//
+bool
+planner::_load_partition(const std::string& path, partition* part)
+{
+    std::ifstream in(path.c_str());
+    std::string label;
+    uint64_t ticks;
+    if (!(in >> label >> ticks) || label != "makespan") {
+        return false;
+    }
+
+    // read and check the whole plan before touching any task
+    std::vector<cached_placement> plan;
+    std::string task_name;
+    std::string comp_name;
+    cached_placement p;
+    while (in >> task_name >> comp_name >> p.start >> p.finish >> p.cores) {
+        p.t = task::lookup_task(task_name);
+        p.c = NULL;
+        for (compute::list::const_iterator itr(part->nodes.begin());
+                itr != part->nodes.end();
+                ++itr) {
+            if ((*itr)->name() == comp_name) {
+                p.c = itr->get();
+            }
+        }
+        if (p.t == NULL || p.c == NULL || p.finish < p.start || p.finish > ticks ||
+                p.cores < p.t->get_min_cores() || p.cores > p.t->get_max_cores()) {
+            return false;
+        }
+        plan.push_back(p);
+    }
+    if (plan.size() != part->tasks.size()) {
+        return false;
+    }
+
+    part->ticks = ticks;
+    part->schedule.clear();
+    std::vector<uint64_t> busy(part->nodes.size(), 0);
+    std::vector<uint64_t> count(part->nodes.size(), 0);
+    for (std::vector<cached_placement>::const_iterator itr(plan.begin());
+            itr != plan.end();
+            ++itr) {
+        itr->t->set_cores(itr->cores);
+        itr->t->set_state(task::complete);
+        itr->t->set_placement(itr->c, itr->start);
+        itr->t->set_finish_tick(itr->finish);
+        part->schedule.push_back(schedule_entry(itr->t, itr->c));
+        for (uint64_t nx(0); nx < part->nodes.size(); ++nx) {
+            if (part->nodes[nx].get() == itr->c) {
+                busy[nx] += itr->t->get_cores_required() * (itr->finish - itr->start);
+                ++count[nx];
+            }
+        }
+    }
+    for (uint64_t nx(0); nx < part->nodes.size(); ++nx) {
+        part->nodes[nx]->account(busy[nx], ticks, count[nx]);
+    }
+    return true;
+}
+
+void
+planner::_store_partition(const std::string& path, const partition& part)
+{
+    std::string tmp(path + ".tmp");
+    {
+        std::ofstream out(tmp.c_str());
+        out << "makespan " << part.ticks << "\n";
+        for (schedule_list::const_iterator itr(part.schedule.begin());
+                itr != part.schedule.end();
+                ++itr) {
+            schedule_entry entry(*itr);
+            out << entry.get_task()->name() << " " << entry.get_compute()->name()
+                << " " << entry.get_task()->get_start_tick()
+                << " " << entry.get_task()->get_finish_tick()
+                << " " << entry.get_task()->get_cores_required() << "\n";
+        }
+        if (!out) {
+            remove(tmp.c_str());
+            return;
+        }
+    }
+    rename(tmp.c_str(), path.c_str());
+}
+
+//
+// _reconcile -- merge the slices' plans into one
+//
+// Slices run side by side from tick 0 on disjoint nodes, so the merged
+// plan is the slices' decisions in start tick order.  Nodes of slices
+// that finish early are idle until the last slice finishes.
+//
+void
+planner::_reconcile(std::vector<partition>& parts)
+{
+    _partition_count = parts.size();
+    schedule_list merged;
+    for (std::vector<partition>::const_iterator itr(parts.begin());
+            itr != parts.end();
+            ++itr) {
+        _required_ticks = std::max(_required_ticks, itr->ticks);
+        if (itr->cached) {
+            ++_partition_cache_hits;
+            continue;
+        }
+        _count_dep_wait += itr->plan->_count_dep_wait;
+        _count_comp_unavail += itr->plan->_count_comp_unavail;
+        _all_cores_busy += itr->plan->_all_cores_busy;
+        _transfer_size += itr->plan->_transfer_size;
+    }
+    for (std::vector<partition>::iterator itr(parts.begin());
+            itr != parts.end();
+            ++itr) {
+        for (compute::list::iterator comp_itr(itr->nodes.begin());
+                comp_itr != itr->nodes.end();
+                ++comp_itr) {
+            if (_required_ticks > itr->ticks) {
+                (*comp_itr)->account(0, _required_ticks - itr->ticks, 0);
+            }
+        }
+        merged.insert(merged.end(), itr->schedule.begin(), itr->schedule.end());
+        itr->plan.reset();
+    }
+    std::stable_sort(merged.begin(), merged.end(), start_tick_sort);
+    for (schedule_list::const_iterator itr(merged.begin()); itr != merged.end(); ++itr) {
+        _emit(*itr);
+    }
+    _tasks_remaining = 0;
+}
+
+//
+// _classify_nodes -- group identical compute nodes
+//
+// Nodes with the same cores and speed are interchangeable to a greedy
+// plan when nothing but cores is scheduled.  Classes are numbered in the
+// order their first node appears, and each starts with all of its nodes
+// idle.  Returns false if the plan depends on more than a node's cores.
+//
+bool
+planner::_classify_nodes(std::vector<node_class>* classes,
+        std::vector<uint64_t>* class_of) const
+{
+    if (_mode != greedy || !_net.is_free() || _required_ticks != 0) {
+        return false;
+    }
+    for (task::list::const_iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        if (!(*itr)->get_resources().empty() || (*itr)->is_moldable() ||
+                (*itr)->is_gang()) {
+            return false;
+        }
+    }
+    std::map<std::pair<uint64_t, uint32_t>, uint64_t> by_shape;
+    class_of->resize(_comp->size());
+    for (uint64_t ix(0); ix < _comp->size(); ++ix) {
+        const compute& c(*(*_comp)[ix]);
+        if (!c.get_resources().empty() || c.has_unavailable()) {
+            return false;
+        }
+        std::pair<uint64_t, uint32_t> shape(c.get_cores(), c.get_speed());
+        std::map<std::pair<uint64_t, uint32_t>, uint64_t>::iterator found(by_shape.find(shape));
+        if (found == by_shape.end()) {
+            found = by_shape.insert(std::make_pair(shape, classes->size())).first;
+            node_class cls;
+            cls.cores = shape.first;
+            cls.speed = shape.second;
+            cls.free_nodes.resize(cls.cores + 1);
+            classes->push_back(cls);
+        }
+        (*class_of)[ix] = found->second;
+        (*classes)[found->second].free_nodes[shape.first].push_back(ix);
+    }
+    return true;
+}
+
+//
+// _schedule_classes -- greedy planning against classes of identical nodes
+//
+// Each step places runnable tasks in greedy mode's order, biggest first,
+// each on a node with the fewest free cores that still fit it.  That node
+// is found by looking up the first non-empty free core bucket at or above
+// the task's cores in each class, rather than by sorting and scanning the
+// nodes.  Tasks bigger than any free node are skipped over in one lookup.
+//
+// The runnable tasks are kept in order as tasks are released and as their
+// dependencies complete, and running tasks in order of their finish ticks,
+// so time advances straight to the next completion or release without
+// rescanning the tasks or ticking the nodes.  Busy time is accounted for
+// on the nodes at the end.
+//
+planner::schedule_list
+planner::_schedule_classes()
+{
+    assert(_tasks_validated);
+    std::vector<node_class> classes;
+    std::vector<uint64_t> class_of;
+    if (!_classify_nodes(&classes, &class_of)) {
+        return schedule_until(unbounded);
+    }
+    _node_class_count = classes.size();
+
+    uint64_t node_count(_comp->size());
+    std::vector<uint64_t> slot(node_count, 0);
+    std::vector<uint64_t> free_cores(node_count);
+    std::vector<uint64_t> busy_ticks(node_count, 0);
+    std::vector<uint64_t> task_count(node_count, 0);
+    uint64_t nodes_free(0);
+    for (uint64_t ix(0); ix < node_count; ++ix) {
+        free_cores[ix] = (*_comp)[ix]->get_cores();
+        if (free_cores[ix] > 0) {
+            ++nodes_free;
+        }
+    }
+    for (std::vector<node_class>::iterator cls(classes.begin());
+            cls != classes.end();
+            ++cls) {
+        std::vector<uint64_t>& idle(cls->free_nodes[cls->cores]);
+        for (uint64_t ix(0); ix < idle.size(); ++ix) {
+            slot[idle[ix]] = ix;
+        }
+    }
+
+    // by task id: dependencies not yet complete, whether the task has been
+    // released and its position in the job sequence
+    uint64_t id_count(_job_sequence.empty() ? 0 :
+            *std::max_element(_job_sequence.begin(), _job_sequence.end()) + 1);
+    std::vector<uint64_t> deps_left(id_count, 0);
+    std::vector<char> released(id_count, 0);
+    std::vector<uint64_t> seq_pos(id_count, 0);
+
+    // tasks not yet released, released and runnable, and the number
+    // released but waiting on dependencies
+    typedef std::priority_queue<ready_key, std::vector<ready_key>,
+            bool (*)(const ready_key&, const ready_key&)> release_queue;
+    release_queue pending(release_later);
+    std::set<ready_key> ready;
+    uint64_t waiting(0);
+    for (uint64_t pos(0); pos < _job_sequence.size(); ++pos) {
+        task* t(task::lookup_task(_job_sequence[pos]));
+        seq_pos[t->get_id()] = pos;
+        deps_left[t->get_id()] = t->get_dependency_count();
+        pending.push(make_ready_key(t, pos));
+    }
+
+    typedef std::priority_queue<class_run, std::vector<class_run>,
+            bool (*)(const class_run&, const class_run&)> run_queue;
+    run_queue running(class_run_later);
+    uint64_t seq(0);
+
+    while (_tasks_remaining) {
+        while (!pending.empty() &&
+                pending.top().t->get_release_time() <= _required_ticks) {
+            ready_key key(pending.top());
+            pending.pop();
+            released[key.t->get_id()] = 1;
+            if (deps_left[key.t->get_id()] == 0) {
+                ready.insert(key);
+            } else {
+                ++waiting;
+            }
+        }
+        _next_wake = pending.empty() ? compute::never_fits :
+            pending.top().t->get_release_time();
+        _count_dep_wait += waiting;
+
+        // place the biggest tasks first on the best fitting class
+        std::set<ready_key>::iterator itr(ready.begin());
+        while (itr != ready.end()) {
+            if (nodes_free == 0) {
+                ++_all_cores_busy;
+                break;
+            }
+            task* t(itr->t);
+            uint64_t need(std::max<uint64_t>(t->get_cores_required(), 1));
+            uint64_t best_class(classes.size());
+            uint64_t best_free(0);
+            uint64_t most_free(0);
+            for (uint64_t cx(0); cx < classes.size(); ++cx) {
+                const node_class& cls(classes[cx]);
+                uint64_t level(need);
+                while (level <= cls.cores && cls.free_nodes[level].empty()) {
+                    ++level;
+                }
+                if (level <= cls.cores &&
+                        (best_class == classes.size() || level < best_free)) {
+                    best_class = cx;
+                    best_free = level;
+                }
+                for (level = cls.cores; level > most_free; --level) {
+                    if (!cls.free_nodes[level].empty()) {
+                        most_free = level;
+                        break;
+                    }
+                }
+            }
+            if (best_class == classes.size()) {
+                // skip to the biggest tasks that fit the freest node
+                ready_key probe = { most_free, UINT64_MAX, 0, NULL };
+                itr = ready.lower_bound(probe);
+                continue;
+            }
+
+            node_class& cls(classes[best_class]);
+            uint64_t node(cls.free_nodes[best_free].back());
+            uint64_t left(best_free - t->get_cores_required());
+            move_node(cls.free_nodes, slot, node, best_free, left);
+            free_cores[node] = left;
+            if (left == 0) {
+                --nodes_free;
+            }
+
+            compute* c((*_comp)[node].get());
+            t->set_placement(c, _required_ticks);
+            t->set_state(task::running);
+            t->set_speed(cls.speed);
+            _emit(schedule_entry(t, c));
+            class_run run = { _required_ticks +
+                std::max<uint64_t>(t->get_ticks_at(cls.speed), 1), seq++, t, node };
+            running.push(run);
+            ready.erase(itr++);
+        }
+        _count_comp_unavail += ready.size();
+
+        // run to the next completion or release
+        uint64_t next(_next_wake);
+        if (!running.empty()) {
+            next = std::min(next, running.top().finish);
+        }
+        assert(next != compute::never_fits);
+        _required_ticks = next;
+
+        // put the cores of completed tasks back in their class and make
+        // their waiters runnable
+        while (!running.empty() && running.top().finish == _required_ticks) {
+            class_run run(running.top());
+            running.pop();
+            uint64_t cores(run.t->get_cores_required());
+            node_class& cls(classes[class_of[run.node]]);
+            if (free_cores[run.node] == 0 && cores > 0) {
+                ++nodes_free;
+            }
+            move_node(cls.free_nodes, slot, run.node, free_cores[run.node],
+                    free_cores[run.node] + cores);
+            free_cores[run.node] += cores;
+            busy_ticks[run.node] += cores * (run.finish - run.t->get_start_tick());
+            ++task_count[run.node];
+            run.t->set_work_remaining(0);
+            run.t->set_finish_tick(_required_ticks);
+            --_tasks_remaining;
+
+            task::ptr_range waiters(run.t->waiters());
+            for (task::ptr_list::const_iterator w(waiters.begin());
+                    w != waiters.end();
+                    ++w) {
+                uint64_t id((*w)->get_id());
+                if (--deps_left[id] == 0 && released[id]) {
+                    --waiting;
+                    ready.insert(make_ready_key(*w, seq_pos[id]));
+                }
+            }
+        }
+    }
+
+    for (uint64_t ix(0); ix < node_count; ++ix) {
+        (*_comp)[ix]->account(busy_ticks[ix], _required_ticks, task_count[ix]);
+    }
+    return _schedule;
+}
+
+// _dominant_best_fit -- vector bin packing node selection
+//
+// Of the nodes the task fits on right now, pick the one whose largest
+// residual share of cores or any other resource is the smallest after
+// placement, i.e. the node the task fills most completely.
+compute*
+planner::_dominant_best_fit(task* t, compute::ptr_list& comp_avail)
+{
+    compute* best(NULL);
+    double best_share(0.0);
+    for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+            comp_itr != comp_avail.end();
+            ++comp_itr) {
+        if (!_can_start(t, *comp_itr)) {
+            ++_count_comp_unavail;
+            continue;
+        }
+        double share((*comp_itr)->residual_share(t));
+        if (best == NULL || share < best_share) {
+            best = *comp_itr;
+            best_share = share;
+        }
+    }
+    return best;
+}
+
+//
+// _backfill -- assign runnable tasks with reservations (EASY or conservative)
+//
+// 1. drop the reservations made in the previous scheduling round
+// 2. for each runnable task in priority order,
+//   3. start it now on the best fitting node where it won't delay a
+//      reservation, unless every core is already taken
+//   4. otherwise reserve the node where it can start the earliest; in EASY
+//      mode only the first blocked task gets a reservation, in conservative
+//      mode the first conservative_depth blocked tasks do
+//
+void
+planner::_backfill(task::ptr_list& runnable, compute::ptr_list& comp_avail,
+        int cores_available, task::ptr_llist& running)
+{
+    for (compute::list::iterator comp_itr(_comp->begin());
+            comp_itr != _comp->end();
+            ++comp_itr) {
+        (*comp_itr)->clear_reservations();
+    }
+
+    uint64_t reserved(0);
+    uint64_t max_reserved(_mode == backfill ? 1 : conservative_depth);
+    for (task::ptr_list::reverse_iterator task_itr(runnable.rbegin());
+            task_itr != runnable.rend();
+            ++task_itr) {
+        task* t(*task_itr);
+        compute* c(NULL);
+        bool full(cores_available == 0 && t->get_cores_required() > 0);
+        for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+                !full && comp_itr != comp_avail.end();
+                ++comp_itr) {
+            if (!_can_start(t, *comp_itr)) {
+                continue;
+            }
+            if ((*comp_itr)->has_reservations() &&
+                    (*comp_itr)->earliest_start(t, _required_ticks) != _required_ticks) {
+                continue;
+            }
+            c = *comp_itr;
+            break;
+        }
+        if (c) {
+            _assign(t, c, running);
+            if (c->get_cores_available() == 0 && --cores_available == 0) {
+                ++_all_cores_busy;
+            }
+            continue;
+        }
+
+        ++_count_comp_unavail;
+        if (reserved == max_reserved) {
+            continue;
+        }
+        uint64_t best_start(compute::never_fits);
+        for (compute::list::iterator comp_itr(_comp->begin());
+                comp_itr != _comp->end();
+                ++comp_itr) {
+            uint64_t start((*comp_itr)->earliest_start(t, _required_ticks,
+                        _data_ready(t, comp_itr->get())));
+            if (start < best_start) {
+                best_start = start;
+                c = comp_itr->get();
+            }
+        }
+        assert(c);
+        c->reserve(t, best_start);
+        _next_wake = std::min(_next_wake, best_start);
+        ++reserved;
+    }
+}
+
+//
+// _place_fixed -- start runnable tasks in plan order on their planned nodes
+//
+// A task whose node can't take it now, or whose start tick hasn't come,
+// waits, and later tasks in the order may start before it.
+//
+void
+planner::_place_fixed(task::ptr_list& runnable, int cores_available)
+{
+    for (task::ptr_list::reverse_iterator task_itr(runnable.rbegin());
+            task_itr != runnable.rend();
+            ++task_itr) {
+        if (!_fixed_start.empty() && _fixed_start[(*task_itr)->get_id()] > _required_ticks) {
+            _next_wake = std::min(_next_wake, _fixed_start[(*task_itr)->get_id()]);
+            continue;
+        }
+        compute* c(_fixed_node[(*task_itr)->get_id()]);
+        if (c->get_cores_available() == 0 || !_can_start(*task_itr, c)) {
+            ++_count_comp_unavail;
+            continue;
+        }
+        _assign(*task_itr, c, _running);
+        if (c->get_cores_available() == 0 && --cores_available == 0) {
+            ++_all_cores_busy;
+            break;
+        }
+    }
+}
+
+//
+// _earliest_finish -- assign runnable tasks to the nodes they finish on first
+//
+// 1. drop the reservations made in the previous scheduling round
+// 2. for each runnable task in critical path order,
+//   3. find the node where it would finish first, counting the time to
+//      wait for cores and the node's speed
+//   4. start it now if that node is free, otherwise reserve the node so
+//      that later tasks don't take it
+//
+// Like conservative backfilling, only conservative_depth tasks per round may
+// wait for a node; after that tasks only consider nodes they can start on.
+//
+void
+planner::_earliest_finish(task::ptr_list& runnable, task::ptr_llist& running)
+{
+    for (compute::list::iterator comp_itr(_comp->begin());
+            comp_itr != _comp->end();
+            ++comp_itr) {
+        (*comp_itr)->clear_reservations();
+    }
+
+    uint64_t reserved(0);
+    for (task::ptr_list::reverse_iterator task_itr(runnable.rbegin());
+            task_itr != runnable.rend();
+            ++task_itr) {
+        task* t(*task_itr);
+        compute* best(NULL);
+        uint64_t best_start(compute::never_fits);
+        uint64_t best_finish(compute::never_fits);
+        for (compute::list::iterator comp_itr(_comp->begin());
+                comp_itr != _comp->end();
+                ++comp_itr) {
+            compute* c(comp_itr->get());
+            if (reserved == conservative_depth && !c->fits(t)) {
+                continue;
+            }
+            uint64_t start(c->earliest_start(t, _required_ticks, _data_ready(t, c)));
+            if (start == compute::never_fits ||
+                    (reserved == conservative_depth && start != _required_ticks)) {
+                continue;
+            }
+            uint64_t finish(start + t->get_ticks_at(c->get_speed()));
+            if (finish < best_finish || (finish == best_finish &&
+                        c->get_cores_available() < best->get_cores_available())) {
+                best = c;
+                best_start = start;
+                best_finish = finish;
+            }
+        }
+        if (best == NULL) {
+            ++_count_comp_unavail;
+            continue;
+        }
+        if (best_start == _required_ticks) {
+            _assign(t, best, running);
+            continue;
+        }
+        ++_count_comp_unavail;
+        best->reserve(t, best_start);
+        _next_wake = std::min(_next_wake, best_start);
+        ++reserved;
+    }
+}
+
+//
+// _rank_tasks -- critical path length from each task to the end of the graph
+//
+// _job_sequence lists dependencies before the tasks waiting on them, so
+// walking it backward sees every waiter before the task it waits on.
+// The same walk pulls deadlines back: a task must finish in time for each
+// waiter to run by its own effective deadline, and it carries the highest
+// priority among the deadlines it holds up.
+//
+void
+planner::_rank_tasks()
+{
+    uint64_t count(_job_sequence.empty() ? 0 :
+            *std::max_element(_job_sequence.begin(), _job_sequence.end()) + 1);
+    _rank.assign(count, 0);
+    _latest_finish.assign(count, task::no_deadline);
+    _weight.assign(count, 0);
+    for (planner::sched_container::reverse_iterator itr(_job_sequence.rbegin());
+            itr != _job_sequence.rend();
+            ++itr) {
+        task* t(task::lookup_task(*itr));
+        uint64_t longest(0);
+        uint64_t finish(t->get_deadline());
+        uint64_t weight(finish == task::no_deadline ? 0 : t->get_priority());
+        task::ptr_range waiters(t->waiters());
+        for (task::ptr_list::const_iterator wait_itr(waiters.begin());
+                wait_itr != waiters.end();
+                ++wait_itr) {
+            task::id_t wid((*wait_itr)->get_id());
+            longest = std::max(longest, _rank[wid]);
+            if (_latest_finish[wid] == task::no_deadline) {
+                continue;
+            }
+            uint64_t ticks((*wait_itr)->get_ticks_at(task::unit_speed));
+            finish = std::min(finish, _latest_finish[wid] > ticks ?
+                    _latest_finish[wid] - ticks : 0);
+            weight = std::max(weight, _weight[wid]);
+        }
+        _rank[t->get_id()] = longest + t->get_ticks_at(task::unit_speed);
+        _latest_finish[t->get_id()] = finish;
+        _weight[t->get_id()] = weight;
+    }
+}
+
+// _locality_fit -- prefer the node holding the most of the task's input
+compute*
+planner::_locality_fit(task* t, compute::ptr_list& comp_avail)
+{
+    compute* best(NULL);
+    uint64_t best_local(0);
+    for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+            comp_itr != comp_avail.end();
+            ++comp_itr) {
+        if (!_can_start(t, *comp_itr)) {
+            ++_count_comp_unavail;
+            continue;
+        }
+        uint64_t local(t->get_input_size(*comp_itr));
+        if (best == NULL || local > best_local || (local == best_local &&
+                    (*comp_itr)->get_cores_available() < best->get_cores_available())) {
+            best = *comp_itr;
+            best_local = local;
+        }
+    }
+    return best;
+}
+
+//
+// _moldable_fit -- the node and core count a moldable task finishes first on
+//
+// Every node that has the task's minimum cores and its inputs is tried
+// with each core count from the minimum to what the node has free, if the
+// node stays up until the task would finish.  Ties go to fewer cores, then
+// to the node with fewer cores free.  The task is left set to the chosen
+// core count, or to its old one if it can't start anywhere.
+//
+compute*
+planner::_moldable_fit(task* t, compute::ptr_list& comp_avail)
+{
+    uint64_t cores(t->get_cores_required());
+    compute* best(NULL);
+    uint64_t best_cores(0);
+    uint64_t best_ticks(0);
+    t->set_cores(t->get_min_cores());
+    for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+            comp_itr != comp_avail.end();
+            ++comp_itr) {
+        compute* c(*comp_itr);
+        uint64_t ready(_data_ready(t, c));
+        if (!c->fits(t) || ready > _required_ticks) {
+            if (c->fits(t)) {
+                _next_wake = std::min(_next_wake, ready);
+            }
+            ++_count_comp_unavail;
+            continue;
+        }
+        uint64_t most(std::min<uint64_t>(t->get_max_cores(), c->get_cores_available()));
+        uint64_t shortest(compute::never_fits);
+        for (uint64_t try_cores(t->get_min_cores()); try_cores <= most; ++try_cores) {
+            uint64_t ticks((t->get_execution_time_on(try_cores) * task::unit_speed +
+                        c->get_speed() - 1) / c->get_speed());
+            if (c->next_up(_required_ticks, ticks) != _required_ticks) {
+                shortest = std::min(shortest, ticks);
+                continue;
+            }
+            shortest = 0;
+            if (best == NULL || ticks < best_ticks ||
+                    (ticks == best_ticks && try_cores < best_cores)) {
+                best = c;
+                best_cores = try_cores;
+                best_ticks = ticks;
+            }
+        }
+        if (shortest != 0) {
+            // the node goes down before any core count would finish
+            _next_wake = std::min(_next_wake, c->next_up(_required_ticks, shortest));
+        }
+    }
+    t->set_cores(best ? best_cores : cores);
+    return best;
+}
+
+//
+// _gang_fit -- the nodes and cores a gang task starts on now
+//
+// A task that fits on one node goes on the one with the fewest free cores
+// that fits, as in greedy mode.  Otherwise nodes holding the task's
+// resources and inputs are taken in order of free cores until they have
+// the task's cores: fewest first to use up fragments, or most first to
+// span as few nodes as possible.  Fewest first starts from the smallest
+// node that keeps the task within its node limit.  Each node gives all of
+// its free cores but the last, which gives the rest.  Returns false if the
+// task can't start now.
+//
+bool
+planner::_gang_fit(task* t, compute::ptr_list& comp_avail, task::gang_list* parts)
+{
+    // parts run as long as on the slowest node, so that is how long each
+    // node has to stay up
+    uint32_t slowest(task::unit_speed);
+    for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+            comp_itr != comp_avail.end();
+            ++comp_itr) {
+        slowest = std::min(slowest, (*comp_itr)->get_speed());
+    }
+    uint64_t ticks(t->get_ticks_at(slowest));
+    compute::ptr_list usable;
+    for (compute::ptr_list::iterator comp_itr(comp_avail.begin());
+            comp_itr != comp_avail.end();
+            ++comp_itr) {
+        compute* c(*comp_itr);
+        if (c->get_cores_available() <= 0 ||
+                !t->get_resources().fits(c->get_resources_available())) {
+            ++_count_comp_unavail;
+            continue;
+        }
+        uint64_t ready(c->next_up(std::max(_required_ticks, _data_ready(t, c)), ticks));
+        if (ready > _required_ticks) {
+            _next_wake = std::min(_next_wake, ready);
+            ++_count_comp_unavail;
+            continue;
+        }
+        usable.push_back(c);
+    }
+    // comp_avail is sorted by free cores, fewest first
+    uint64_t cores(t->get_cores_required());
+    for (compute::ptr_list::iterator comp_itr(usable.begin());
+            comp_itr != usable.end();
+            ++comp_itr) {
+        if (static_cast<uint64_t>((*comp_itr)->get_cores_available()) >= cores) {
+            parts->assign(1, task::gang_part(*comp_itr, cores));
+            return true;
+        }
+    }
+    if (_gang_fewest_nodes) {
+        std::reverse(usable.begin(), usable.end());
+    }
+    uint64_t limit(t->get_max_nodes() ? t->get_max_nodes() : usable.size());
+    for (uint64_t first(0); first < usable.size(); ++first) {
+        uint64_t held(0);
+        uint64_t end(first);
+        for (; end < usable.size() && end - first < limit && held < cores; ++end) {
+            held += usable[end]->get_cores_available();
+        }
+        if (held < cores) {
+            continue;
+        }
+        parts->clear();
+        uint64_t left(cores);
+        for (uint64_t ix(first); ix < end; ++ix) {
+            uint64_t part(std::min<uint64_t>(left, usable[ix]->get_cores_available()));
+            parts->push_back(task::gang_part(usable[ix], part));
+            left -= part;
+        }
+        return true;
+    }
+    return false;
+}
+
+//
+// _assign_gang -- start every part of a gang task
+//
+// All parts run for as long as the task takes on the slowest of its
+// nodes.  The task is placed on the first node, which reports progress.
+//
+void
+planner::_assign_gang(task* t, const task::gang_list& parts, task::ptr_llist& running)
+{
+    uint32_t slowest(parts.front().first->get_speed());
+    for (task::gang_list::const_iterator part(parts.begin()); part != parts.end(); ++part) {
+        slowest = std::min(slowest, part->first->get_speed());
+    }
+    uint64_t ticks(std::max<uint64_t>(t->get_ticks_at(slowest), 1));
+    compute* lead(parts.front().first);
+    t->set_placement(lead, _required_ticks);
+    t->set_gang_parts(parts);
+    if (!_net.is_free()) {
+        _transfer_size += t->get_input_size() - t->get_input_size(lead);
+    }
+    _emit(schedule_entry(t, lead));
+    for (task::gang_list::const_iterator part(parts.begin()); part != parts.end(); ++part) {
+        part->first->assign_part(t, part->second, ticks);
+    }
+    running.push_back(t);
+}
+
+// _shapes_tasks -- modes that choose a moldable task's cores or a gang
+// task's nodes when placing it
+bool
+planner::_shapes_tasks() const
+{
+    return _mode == greedy || _mode == dominant_fit || _mode == locality ||
+        _mode == least_slack;
+}
+
+// _can_start -- the task's cores, resources and inputs are on the node now,
+// and the node stays up until the task would finish
+bool
+planner::_can_start(task* t, compute* c)
+{
+    if (!c->fits(t)) {
+        return false;
+    }
+    uint64_t ready(_required_ticks);
+    if (!_net.is_free()) {
+        ready = std::max(ready, t->data_ready_on(c, _net));
+    }
+    ready = c->next_up(ready, t->get_ticks_at(c->get_speed()));
+    if (ready <= _required_ticks) {
+        return true;
+    }
+    _next_wake = std::min(_next_wake, ready);
+    return false;
+}
+
+uint64_t
+planner::_data_ready(task* t, compute* c) const
+{
+    if (_net.is_free()) {
+        return 0;
+    }
+    return t->data_ready_on(c, _net);
+}
+
+void
+planner::_assign(task* t, compute* c, task::ptr_llist& running)
+{
+    t->set_placement(c, _required_ticks);
+    if (!_net.is_free()) {
+        _transfer_size += t->get_input_size() - t->get_input_size(c);
+    }
+    _emit(schedule_entry(t, c));
+    c->assign_task(t);
+    running.push_back(t);
+}
+
+// _emit -- pass a placement on to the sink, or add it to the plan
+void
+planner::_emit(const schedule_entry& entry)
+{
+    if (_sink) {
+        _sink->decided(entry);
+    } else {
+        _schedule.push_back(entry);
+    }
+}
+
+void
+planner::reset()
+{
+    for (task::list::iterator itr(_tasks->begin());
+            itr != _tasks->end();
+            ++itr) {
+        (*itr)->reset();
+    }
+    for (compute::list::iterator itr(_comp->begin());
+            itr != _comp->end();
+            ++itr) {
+        (*itr)->reset();
+    }
+    _schedule.clear();
+    _running.clear();
+    _tasks_remaining = _tasks->size();
+    _required_ticks = 0;
+    _count_dep_wait = 0;
+    _count_comp_unavail = 0;
+    _all_cores_busy = 0;
+    _transfer_size = 0;
+    _partition_count = 0;
+    _partition_cache_hits = 0;
+    _node_class_count = 0;
+}
+
+void
+planner::set_partitioned(bool partitioned, unsigned threads)
+{
+    _partitioned = partitioned;
+    _threads = threads ? threads : 1;
+}
+
+void
+planner::set_component_cache(const std::string& dir)
+{
+    _component_cache = dir;
+}
+
+void
+planner::set_reduce_dependencies(bool reduce, unsigned threads)
+{
+    _reduce_deps = reduce;
+    _threads = threads ? threads : 1;
+}
+
+void
+planner::set_schedule_sink(schedule_sink* sink)
+{
+    _sink = sink;
+}
+
+void
+planner::set_fixed_plan(const std::vector<uint64_t>& order,
+        const std::vector<compute*>& nodes,
+        const std::vector<uint64_t>& starts)
+{
+    _fixed_order = order;
+    _fixed_node = nodes;
+    _fixed_start = starts;
+}
+
+void
+planner::set_edge_log(std::ostream* log)
+{
+    _edge_log = log;
+}
+
+void
+planner::set_level_order(bool level_order)
+{
+    _level_order = level_order;
+}
+
+void
+planner::set_threads(unsigned threads)
+{
+    _threads = threads ? threads : 1;
+}
+
+void
+planner::set_node_classes(bool classes)
+{
+    _node_classes = classes;
+}
+
+void
+planner::set_gang_fewest_nodes(bool fewest)
+{
+    _gang_fewest_nodes = fewest;
+}
+
+void
+planner::set_network(const network& net)
+{
+    _net = net;
+}
+
+void
+planner::set_mode(mode m)
+{
+    _mode = m;
+}
+
+bool
+planner::parse_mode(const std::string& name, mode* m)
+{
+    for (int ix(0); ix < mode_count; ++ix) {
+        if (name.compare(mode_str[ix]) == 0) {
+            *m = static_cast<mode>(ix);
+            return true;
+        }
+    }
+    return false;
+}
+
 // getters
 
 task*
@@ -321,6 +2398,60 @@ planner::get_count_all_cores_busy() const
     return _all_cores_busy;
 }
 
+uint64_t
+planner::get_partition_count() const
+{
+    return _partition_count;
+}
+
+uint64_t
+planner::get_reduced_dependency_count() const
+{
+    return _reduced_deps;
+}
+
+uint64_t
+planner::get_depth(const task* t) const
+{
+    assert(t->get_id() < _depth.size());
+    return _depth[t->get_id()];
+}
+
+const task::ptr_list&
+planner::get_cycle() const
+{
+    return _cycle;
+}
+
+uint64_t
+planner::get_effective_deadline(const task* t)
+{
+    if (_rank_stale) {
+        _rank_tasks();
+        _rank_stale = false;
+    }
+    assert(t->get_id() < _latest_finish.size());
+    return _latest_finish[t->get_id()];
+}
+
+uint64_t
+planner::get_node_class_count() const
+{
+    return _node_class_count;
+}
+
+uint64_t
+planner::get_partition_cache_hits() const
+{
+    return _partition_cache_hits;
+}
+
+uint64_t
+planner::get_transfer_size() const
+{
+    return _transfer_size;
+}
+
 task*
 planner::get_last_task() const
 {
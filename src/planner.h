@@ -6,6 +6,10 @@
 #include "task.h"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_traits.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ostream>
+#include <string>
 #include <vector>
 
 /*
@@ -32,16 +36,69 @@ public:
         compute* _compute;
     };
 
+    /*
+     * @class schedule_sink
+     *
+     * Receives the execution plan one entry at a time, as soon as each
+     * task is placed.
+     */
+    class schedule_sink {
+    public:
+        virtual ~schedule_sink();
+
+        /*
+         * decided
+         *
+         * Called once for every task, in the order tasks are placed.
+         *
+         * @param[in]  entry  the task and the compute node it runs on
+         */
+        virtual void decided(schedule_entry entry) = 0;
+    };
+
     /* Status codes that the planner can return and string mapping
      */
     enum _status {
         ok,
         compute_exceeded,
+        resources_exceeded,
         missing_dependency,
         circular_dependency
     };
     static const char* status_str[];
     typedef planner::_status status;
+
+    /* Scheduling modes and string mapping
+     *
+     *   greedy        largest tasks first, best fit on free cores
+     *   dominant_fit  largest dominant resource share first, placed on the
+     *                 node left with the smallest residual share
+     *   backfill      greedy order; the first task that can't start gets a
+     *                 reservation and smaller tasks are backfilled only if
+     *                 they don't delay it (EASY backfilling)
+     *   conservative_backfill
+     *                 as backfill, but every task that can't start gets a
+     *                 reservation
+     *   eft           longest remaining critical path first, placed on the
+     *                 node where it finishes earliest given node speeds
+     *   locality      greedy order, placed on the node already holding the
+     *                 most output of the task's dependencies
+     *   least_slack   least slack to the effective deadline first, late
+     *                 tasks by priority; tasks without a deadline by
+     *                 critical path.  Placed as greedy
+     */
+    enum _mode {
+        greedy,
+        dominant_fit,
+        backfill,
+        conservative_backfill,
+        eft,
+        locality,
+        least_slack,
+        mode_count
+    };
+    static const char* mode_str[];
+    typedef planner::_mode mode;
     typedef std::vector<schedule_entry> schedule_list;
 
     /*
@@ -66,6 +123,180 @@ public:
      */
     status validate_tasks();
 
+    /*
+     * set_mode
+     *
+     * Selects the scheduling mode used by schedule_tasks().  The default
+     * mode is greedy.
+     *
+     * @param[in]  m  scheduling mode
+     */
+    void set_mode(mode m);
+
+    /*
+     * parse_mode
+     *
+     * @param[in]  name  name of a scheduling mode (see mode_str)
+     * @param[out] m     mode matching the name
+     *
+     * @return true if the name is a known mode
+     */
+    static bool parse_mode(const std::string& name, mode* m);
+
+    /*
+     * set_network
+     *
+     * Sets the network model.  A task can't start on a node until the
+     * outputs of dependencies that ran on other nodes have been
+     * transferred.  The default network is free.
+     *
+     * @param[in]  net  network model
+     */
+    void set_network(const network& net);
+
+    /*
+     * set_partitioned
+     *
+     * Plans weakly connected components of the task graph separately.
+     * Each component large enough to earn a compute node of its own is
+     * planned on a dedicated slice of the compute nodes; the remaining
+     * small components share one slice.  Slices are planned concurrently
+     * and merged into one schedule.  Only schedule_tasks() partitions.
+     *
+     * @param[in]  partitioned  true to partition
+     * @param[in]  threads      number of threads to plan slices on
+     */
+    void set_partitioned(bool partitioned, unsigned threads);
+
+    /*
+     * set_component_cache
+     *
+     * Sets a directory in which partitioned plans are saved.  A slice's
+     * plan is reused as long as its tasks, its compute nodes, the mode and
+     * the network are unchanged, regardless of changes elsewhere.
+     *
+     * @param[in]  dir  existing directory, empty to disable
+     */
+    void set_component_cache(const std::string& dir);
+
+    /*
+     * set_reduce_dependencies
+     *
+     * Has validate_tasks() remove dependencies implied by other
+     * dependencies, e.g. a task's dependency on task_000 when another of
+     * its dependencies already depends on task_000.  Dependencies on
+     * tasks with an output size are kept, since that output still has to
+     * reach the task.  The plan is the same either way.  Must be set
+     * before validate_tasks().
+     *
+     * @param[in]  reduce   true to remove implied dependencies
+     * @param[in]  threads  number of threads to search the graph on
+     */
+    void set_reduce_dependencies(bool reduce, unsigned threads);
+
+    /*
+     * set_schedule_sink
+     *
+     * Streams the execution plan to a sink instead of keeping it.  Entries
+     * are passed on as tasks are placed, so the plan takes no memory in
+     * the planner however many tasks there are; schedule_tasks() and
+     * schedule_until() then return empty lists.  A partitioned plan is
+     * still merged in memory before it is passed on.
+     *
+     * @param[in]  sink  sink for the plan, NULL to keep the plan
+     */
+    void set_schedule_sink(schedule_sink* sink);
+
+    /*
+     * set_fixed_plan
+     *
+     * Has schedule_tasks() follow a plan rather than the mode: whenever
+     * cores are free, runnable tasks are started in the given order, each
+     * only on its given node, the way sim_model::simulate() replays a plan.
+     * With start ticks, no task starts before its tick, so a plan that
+     * leaves cores idle on purpose is followed too.  Empty lists go back
+     * to planning by the mode.
+     *
+     * @param[in]  order   position of each task in the start order, by task id
+     * @param[in]  nodes   node of each task, by task id
+     * @param[in]  starts  earliest start tick of each task, by task id, or
+     *                     empty to start tasks as soon as they fit
+     */
+    void set_fixed_plan(const std::vector<uint64_t>& order,
+            const std::vector<compute*>& nodes,
+            const std::vector<uint64_t>& starts);
+
+    /*
+     * set_edge_log
+     *
+     * Sets where validate_tasks() reports each dependency edge it adds to
+     * the task graph.  Must be set before validate_tasks().
+     *
+     * @param[in]  log  stream for the edges, NULL (the default) for none
+     */
+    void set_edge_log(std::ostream* log);
+
+    /*
+     * set_level_order
+     *
+     * Has validate_tasks() order the tasks level by level, all tasks on
+     * one level before any on the next, instead of depth-first.  The level
+     * order comes out of the sort that finds the tasks' depths and is the
+     * same on any number of threads, but breaks ties between runnable
+     * tasks differently, so plans can differ.  Must be set before
+     * validate_tasks().
+     *
+     * @param[in]  level_order  true to use the level order
+     */
+    void set_level_order(bool level_order);
+
+    /*
+     * set_threads
+     *
+     * Sets the number of threads validate_tasks() checks and maps tasks
+     * on.  The default is 1.
+     *
+     * @param[in]  threads  number of threads
+     */
+    void set_threads(unsigned threads);
+
+    /*
+     * set_node_classes
+     *
+     * Has schedule_tasks() plan against classes of identical compute
+     * nodes, those with the same cores and speed, instead of against each
+     * node.  A class tracks how many of its nodes have each number of
+     * cores free, so a scheduling step costs time in the number of
+     * classes rather than the number of nodes, and the plan only names a
+     * node of the class when a task is placed.  Applies in greedy mode on
+     * a free network when neither nodes nor tasks have other resources;
+     * otherwise nodes are planned one by one.
+     *
+     * @param[in]  classes  true to plan against node classes
+     */
+    void set_node_classes(bool classes);
+
+    /*
+     * set_gang_fewest_nodes
+     *
+     * Chooses how a gang task is spread over compute nodes.  By default
+     * the nodes with the fewest free cores are filled first, to use up
+     * fragments.  With fewest set, the nodes with the most free cores are
+     * used, so the task spans as few nodes as possible.
+     *
+     * @param[in]  fewest  true to place gang tasks on as few nodes as possible
+     */
+    void set_gang_fewest_nodes(bool fewest);
+
+    /*
+     * reset
+     *
+     * Returns all tasks and compute nodes to their initial state and
+     * discards the plan and statistics, so that schedule_tasks() can be
+     * run again (e.g., in a different mode) on the validated graph.
+     */
+    void reset();
+
     /*
      * schedule_tasks
      *
@@ -80,6 +311,36 @@ public:
      */
     schedule_list schedule_tasks();
 
+    /*
+     * schedule_until
+     *
+     * Runs the simulation up to, but not including, the horizon tick and
+     * returns.  Scheduling decisions made so far are final as long as no
+     * task added later has a release time before the horizon, so they can
+     * be handed out while more tasks are still arriving.
+     *
+     * @param[in]  horizon  tick to stop at, or unbounded to run until all
+     *                      tasks are complete
+     *
+     * @return execution plan so far
+     */
+    const schedule_list& schedule_until(uint64_t horizon);
+
+    /*
+     * add_task
+     *
+     * Adds a task to a validated plan, e.g. while it is being scheduled
+     * with schedule_until().  The task's dependencies must already have
+     * been added.  The task is appended to the task list.
+     *
+     * @param[in]  t  new task
+     *
+     * @return status of the task's validation
+     */
+    status add_task(const task::ptr& t);
+
+    static const uint64_t unbounded = UINT64_MAX;
+
 
     /*
      * get_required_ticks
@@ -109,6 +370,69 @@ public:
      */
     uint64_t get_count_all_cores_busy() const;
 
+    /*
+     * get_transfer_size
+     *
+     * Returns the total size of the dependency outputs moved between nodes.
+     */
+    uint64_t get_transfer_size() const;
+
+    /*
+     * get_partition_count
+     *
+     * Returns the number of slices the last partitioned plan was made
+     * of, 0 if the plan wasn't partitioned.
+     */
+    uint64_t get_partition_count() const;
+
+    /*
+     * get_partition_cache_hits
+     *
+     * Returns the number of slices whose plan was reused from the cache.
+     */
+    uint64_t get_partition_cache_hits() const;
+
+    /*
+     * get_reduced_dependency_count
+     *
+     * Returns the number of implied dependencies validate_tasks() removed.
+     */
+    uint64_t get_reduced_dependency_count() const;
+
+    /*
+     * get_depth
+     *
+     * Returns the length of the longest chain of dependencies leading to
+     * a validated task; tasks without dependencies have depth 0.
+     */
+    uint64_t get_depth(const task* t) const;
+
+    /*
+     * get_cycle
+     *
+     * Returns the tasks on a dependency cycle that made validate_tasks()
+     * fail, each depending on the next and the last on the first, or an
+     * empty list.
+     */
+    const task::ptr_list& get_cycle() const;
+
+    /*
+     * get_effective_deadline
+     *
+     * Returns the tick a validated task must finish by for it and every
+     * task waiting on it, directly or not, to meet their deadlines at
+     * nominal speed, or task::no_deadline if none of them has one.
+     */
+    uint64_t get_effective_deadline(const task* t);
+
+    /*
+     * get_node_class_count
+     *
+     * Returns the number of node classes the last plan was made against,
+     * 0 if it was planned node by node.
+     */
+    uint64_t get_node_class_count() const;
+
     /*
      * get_last_task
      *
@@ -120,6 +444,72 @@ public:
 
 private:
 
+    /*
+     * @struct _partition
+     *
+     * A slice of the plan: some components of the task graph and the
+     * compute nodes dedicated to them.
+     */
+    struct _partition {
+        task::list tasks;           // in dependency order
+        compute::list nodes;
+        uint64_t work;              // core ticks
+        schedule_list schedule;
+        uint64_t ticks;
+        bool cached;
+        boost::shared_ptr<planner> plan;
+    };
+    typedef _partition partition;
+
+    schedule_list _schedule_partitioned();
+    bool _partition_tasks(std::vector<partition>* parts);
+    void _plan_partitions(uint64_t begin, uint64_t end,
+            std::vector<partition>* parts);
+    std::string _partition_signature(const partition& part) const;
+    bool _load_partition(const std::string& path, partition* part);
+    void _store_partition(const std::string& path, const partition& part);
+    void _reconcile(std::vector<partition>& parts);
+    void _map_tasks(uint64_t begin, uint64_t end, std::vector<status>* rc) const;
+
+    /*
+     * @struct _node_class
+     *
+     * Identical compute nodes, bucketed by the number of cores they have
+     * free.  A node's slot is its position in its bucket.
+     */
+    struct _node_class {
+        uint64_t cores;
+        uint32_t speed;
+        std::vector<std::vector<uint64_t> > free_nodes;  // by free cores
+    };
+    typedef _node_class node_class;
+
+    schedule_list _schedule_classes();
+    bool _classify_nodes(std::vector<node_class>* classes,
+            std::vector<uint64_t>* class_of) const;
+
+    compute* _dominant_best_fit(task* t, compute::ptr_list& comp_avail);
+    void _backfill(task::ptr_list& runnable, compute::ptr_list& comp_avail,
+            int cores_available, task::ptr_llist& running);
+    compute* _locality_fit(task* t, compute::ptr_list& comp_avail);
+    compute* _moldable_fit(task* t, compute::ptr_list& comp_avail);
+    bool _gang_fit(task* t, compute::ptr_list& comp_avail, task::gang_list* parts);
+    void _assign_gang(task* t, const task::gang_list& parts, task::ptr_llist& running);
+    bool _shapes_tasks() const;
+    void _earliest_finish(task::ptr_list& runnable, task::ptr_llist& running);
+    void _place_fixed(task::ptr_list& runnable, int cores_available);
+    status _check_capacity(task* t) const;
+    bool _can_start(task* t, compute* c);
+    uint64_t _data_ready(task* t, compute* c) const;
+    void _assign(task* t, compute* c, task::ptr_llist& running);
+    void _emit(const schedule_entry& entry);
+    void _rank_tasks();
+    void _reduce_dependencies(uint64_t dep_edges);
+    void _reduce_windows(uint64_t begin, uint64_t end, uint64_t window,
+            const std::vector<uint64_t>* first,
+            const std::vector<uint64_t>* dep_pos,
+            std::vector<char>* redundant) const;
+
     typedef boost::adjacency_list<
         boost::vecS, boost::vecS, boost::directedS> task_graph;
     typedef boost::graph_traits<task_graph>::vertex_descriptor vertex;
@@ -127,17 +517,53 @@ private:
     typedef std::pair<uint64_t, uint64_t> graph_edge;
     typedef std::vector<graph_edge> graph_edge_list;
 
+    status _sort_levels(sched_container* order);
+    void _expand_level(uint64_t begin, uint64_t end, uint64_t level,
+            const sched_container* frontier, std::vector<uint64_t>* deps_left,
+            sched_container* next, boost::mutex* lock);
+    static bool _unfinished(const task* t, const std::vector<uint64_t>* deps_left);
+
     compute::list* _comp;
     task::list* _tasks;
+    network _net;
     bool _tasks_validated;
+    mode _mode;
     task_graph _tg;
     sched_container _job_sequence; 
     graph_edge_list _edge;
+    std::vector<uint64_t> _rank;   // by task id, critical path to the end
+    std::vector<uint64_t> _fixed_order;  // by task id, see set_fixed_plan
+    std::vector<compute*> _fixed_node;   // by task id
+    std::vector<uint64_t> _fixed_start;  // by task id, may be empty
+    std::vector<uint64_t> _latest_finish;  // by task id, effective deadline
+    std::vector<uint64_t> _weight; // by task id, top priority with a deadline
+    bool _rank_stale;
     schedule_list _schedule;
+    schedule_sink* _sink;
+    task::ptr_llist _running;
+    uint64_t _tasks_remaining;
     uint64_t _required_ticks;
     uint64_t _count_dep_wait;
     uint64_t _count_comp_unavail;
     uint64_t _all_cores_busy;
+    uint64_t _next_wake;        // earliest tick a waiting transfer completes
+    uint64_t _transfer_size;
+    bool _partitioned;
+    unsigned _threads;
+    std::string _component_cache;
+    uint64_t _partition_count;
+    uint64_t _partition_cache_hits;
+    bool _reduce_deps;
+    uint64_t _reduced_deps;
+    bool _level_order;
+    std::vector<uint64_t> _depth;  // by task id
+    task::ptr_list _cycle;
+    bool _node_classes;
+    uint64_t _node_class_count;
+    uint64_t _max_cores;        // cores of the biggest node
+    std::vector<uint64_t> _top_cores;  // cores of the n biggest nodes, by n
+    bool _gang_fewest_nodes;
+    std::ostream* _edge_log;
     task* _last_task;
 };
 
@@ -0,0 +1,333 @@
+#include "planner_api.h"
+#include "planner.h"
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <new>
+#include <sstream>
+
+// a planning context: the planner and the nodes and tasks it plans, which
+// it only refers to, so it is declared after them and destroyed first
+struct planner_ctx {
+    compute::list comp;
+    task::list tasks;
+    boost::scoped_ptr<planner> plan;
+    std::string prefix;         // makes task names unique among contexts
+    bool validated;
+    planner_status validate_rc;
+    bool scheduled;
+    uint64_t makespan;
+    std::vector<planner_slot> slots;
+};
+
+namespace {
+    // every call holds this, as tasks are registered process-wide
+    boost::mutex api_lock;
+    uint64_t next_ctx(0);
+
+    const char* status_str[] = {
+        "Ok",
+        "Core capacity exceeded by task input.",
+        "Missing dependency in task description.",
+        "Circular dependency in task description.",
+        "Invalid argument.",
+        "Nodes and tasks can't be added after validation.",
+        "Not scheduled.",
+        "Buffer too small for the schedule.",
+        "Out of memory.",
+        "Internal planner error."
+    };
+
+    // internal name of the task at an index
+    std::string
+    task_name(const planner_ctx* ctx, uint64_t index)
+    {
+        std::ostringstream name;
+        name << ctx->prefix << index;
+        return name.str();
+    }
+
+    planner_status
+    from_status(planner::status rc)
+    {
+        switch (rc) {
+        case planner::ok:
+            return PLANNER_OK;
+        case planner::compute_exceeded:
+        case planner::resources_exceeded:   // C tasks have no resources
+            return PLANNER_COMPUTE_EXCEEDED;
+        case planner::missing_dependency:
+            return PLANNER_MISSING_DEPENDENCY;
+        case planner::circular_dependency:
+            return PLANNER_CIRCULAR_DEPENDENCY;
+        }
+        return PLANNER_INVALID_ARGUMENT;
+    }
+
+    // validate_ctx -- validate once, remembering the outcome
+    planner_status
+    validate_ctx(planner_ctx* ctx)
+    {
+        if (!ctx->validated) {
+            ctx->validated = true;
+            ctx->validate_rc = from_status(ctx->plan->validate_tasks());
+        }
+        return ctx->validate_rc;
+    }
+}
+
+planner_ctx*
+planner_create(void)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    try {
+        planner_ctx* ctx(new planner_ctx);
+        ctx->plan.reset(new planner(&ctx->comp, &ctx->tasks));
+        ctx->plan->set_edge_log(NULL);
+        std::ostringstream prefix;
+        prefix << "ctx" << next_ctx++ << ".";
+        ctx->prefix = prefix.str();
+        ctx->validated = false;
+        ctx->validate_rc = PLANNER_OK;
+        ctx->scheduled = false;
+        ctx->makespan = 0;
+        return ctx;
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void
+planner_destroy(planner_ctx* ctx)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    delete ctx;
+}
+
+planner_status
+planner_set_mode(planner_ctx* ctx, const char* mode)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    planner::mode m;
+    if (!ctx || !mode || !planner::parse_mode(mode, &m)) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    ctx->plan->set_mode(m);
+    return PLANNER_OK;
+}
+
+planner_status
+planner_set_threads(planner_ctx* ctx, unsigned threads)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx || threads == 0) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    ctx->plan->set_threads(threads);
+    return PLANNER_OK;
+}
+
+planner_status
+planner_add_nodes(planner_ctx* ctx, const planner_node* nodes, uint64_t count)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx || (count && !nodes)) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    if (ctx->validated) {
+        return PLANNER_ALREADY_VALIDATED;
+    }
+    for (uint64_t ix(0); ix < count; ++ix) {
+        double speed(nodes[ix].speed == 0 ? 1.0 : nodes[ix].speed);
+        if (speed * task::unit_speed < 1.0) {
+            return PLANNER_INVALID_ARGUMENT;
+        }
+    }
+    try {
+        ctx->comp.reserve(ctx->comp.size() + count);
+        for (uint64_t ix(0); ix < count; ++ix) {
+            std::string name;
+            if (nodes[ix].name) {
+                name = nodes[ix].name;
+            } else {
+                std::ostringstream numbered;
+                numbered << "node_" << ctx->comp.size();
+                name = numbered.str();
+            }
+            double speed(nodes[ix].speed == 0 ? 1.0 : nodes[ix].speed);
+            compute::ptr c(new compute(name, nodes[ix].cores));
+            c->set_speed(static_cast<uint32_t>(speed * task::unit_speed + 0.5));
+            ctx->comp.push_back(c);
+        }
+    } catch (const std::bad_alloc&) {
+        return PLANNER_NO_MEMORY;
+    } catch (...) {
+        return PLANNER_INTERNAL_ERROR;
+    }
+    return PLANNER_OK;
+}
+
+planner_status
+planner_add_tasks(planner_ctx* ctx, const planner_task* tasks, uint64_t count)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx || (count && !tasks)) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    if (ctx->validated) {
+        return PLANNER_ALREADY_VALIDATED;
+    }
+    for (uint64_t ix(0); ix < count; ++ix) {
+        if (tasks[ix].dep_count && !tasks[ix].deps) {
+            return PLANNER_INVALID_ARGUMENT;
+        }
+    }
+    try {
+        ctx->tasks.reserve(ctx->tasks.size() + count);
+        for (uint64_t ix(0); ix < count; ++ix) {
+            const planner_task& in(tasks[ix]);
+            task::ptr t(new task(task_name(ctx, ctx->tasks.size()).c_str(),
+                        in.cores, in.execution_time));
+            if (in.dep_count) {
+                std::string deps;
+                for (uint64_t dep(0); dep < in.dep_count; ++dep) {
+                    if (dep) {
+                        deps += ",";
+                    }
+                    deps += task_name(ctx, in.deps[dep]);
+                }
+                t->set_dep_str(deps.c_str());
+            }
+            if (in.release_time) {
+                t->set_release_time(in.release_time);
+            }
+            if (in.deadline) {
+                t->set_deadline(in.deadline);
+            }
+            if (in.priority) {
+                t->set_priority(in.priority);
+            }
+            ctx->tasks.push_back(t);
+        }
+    } catch (const std::bad_alloc&) {
+        return PLANNER_NO_MEMORY;
+    } catch (...) {
+        return PLANNER_INTERNAL_ERROR;
+    }
+    return PLANNER_OK;
+}
+
+planner_status
+planner_validate(planner_ctx* ctx)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    try {
+        return validate_ctx(ctx);
+    } catch (const std::bad_alloc&) {
+        return PLANNER_NO_MEMORY;
+    } catch (...) {
+        return PLANNER_INTERNAL_ERROR;
+    }
+}
+
+planner_status
+planner_failed_task(planner_ctx* ctx, uint64_t* index)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx || !index || !ctx->validated || ctx->validate_rc == PLANNER_OK) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    const task* failed(ctx->plan->get_last_task());
+    for (uint64_t ix(0); ix < ctx->tasks.size(); ++ix) {
+        if (ctx->tasks[ix].get() == failed) {
+            *index = ix;
+            return PLANNER_OK;
+        }
+    }
+    return PLANNER_INVALID_ARGUMENT;
+}
+
+planner_status
+planner_schedule(planner_ctx* ctx, uint64_t* makespan)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    try {
+        planner_status rc(validate_ctx(ctx));
+        if (rc != PLANNER_OK) {
+            return rc;
+        }
+        if (!ctx->scheduled) {
+            planner::schedule_list sched(ctx->plan->schedule_tasks());
+
+            // the plan refers to nodes and tasks, the slots to their indexes
+            std::map<const compute*, uint64_t> node_index;
+            for (uint64_t ix(0); ix < ctx->comp.size(); ++ix) {
+                node_index[ctx->comp[ix].get()] = ix;
+            }
+            std::vector<uint64_t> task_index;
+            for (uint64_t ix(0); ix < ctx->tasks.size(); ++ix) {
+                task::id_t id(ctx->tasks[ix]->get_id());
+                if (task_index.size() <= id) {
+                    task_index.resize(id + 1);
+                }
+                task_index[id] = ix;
+            }
+            ctx->slots.clear();
+            ctx->slots.reserve(sched.size());
+            for (planner::schedule_list::iterator itr(sched.begin());
+                    itr != sched.end();
+                    ++itr) {
+                planner_slot slot;
+                slot.task = task_index[itr->get_task()->get_id()];
+                slot.node = node_index[itr->get_compute()];
+                slot.start = itr->get_task()->get_start_tick();
+                slot.finish = itr->get_task()->get_finish_tick();
+                ctx->slots.push_back(slot);
+            }
+            ctx->makespan = ctx->plan->get_required_ticks();
+            ctx->scheduled = true;
+        }
+    } catch (const std::bad_alloc&) {
+        return PLANNER_NO_MEMORY;
+    } catch (...) {
+        return PLANNER_INTERNAL_ERROR;
+    }
+    if (makespan) {
+        *makespan = ctx->makespan;
+    }
+    return PLANNER_OK;
+}
+
+planner_status
+planner_get_schedule(planner_ctx* ctx, planner_slot* slots, uint64_t capacity,
+        uint64_t* count)
+{
+    boost::mutex::scoped_lock lock(api_lock);
+    if (!ctx || !count || (capacity && !slots)) {
+        return PLANNER_INVALID_ARGUMENT;
+    }
+    if (!ctx->scheduled) {
+        return PLANNER_NOT_SCHEDULED;
+    }
+    *count = ctx->slots.size();
+    if (capacity < ctx->slots.size()) {
+        return PLANNER_BUFFER_TOO_SMALL;
+    }
+    std::copy(ctx->slots.begin(), ctx->slots.end(), slots);
+    return PLANNER_OK;
+}
+
+const char*
+planner_status_str(planner_status status)
+{
+    if (status < PLANNER_OK || status > PLANNER_INTERNAL_ERROR) {
+        return "Unknown status.";
+    }
+    return status_str[status];
+}
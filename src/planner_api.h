@@ -0,0 +1,179 @@
+#ifndef _planner_api_h_
+#define _planner_api_h_
+
+/*
+ * C interface to the planner, built into libplanner.a and libplanner.so.
+ *
+ * A planning context holds compute nodes and tasks added from arrays in
+ * memory.  Tasks are numbered in the order they are added, nodes too, and
+ * dependencies and the schedule refer to them by those indexes.  Every
+ * call returns a planner_status unless noted otherwise.
+ *
+ * Calls are serialized with one lock in the library, so contexts may be
+ * used from any thread, but only one call runs at a time; planning itself
+ * runs on the context's threads (see planner_set_threads).
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PLANNER_OK = 0,
+    PLANNER_COMPUTE_EXCEEDED,       /* a task needs more than any node has */
+    PLANNER_MISSING_DEPENDENCY,     /* a dependency index has no task */
+    PLANNER_CIRCULAR_DEPENDENCY,
+    PLANNER_INVALID_ARGUMENT,
+    PLANNER_ALREADY_VALIDATED,      /* nodes and tasks can't be added now */
+    PLANNER_NOT_SCHEDULED,
+    PLANNER_BUFFER_TOO_SMALL,
+    PLANNER_NO_MEMORY,
+    PLANNER_INTERNAL_ERROR          /* the planner failed unexpectedly */
+} planner_status;
+
+typedef struct planner_ctx planner_ctx;
+
+typedef struct {
+    const char* name;           /* NULL for node_<index> */
+    uint64_t cores;
+    double speed;               /* relative speed, 0 for 1.0 */
+} planner_node;
+
+typedef struct {
+    uint64_t cores;
+    uint64_t execution_time;    /* ticks on a node of speed 1.0 */
+    uint64_t release_time;      /* tick the task arrives, 0 for the start */
+    uint64_t deadline;          /* tick to finish by, 0 for none */
+    uint64_t priority;          /* weight of a missed deadline, 0 for 1 */
+    const uint64_t* deps;       /* indexes of the tasks this task waits on */
+    uint64_t dep_count;
+} planner_task;
+
+typedef struct {
+    uint64_t task;              /* task index */
+    uint64_t node;              /* node index */
+    uint64_t start;             /* first tick the task runs */
+    uint64_t finish;            /* tick the task completes */
+} planner_slot;
+
+/*
+ * planner_create
+ *
+ * @return a new, empty planning context in greedy mode on one thread, NULL
+ *         if it can't be created
+ */
+planner_ctx* planner_create(void);
+
+/*
+ * planner_destroy
+ *
+ * Frees the context and its nodes, tasks and schedule.
+ *
+ * @param[in]  ctx  context, may be NULL
+ */
+void planner_destroy(planner_ctx* ctx);
+
+/*
+ * planner_set_mode
+ *
+ * @param[in]  ctx   context
+ * @param[in]  mode  scheduling mode, as for the planner's --mode option
+ *                   (e.g. "greedy", "backfill", "eft")
+ */
+planner_status planner_set_mode(planner_ctx* ctx, const char* mode);
+
+/*
+ * planner_set_threads
+ *
+ * @param[in]  ctx      context
+ * @param[in]  threads  threads to validate and plan on, at least 1
+ */
+planner_status planner_set_threads(planner_ctx* ctx, unsigned threads);
+
+/*
+ * planner_add_nodes
+ *
+ * Adds compute nodes, numbered after the ones already added.  The array
+ * is copied.
+ *
+ * @param[in]  ctx    context
+ * @param[in]  nodes  nodes to add
+ * @param[in]  count  number of nodes
+ */
+planner_status planner_add_nodes(planner_ctx* ctx, const planner_node* nodes,
+        uint64_t count);
+
+/*
+ * planner_add_tasks
+ *
+ * Adds tasks, numbered after the ones already added.  A dependency may
+ * name a task added later; it must exist by planner_validate.  The
+ * arrays are copied.
+ *
+ * @param[in]  ctx    context
+ * @param[in]  tasks  tasks to add
+ * @param[in]  count  number of tasks
+ */
+planner_status planner_add_tasks(planner_ctx* ctx, const planner_task* tasks,
+        uint64_t count);
+
+/*
+ * planner_validate
+ *
+ * Checks the tasks against the nodes and resolves the dependencies.  No
+ * nodes or tasks can be added afterwards.  On failure,
+ * planner_failed_task gives the task at fault.
+ *
+ * @param[in]  ctx  context
+ */
+planner_status planner_validate(planner_ctx* ctx);
+
+/*
+ * planner_failed_task
+ *
+ * @param[in]   ctx    context
+ * @param[out]  index  index of the task the last validation failed on
+ *
+ * @return PLANNER_OK, or PLANNER_INVALID_ARGUMENT if validation didn't fail
+ */
+planner_status planner_failed_task(planner_ctx* ctx, uint64_t* index);
+
+/*
+ * planner_schedule
+ *
+ * Validates the context if it hasn't been and plans every task.  Calling
+ * it again returns the same plan.
+ *
+ * @param[in]   ctx       context
+ * @param[out]  makespan  ticks until the last task completes, may be NULL
+ */
+planner_status planner_schedule(planner_ctx* ctx, uint64_t* makespan);
+
+/*
+ * planner_get_schedule
+ *
+ * Copies the plan, one slot per task in the order the tasks were placed.
+ * If the buffer is too small, nothing is copied and count is still set.
+ *
+ * @param[in]   ctx       context
+ * @param[out]  slots     buffer for the plan, may be NULL if capacity is 0
+ * @param[in]   capacity  slots the buffer holds
+ * @param[out]  count     slots in the plan
+ */
+planner_status planner_get_schedule(planner_ctx* ctx, planner_slot* slots,
+        uint64_t capacity, uint64_t* count);
+
+/*
+ * planner_status_str
+ *
+ * @return description of a status, never NULL
+ */
+const char* planner_status_str(planner_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _planner_api_h_ */
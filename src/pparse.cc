@@ -3,21 +3,138 @@
 #include <assert.h>
 #include "pparse.h"
 #include "planner.h"
+#include <ctype.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <iostream>
 #include <yaml-cpp/yaml.h>
 #include <boost/shared_ptr.hpp>
 
+namespace {
+    std::string cores_label("cores");
+    std::string resources_label("resources");
+    std::string speed_label("speed");
+    std::string network_label("network");
+    std::string bandwidth_label("bandwidth");
+    std::string latency_label("latency");
+    std::string unavailable_label("unavailable");
+
+    // parse a "resources" map, registering any new resource dimensions
+    resource_set
+    read_resources(const YAML::Node& node)
+    {
+        resource_set res;
+        for (YAML::Node::const_iterator itr = node.begin();
+                itr != node.end();
+                ++itr) {
+            resource_set::dim_t dim(
+                    resource_set::register_dimension(itr->first.as<std::string>()));
+            res.set(dim, itr->second.as<uint64_t>());
+        }
+        return res;
+    }
+}
+
+//
+// Compute nodes are either a plain core count:
+//
+//   compute_001: 8
+//
+// or a map with the core count and other resources:
+//
+//   compute_001:
+//       cores: 8
+//       speed: 1.5
+//       resources: { memory: 65536, scratch: 200 }
+//
+// speed is relative to the nodes that task execution times were measured
+// on and defaults to 1.0.
+//
+// An optional network entry describes the links between nodes:
+//
+//   network: { bandwidth: 100, latency: 5 }
+//
 int
-pparse::read_compute_file(compute::list* comp, const std::string& filename)
+pparse::read_compute_file(compute::list* comp, const std::string& filename,
+        network* net)
 {
     try {
         YAML::Node comp_base = YAML::LoadFile(filename.c_str());
         for (YAML::Node::const_iterator itr=comp_base.begin();
                 itr != comp_base.end();
                 ++itr) {
+            if (itr->first.Scalar().compare(network_label) == 0) {
+                uint64_t bandwidth = 0;
+                uint64_t latency = 0;
+                if (itr->second[bandwidth_label]) {
+                    bandwidth = itr->second[bandwidth_label].as<uint64_t>();
+                }
+                if (itr->second[latency_label]) {
+                    latency = itr->second[latency_label].as<uint64_t>();
+                }
+                if (net) {
+                    *net = network(bandwidth, latency);
+                }
+                continue;
+            }
+            if (!itr->second.IsMap()) {
+                boost::shared_ptr<compute>
+                    c(new compute(itr->first.Scalar(), itr->second.as<uint64_t>()));
+                comp->push_back(c);
+                continue;
+            }
+            uint64_t cores = 0;
+            double speed = 1.0;
+            resource_set res;
+            std::vector<std::pair<uint64_t, uint64_t> > down;
+            YAML::Node detail = itr->second;
+            for (YAML::Node::const_iterator ditr = detail.begin();
+                    ditr != detail.end();
+                    ++ditr) {
+                std::string key_str = ditr->first.as<std::string>();
+                if (key_str.compare(cores_label) == 0) {
+                    cores = ditr->second.as<uint64_t>();
+                    continue;
+                }
+                if (key_str.compare(resources_label) == 0) {
+                    res = read_resources(ditr->second);
+                    continue;
+                }
+                if (key_str.compare(speed_label) == 0) {
+                    speed = ditr->second.as<double>();
+                    continue;
+                }
+                if (key_str.compare(unavailable_label) == 0) {
+                    for (YAML::Node::const_iterator witr = ditr->second.begin();
+                            witr != ditr->second.end();
+                            ++witr) {
+                        uint64_t start = (*witr)[0].as<uint64_t>();
+                        uint64_t end = (*witr)[1].as<uint64_t>();
+                        if (end <= start) {
+                            std::cout << "Parse of compute file " << filename << " failed: "
+                                << itr->first.Scalar() << " unavailable window " << start
+                                << " to " << end << " is empty\n";
+                            return 1;
+                        }
+                        down.push_back(std::make_pair(start, end));
+                    }
+                    continue;
+                }
+            }
+            if (speed * task::unit_speed < 1.0) {
+                std::cout << "Parse of compute file " << filename << " failed: "
+                    << itr->first.Scalar() << " speed must be positive\n";
+                return 1;
+            }
+            uint32_t speed_fp = static_cast<uint32_t>(speed * task::unit_speed + 0.5);
             boost::shared_ptr<compute>
-                c(new compute(itr->first.Scalar(), itr->second.as<uint64_t>()));
+                c(new compute(itr->first.Scalar(), cores, res));
+            c->set_speed(speed_fp);
+            for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator witr = down.begin();
+                    witr != down.end();
+                    ++witr) {
+                c->add_unavailable(witr->first, witr->second);
+            }
             comp->push_back(c);
         }
     } catch (const YAML::Exception& e) {
@@ -31,6 +148,214 @@ namespace {
     std::string parent_tasks_label("parent_tasks");
     std::string execution_time_label("execution_time");
     std::string cores_required_label("cores_required");
+    std::string execution_spread_label("execution_spread");
+    std::string execution_distribution_label("execution_distribution");
+    std::string output_size_label("output_size");
+    std::string release_time_label("release_time");
+    std::string deadline_label("deadline");
+    std::string priority_label("priority");
+    std::string min_cores_label("min_cores");
+    std::string max_cores_label("max_cores");
+    std::string serial_fraction_label("serial_fraction");
+    std::string speedup_label("speedup");
+    std::string gang_label("gang");
+    std::string max_nodes_label("max_nodes");
+
+    // parse a "speedup" map of core counts to speedups
+    bool
+    read_speedup(const YAML::Node& node, task::speedup_table* table)
+    {
+        for (YAML::Node::const_iterator itr = node.begin();
+                itr != node.end();
+                ++itr) {
+            uint64_t cores(itr->first.as<uint64_t>());
+            double speedup(itr->second.as<double>());
+            if (cores == 0 || speedup <= 0) {
+                return false;
+            }
+            (*table)[cores] = speedup;
+        }
+        return !table->empty();
+    }
+
+    // parse one task entry, returns an empty pointer on error
+    task::ptr
+    read_task(const std::string& taskname, const YAML::Node& detail,
+            const std::string& filename)
+    {
+        std::string parent_tasks;
+        uint64_t cores = 0;
+        uint64_t exec_time = 0;
+        uint64_t exec_spread = 0;
+        uint64_t output_size = 0;
+        uint64_t release_time = 0;
+        uint64_t deadline = task::no_deadline;
+        uint64_t priority = 1;
+        uint64_t min_cores = 0;
+        uint64_t max_cores = 0;
+        double serial_fraction = 0;
+        task::speedup_table speedup;
+        bool gang = false;
+        uint64_t max_nodes = 0;
+        task::distribution exec_dist = task::normal;
+        resource_set res;
+
+        for (YAML::Node::const_iterator ditr = detail.begin();
+                ditr != detail.end();
+                ++ditr) {
+            YAML::Node key = ditr->first;
+            YAML::Node val = ditr->second;
+            std::string key_str = key.as<std::string>();
+            if (key_str.compare(execution_time_label) == 0) {
+                exec_time = val.as<uint64_t>();        
+                continue;
+            }
+            if (key_str.compare(cores_required_label) == 0) {
+                cores = val.as<uint64_t>();        
+                continue;
+            }
+            if (key_str.compare(parent_tasks_label) == 0) {
+                parent_tasks = val.as<std::string>();        
+                continue;
+            }
+            if (key_str.compare(resources_label) == 0) {
+                res = read_resources(val);
+                continue;
+            }
+            if (key_str.compare(execution_spread_label) == 0) {
+                exec_spread = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(output_size_label) == 0) {
+                output_size = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(release_time_label) == 0) {
+                release_time = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(deadline_label) == 0) {
+                deadline = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(priority_label) == 0) {
+                priority = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(min_cores_label) == 0) {
+                min_cores = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(max_cores_label) == 0) {
+                max_cores = val.as<uint64_t>();
+                continue;
+            }
+            if (key_str.compare(serial_fraction_label) == 0) {
+                serial_fraction = val.as<double>();
+                if (serial_fraction < 0 || serial_fraction > 1) {
+                    std::cout << "Parse of task file " << filename << " failed: "
+                        << taskname << " serial_fraction must be from 0 to 1\n";
+                    return task::ptr();
+                }
+                continue;
+            }
+            if (key_str.compare(gang_label) == 0) {
+                gang = val.as<bool>();
+                continue;
+            }
+            if (key_str.compare(max_nodes_label) == 0) {
+                max_nodes = val.as<uint64_t>();
+                gang = true;
+                continue;
+            }
+            if (key_str.compare(speedup_label) == 0) {
+                if (!read_speedup(val, &speedup)) {
+                    std::cout << "Parse of task file " << filename << " failed: "
+                        << taskname << " speedup needs positive core counts and speedups\n";
+                    return task::ptr();
+                }
+                continue;
+            }
+            if (key_str.compare(execution_distribution_label) == 0) {
+                if (!task::parse_distribution(val.as<std::string>(), &exec_dist)) {
+                    std::cout << "Parse of task file " << filename << " failed: "
+                        << taskname << " has unknown execution_distribution "
+                        << val.as<std::string>() << "\n";
+                    return task::ptr();
+                }
+                continue;
+            }
+        }
+        if (min_cores || max_cores) {
+            if (cores == 0) {
+                cores = min_cores ? min_cores : max_cores;
+            }
+            min_cores = min_cores ? min_cores : cores;
+            max_cores = max_cores ? max_cores : cores;
+            if (min_cores == 0 || min_cores > cores || cores > max_cores) {
+                std::cout << "Parse of task file " << filename << " failed: "
+                    << taskname << " needs 0 < min_cores <= cores_required <= max_cores\n";
+                return task::ptr();
+            }
+        }
+        if (exec_spread && exec_dist == task::lognormal && exec_time == 0) {
+            std::cout << "Parse of task file " << filename << " failed: "
+                << taskname << " needs an execution_time above 0 for a lognormal "
+                << "execution_distribution\n";
+            return task::ptr();
+        }
+        if (gang && min_cores) {
+            std::cout << "Parse of task file " << filename << " failed: "
+                << taskname << " can't be both a gang and moldable\n";
+            return task::ptr();
+        }
+        task::ptr t(new task(taskname.c_str(), cores, exec_time));
+        if (min_cores) {
+            t->set_core_range(min_cores, max_cores);
+        }
+        if (gang) {
+            t->set_gang(max_nodes);
+        }
+        if (serial_fraction) {
+            t->set_serial_fraction(serial_fraction);
+        }
+        if (!speedup.empty()) {
+            t->set_speedup_table(speedup);
+        }
+        if (!parent_tasks.empty()) {
+            t->set_dep_str(parent_tasks.c_str());
+        }
+        if (!res.empty()) {
+            t->set_resources(res);
+        }
+        if (exec_spread) {
+            t->set_duration_spread(exec_dist, exec_spread);
+        }
+        if (output_size) {
+            t->set_output_size(output_size);
+        }
+        if (release_time) {
+            t->set_release_time(release_time);
+        }
+        if (deadline != task::no_deadline) {
+            t->set_deadline(deadline);
+        }
+        if (priority != 1) {
+            t->set_priority(priority);
+        }
+        return t;
+    }
+
+    // a line that starts a new top-level entry
+    bool
+    is_entry_line(const std::string& line)
+    {
+        return !line.empty() && !isspace(line[0]) && line[0] != '#' &&
+            line[0] != '-' && line[0] != '.';
+    }
+
+    // poll interval when following a file that is still being written
+    const useconds_t follow_poll_usec = 100000;
 }
 
 int
@@ -41,34 +366,9 @@ pparse::read_tasks_file(task::list* tasks, const std::string& filename)
         for (YAML::Node::const_iterator itr=task_base.begin();
                 itr != task_base.end();
                 ++itr) {
-            std::string taskname(itr->first.Scalar());
-            std::string parent_tasks;
-            uint64_t cores = 0;
-            uint64_t exec_time = 0;
-
-            YAML::Node detail = itr->second;
-            for (YAML::Node::const_iterator ditr = detail.begin();
-                    ditr != detail.end();
-                    ++ditr) {
-                YAML::Node key = ditr->first;
-                YAML::Node val = ditr->second;
-                std::string key_str = key.as<std::string>();
-                if (key_str.compare(execution_time_label) == 0) {
-                    exec_time = val.as<uint64_t>();        
-                    continue;
-                }
-                if (key_str.compare(cores_required_label) == 0) {
-                    cores = val.as<uint64_t>();        
-                    continue;
-                }
-                if (key_str.compare(parent_tasks_label) == 0) {
-                    parent_tasks = val.as<std::string>();        
-                    continue;
-                }
-            }
-            boost::shared_ptr<task> t(new task(taskname.c_str(), cores, exec_time));
-            if (!parent_tasks.empty()) {
-                t->set_dep_str(parent_tasks.c_str());
+            task::ptr t(read_task(itr->first.Scalar(), itr->second, filename));
+            if (!t) {
+                return 1;
             }
             tasks->push_back(t);
         }
@@ -79,3 +379,93 @@ pparse::read_tasks_file(task::list* tasks, const std::string& filename)
     return 0;
 }
 
+pparse::task_stream::task_stream(std::istream& in, const std::string& source,
+        bool follow)
+    : _in(in), _source(source), _follow(follow), _done(false)
+{
+}
+
+//
+// next -- read lines up to the end of the next task entry
+//
+// An entry ends where the next one starts, at a "---" line or at the end
+// of input, which is a "..." line or, unless following, end of file.
+//
+int
+pparse::task_stream::next(task::ptr* t)
+{
+    t->reset();
+    std::string entry;
+    std::string line;
+    if (!_pending.empty()) {
+        entry.swap(_pending);
+    }
+    while (!_done && _getline(&line)) {
+        if (line.compare(0, 3, "...") == 0) {
+            _done = true;
+            break;
+        }
+        if (line.compare(0, 3, "---") == 0) {
+            if (entry.empty()) {
+                continue;
+            }
+            break;
+        }
+        if (is_entry_line(line) && !entry.empty()) {
+            _pending = line + "\n";
+            break;
+        }
+        if (entry.empty() && !is_entry_line(line)) {
+            continue;
+        }
+        entry += line + "\n";
+    }
+    if (entry.empty()) {
+        return 0;
+    }
+
+    try {
+        YAML::Node node = YAML::Load(entry);
+        YAML::Node::const_iterator itr(node.begin());
+        if (!node.IsMap() || itr == node.end()) {
+            std::cout << "Parse of task stream " << _source << " failed: "
+                << "expected a task entry\n";
+            return 1;
+        }
+        *t = read_task(itr->first.Scalar(), itr->second, _source);
+        if (!*t) {
+            return 1;
+        }
+    } catch (const YAML::Exception& e) {
+        std::cout << "Parse of task stream " << _source << " failed: " << e.msg << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// _getline -- read a whole line, waiting for more data when following
+bool
+pparse::task_stream::_getline(std::string* line)
+{
+    std::string part;
+    for (;;) {
+        if (std::getline(_in, part)) {
+            if (!_in.eof() || !_follow) {
+                *line = _partial + part;
+                _partial.clear();
+                return true;
+            }
+            // the writer hasn't finished this line yet
+            _partial += part;
+        } else if (!_follow) {
+            if (_partial.empty()) {
+                return false;
+            }
+            line->swap(_partial);
+            _partial.clear();
+            return true;
+        }
+        _in.clear();
+        usleep(follow_poll_usec);
+    }
+}
@@ -1,6 +1,8 @@
 
 #include "compute.h"
+#include "network.h"
 #include "task.h"
+#include <istream>
 #include <string>
 
 namespace pparse {
@@ -12,8 +14,11 @@ namespace pparse {
      * @param  comp  pointer to the output structure that stores the parsed compute entries
      *
      * @param  filename name of file to parse
+     *
+     * @param  net  if not NULL, set to the network described in the file
      */
-    int read_compute_file(compute::list* comp, const std::string& filename);
+    int read_compute_file(compute::list* comp, const std::string& filename,
+            network* net = NULL);
 
     /*
      * read_tasks_file
@@ -25,5 +30,46 @@ namespace pparse {
      * @param  filename name of file to parse
      */
     int read_tasks_file(task::list* task, const std::string& filename);
-}
 
+    /*
+     * @class task_stream
+     *
+     * Reads task entries, in the task file format, one at a time from a
+     * stream while it is still being written, e.g. stdin or a file being
+     * appended to.  An entry is complete when the next entry or a "---"
+     * line starts.  Input ends at end of file or, when following a file,
+     * at a "..." line.
+     */
+    class task_stream {
+    public:
+        /*
+         * task_stream
+         *
+         * @param  in      stream to read
+         * @param  source  name of the stream for error messages
+         * @param  follow  wait for more data at end of file, like tail -f
+         */
+        task_stream(std::istream& in, const std::string& source, bool follow);
+
+        /*
+         * next
+         *
+         * Reads the next task entry, blocking until it is complete.
+         *
+         * @param  t  set to the new task, or empty at the end of input
+         *
+         * @return 0 on success, 1 on a parse error
+         */
+        int next(task::ptr* t);
+
+    private:
+        bool _getline(std::string* line);
+
+        std::istream& _in;
+        std::string _source;
+        bool _follow;
+        bool _done;
+        std::string _pending;   // first line of the next entry
+        std::string _partial;   // unterminated line seen while following
+    };
+}
@@ -0,0 +1,114 @@
+
+#include "resource.h"
+#include <algorithm>
+#include <assert.h>
+
+std::vector<std::string> resource_set::_dim_names;
+
+resource_set::resource_set()
+{
+}
+
+void
+resource_set::set(dim_t dim, uint64_t amount)
+{
+    assert(dim < _dim_names.size());
+    if (_amount.size() <= dim) {
+        _amount.resize(dim+1, 0);
+    }
+    _amount[dim] = amount;
+}
+
+uint64_t
+resource_set::get(dim_t dim) const
+{
+    if (dim >= _amount.size()) {
+        return 0;
+    }
+    return _amount[dim];
+}
+
+bool
+resource_set::empty() const
+{
+    for (std::vector<uint64_t>::const_iterator itr(_amount.begin());
+            itr != _amount.end();
+            ++itr) {
+        if (*itr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+resource_set::fits(const resource_set& avail) const
+{
+    for (dim_t dim(0); dim < _amount.size(); ++dim) {
+        if (_amount[dim] > avail.get(dim)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+resource_set&
+resource_set::operator+=(const resource_set& rhs)
+{
+    if (_amount.size() < rhs._amount.size()) {
+        _amount.resize(rhs._amount.size(), 0);
+    }
+    for (dim_t dim(0); dim < rhs._amount.size(); ++dim) {
+        _amount[dim] += rhs._amount[dim];
+    }
+    return *this;
+}
+
+resource_set&
+resource_set::operator-=(const resource_set& rhs)
+{
+    for (dim_t dim(0); dim < rhs._amount.size(); ++dim) {
+        assert(dim < _amount.size() && _amount[dim] >= rhs._amount[dim]);
+        _amount[dim] -= rhs._amount[dim];
+    }
+    return *this;
+}
+
+// statics
+
+resource_set::dim_t
+resource_set::register_dimension(const std::string& name)
+{
+    std::vector<std::string>::iterator itr(
+            std::find(_dim_names.begin(), _dim_names.end(), name));
+    if (itr != _dim_names.end()) {
+        return itr - _dim_names.begin();
+    }
+    _dim_names.push_back(name);
+    return _dim_names.size() - 1;
+}
+
+resource_set::dim_t
+resource_set::dimension_count()
+{
+    return _dim_names.size();
+}
+
+const std::string&
+resource_set::dimension_name(dim_t dim)
+{
+    assert(dim < _dim_names.size());
+    return _dim_names[dim];
+}
+
+// friend ostream operator
+
+std::ostream&
+operator<<(std::ostream& os, const resource_set& res)
+{
+    for (resource_set::dim_t dim(0); dim < res._amount.size(); ++dim) {
+        os << (dim ? ", " : "") << resource_set::_dim_names[dim] << "="
+            << res._amount[dim];
+    }
+    return os;
+}
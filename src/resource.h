@@ -0,0 +1,100 @@
+
+#ifndef _resource_h_
+#define _resource_h_
+
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * @class resource_set
+ *
+ * Models the non-core resources (memory, scratch disk, ...) that a compute
+ * node provides or a task requires.
+ *
+ * Resource dimensions are named and registered in a static table while the
+ * input files are parsed, so every resource_set indexes a given dimension by
+ * the same number.  A dimension missing from a set has a quantity of zero.
+ */
+class resource_set
+{
+public:
+    typedef uint32_t dim_t;
+
+    resource_set();
+
+    /*
+     * set
+     *
+     * Sets the quantity of a resource dimension.
+     *
+     * @param[in]  dim     dimension index (see register_dimension)
+     * @param[in]  amount  quantity of the resource
+     */
+    void set(dim_t dim, uint64_t amount);
+
+    /*
+     * get
+     *
+     * @param[in]  dim  dimension index
+     *
+     * @return quantity of the resource, zero if not present
+     */
+    uint64_t get(dim_t dim) const;
+
+    /*
+     * empty
+     *
+     * @return true if no dimension has a non-zero quantity
+     */
+    bool empty() const;
+
+    /*
+     * fits
+     *
+     * @param[in]  avail  available resources
+     *
+     * @return true if every dimension of this set fits within avail
+     */
+    bool fits(const resource_set& avail) const;
+
+    resource_set& operator+=(const resource_set& rhs);
+    resource_set& operator-=(const resource_set& rhs);
+
+    /*
+     * register_dimension
+     *
+     * Looks up a resource dimension by name, adding it if it is new.
+     *
+     * @param[in]  name  name of the resource (e.g., "memory")
+     *
+     * @return dimension index
+     */
+    static dim_t register_dimension(const std::string& name);
+
+    /*
+     * dimension_count
+     *
+     * @return number of registered resource dimensions
+     */
+    static dim_t dimension_count();
+
+    /*
+     * dimension_name
+     *
+     * @return name of the specified dimension
+     */
+    static const std::string& dimension_name(dim_t dim);
+
+    friend std::ostream& operator<<(std::ostream& os, const resource_set& res);
+
+private:
+    std::vector<uint64_t> _amount;
+
+    static std::vector<std::string> _dim_names;
+};
+
+std::ostream& operator<<(std::ostream& os, const resource_set& res);
+
+#endif // _resource_h_
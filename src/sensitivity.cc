@@ -0,0 +1,195 @@
+#include "sensitivity.h"
+#include "parallel.h"
+#include <algorithm>
+
+namespace {
+    typedef sim_model::index_t index_t;
+
+    // earlier start first, ties in topological order
+    class start_order {
+    public:
+        start_order(const std::vector<uint64_t>& start, const std::vector<index_t>& topo_pos)
+            : _start(start), _topo_pos(topo_pos)
+        {
+        }
+        bool operator()(index_t lt, index_t rt) const
+        {
+            if (_start[lt] != _start[rt]) {
+                return _start[lt] < _start[rt];
+            }
+            return _topo_pos[lt] < _topo_pos[rt];
+        }
+    private:
+        const std::vector<uint64_t>& _start;
+        const std::vector<index_t>& _topo_pos;
+    };
+
+    // largest estimate first, then least slack, then earliest start
+    class gain_order {
+    public:
+        gain_order(const sensitivity::report& rep)
+            : _rep(rep)
+        {
+        }
+        bool operator()(index_t lt, index_t rt) const
+        {
+            if (_rep.estimate[lt] != _rep.estimate[rt]) {
+                return _rep.estimate[lt] > _rep.estimate[rt];
+            }
+            uint64_t lslack(_rep.latest_start[lt] - _rep.start[lt]);
+            uint64_t rslack(_rep.latest_start[rt] - _rep.start[rt]);
+            if (lslack != rslack) {
+                return lslack < rslack;
+            }
+            if (_rep.start[lt] != _rep.start[rt]) {
+                return _rep.start[lt] < _rep.start[rt];
+            }
+            return lt < rt;
+        }
+    private:
+        const sensitivity::report& _rep;
+    };
+
+    // largest confirmed gain first
+    class confirmed_order {
+    public:
+        confirmed_order(const sensitivity::report& rep)
+            : _rep(rep)
+        {
+        }
+        bool operator()(index_t lt, index_t rt) const
+        {
+            return _rep.shortened[lt] < _rep.shortened[rt];
+        }
+    private:
+        const sensitivity::report& _rep;
+    };
+
+    // execution time with half of it cut, never less than one tick
+    uint64_t
+    halved(uint64_t ticks)
+    {
+        return std::max<uint64_t>(1, ticks - ticks / 2);
+    }
+}
+
+//
+// sensitivity -- topological positions, by Kahn's algorithm
+//
+sensitivity::sensitivity(const sim_model& model)
+    : _model(model)
+{
+    index_t n(model.task_count());
+    std::vector<index_t> deps_left(n);
+    std::vector<index_t> ready;
+    ready.reserve(n);
+    for (index_t ix(0); ix < n; ++ix) {
+        deps_left[ix] = model.dependencies_end(ix) - model.dependencies_begin(ix);
+        if (deps_left[ix] == 0) {
+            ready.push_back(ix);
+        }
+    }
+    _topo_pos.resize(n);
+    for (index_t next(0); next < ready.size(); ++next) {
+        index_t t(ready[next]);
+        _topo_pos[t] = next;
+        for (const index_t* w(model.waiters_begin(t)); w != model.waiters_end(t); ++w) {
+            if (--deps_left[*w] == 0) {
+                ready.push_back(*w);
+            }
+        }
+    }
+}
+
+//
+// run -- slack from a forward and a backward pass, then the ranking
+//
+// 1. replay the plan for the earliest start and finish of every task
+// 2. visit the tasks in reverse start order; a task's latest finish is the
+//    makespan or the least latest start of its waiters and of the task it
+//    released cores to, if that is sooner
+// 3. estimate what running each task for half its time saves and rank
+// 4. simulate the plan with each of the top tasks shortened, and rank
+//    those by the makespan they confirm, ties in estimate order
+//
+sensitivity::report
+sensitivity::run(const std::vector<index_t>& rank, const std::vector<index_t>& node,
+        uint64_t confirm, unsigned threads) const
+{
+    index_t n(_model.task_count());
+    report rep;
+
+    // 1. forward
+    sim_model::result res;
+    rep.makespan = _model.simulate(_model.execution_times(), rank, &node, &res);
+    rep.start.swap(res.start);
+    rep.finish.swap(res.finish);
+    rep.node.swap(res.node);
+
+    // 2. backward; a task that runs for no time holds no cores, so only its
+    // dependency links count
+    std::vector<index_t> order(n);
+    for (index_t ix(0); ix < n; ++ix) {
+        order[ix] = ix;
+    }
+    std::sort(order.begin(), order.end(), start_order(rep.start, _topo_pos));
+    std::vector<uint64_t> latest_finish(n, rep.makespan);
+    rep.latest_start.resize(n);
+    for (std::vector<index_t>::reverse_iterator itr(order.rbegin()); itr != order.rend(); ++itr) {
+        index_t t(*itr);
+        uint64_t latest(latest_finish[t] - (rep.finish[t] - rep.start[t]));
+        rep.latest_start[t] = latest;
+        for (const index_t* dep(_model.dependencies_begin(t));
+                dep != _model.dependencies_end(t);
+                ++dep) {
+            latest_finish[*dep] = std::min(latest_finish[*dep], latest);
+        }
+        index_t p(res.pred[t]);
+        if (p != sim_model::none && rep.finish[p] > rep.start[p]) {
+            latest_finish[p] = std::min(latest_finish[p], latest);
+        }
+    }
+
+    // 3. rank
+    rep.estimate.resize(n);
+    rep.critical = 0;
+    for (index_t ix(0); ix < n; ++ix) {
+        uint64_t ran(rep.finish[ix] - rep.start[ix]);
+        uint64_t saved(ran - std::min(ran, halved(ran)));
+        uint64_t slack(rep.latest_start[ix] - rep.start[ix]);
+        rep.estimate[ix] = saved > slack ? saved - slack : 0;
+        rep.critical += slack == 0;
+    }
+    rep.ranked.swap(order);
+    std::sort(rep.ranked.begin(), rep.ranked.end(), gain_order(rep));
+
+    // 4. confirm
+    rep.shortened.assign(n, 0);
+    confirm = std::min<uint64_t>(confirm, n);
+    if (confirm) {
+        parallel::parallel_for(confirm, threads,
+                boost::bind(&sensitivity::_confirm, this, _1, _2, &rank, &node, &rep));
+        std::stable_sort(rep.ranked.begin(), rep.ranked.begin() + confirm,
+                confirmed_order(rep));
+    }
+    return rep;
+}
+
+//
+// _confirm -- simulate the plan with one ranked task shortened at a time
+//
+// Each call writes only the makespans of its own tasks.
+//
+void
+sensitivity::_confirm(uint64_t begin, uint64_t end, const std::vector<index_t>* rank,
+        const std::vector<index_t>* node, report* rep) const
+{
+    std::vector<uint64_t> duration(_model.execution_times());
+    for (uint64_t pos(begin); pos < end; ++pos) {
+        index_t t(rep->ranked[pos]);
+        uint64_t nominal(duration[t]);
+        duration[t] = nominal ? halved(nominal) : 0;
+        rep->shortened[t] = _model.simulate(duration, *rank, node, NULL);
+        duration[t] = nominal;
+    }
+}
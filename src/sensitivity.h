@@ -0,0 +1,84 @@
+#ifndef _sensitivity_h_
+#define _sensitivity_h_
+
+#include "sim.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class sensitivity
+ *
+ * Slack of every task in a plan and which tasks are worth making faster.
+ * The plan is replayed with sim_model::simulate() for each task's earliest
+ * start (the forward pass), then walked back from the makespan for the
+ * latest start that doesn't delay the end (the backward pass).  A task
+ * must finish before its waiters start, and before the task it released
+ * cores to starts, so both links carry the latest start back.  Slack is
+ * the latest start less the earliest.
+ *
+ * A task has at most one core link, its sim_model::result::pred: the
+ * last task to finish on its node before it started, unless that start
+ * was set by a dependency.  When several tasks together freed the cores
+ * it started on, only the last of them is linked to it, so the others'
+ * slack can be larger than it really is.
+ *
+ * Running a task for half its time can shorten the plan by at most the
+ * half it saves less its slack; tasks are ranked by that estimate.  The
+ * top candidates can be confirmed by simulating the plan again with each
+ * of them shortened, one simulation per task, split across threads, and
+ * are then ranked first, by the makespan they confirm.
+ */
+class sensitivity
+{
+public:
+    typedef sim_model::index_t index_t;
+
+    /*
+     * @struct _report
+     *
+     * Schedule and slack by task index, and the tasks in rank order.
+     * shortened[i] is the makespan with task i running for half its time,
+     * or 0 if that wasn't simulated.
+     */
+    struct _report {
+        uint64_t makespan;
+        std::vector<uint64_t> start;
+        std::vector<uint64_t> finish;
+        std::vector<uint64_t> latest_start;
+        std::vector<index_t> node;
+        std::vector<uint64_t> estimate;     // estimated makespan reduction
+        std::vector<uint64_t> shortened;
+        std::vector<index_t> ranked;        // confirmed, then largest estimate first
+        uint64_t critical;                  // tasks without slack
+    };
+    typedef _report report;
+
+    /*
+     * sensitivity
+     *
+     * @param[in]  model  simulation model of the validated tasks
+     */
+    sensitivity(const sim_model& model);
+
+    /*
+     * run
+     *
+     * @param[in]  rank     start position of each task in the plan
+     * @param[in]  node     node of each task in the plan
+     * @param[in]  confirm  number of top ranked tasks to simulate shortened
+     * @param[in]  threads  number of threads to simulate on
+     *
+     * @return slack and ranking of the tasks
+     */
+    report run(const std::vector<index_t>& rank, const std::vector<index_t>& node,
+            uint64_t confirm, unsigned threads) const;
+
+private:
+    void _confirm(uint64_t begin, uint64_t end, const std::vector<index_t>* rank,
+            const std::vector<index_t>* node, report* rep) const;
+
+    const sim_model& _model;
+    std::vector<index_t> _topo_pos;     // position in a topological order
+};
+
+#endif // _sensitivity_h_
@@ -0,0 +1,423 @@
+
+#include "sim.h"
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <queue>
+#include <set>
+
+namespace {
+    // greedy planner priority: most cores first, then most waiters
+    class policy_sort {
+    public:
+        policy_sort(const std::vector<int64_t>& cores,
+                const std::vector<uint64_t>& waiters)
+            : _cores(cores), _waiters(waiters)
+        {
+        }
+        bool operator()(sim_model::index_t lt, sim_model::index_t rt) const
+        {
+            if (_cores[lt] != _cores[rt]) {
+                return _cores[lt] > _cores[rt];
+            }
+            if (_waiters[lt] != _waiters[rt]) {
+                return _waiters[lt] > _waiters[rt];
+            }
+            return lt < rt;
+        }
+    private:
+        const std::vector<int64_t>& _cores;
+        const std::vector<uint64_t>& _waiters;
+    };
+
+    typedef std::pair<sim_model::index_t, sim_model::index_t> ready_entry; // rank, task
+    typedef std::pair<uint64_t, sim_model::index_t> running_entry;         // finish, task
+    typedef std::priority_queue<running_entry, std::vector<running_entry>,
+            std::greater<running_entry> > running_queue;
+}
+
+const sim_model::index_t sim_model::none;
+
+sim_model::sim_model(const compute::list& comp, const task::list& tasks)
+{
+    index_t n(tasks.size());
+    _ticks.reserve(n);
+    _cores.reserve(n);
+    _waiter_count.reserve(n);
+    bool any_res(false);
+    for (task::list::const_iterator itr(tasks.begin());
+            itr != tasks.end();
+            ++itr) {
+        if (_by_id.size() <= (*itr)->get_id()) {
+            _by_id.resize((*itr)->get_id() + 1, none);
+        }
+        _by_id[(*itr)->get_id()] = itr - tasks.begin();
+        _ticks.push_back((*itr)->get_execution_time());
+        _cores.push_back((*itr)->get_cores_required());
+        _waiter_count.push_back((*itr)->get_waiter_count());
+        any_res = any_res || !(*itr)->get_resources().empty();
+    }
+    if (any_res) {
+        _res.reserve(n);
+        for (task::list::const_iterator itr(tasks.begin());
+                itr != tasks.end();
+                ++itr) {
+            _res.push_back((*itr)->get_resources());
+        }
+    }
+
+    // dependencies, then waiters by counting and prefix sum
+    std::vector<index_t> wait_count(n + 1, 0);
+    _dep_begin.reserve(n + 1);
+    for (task::list::const_iterator itr(tasks.begin());
+            itr != tasks.end();
+            ++itr) {
+        _dep_begin.push_back(_deps.size());
+        task::ptr_range deps((*itr)->dependencies());
+        for (task::ptr_list::const_iterator dep(deps.begin());
+                dep != deps.end();
+                ++dep) {
+            index_t d(_by_id[(*dep)->get_id()]);
+            _deps.push_back(d);
+            ++wait_count[d + 1];
+        }
+    }
+    _dep_begin.push_back(_deps.size());
+    for (index_t ix(0); ix < n; ++ix) {
+        wait_count[ix + 1] += wait_count[ix];
+    }
+    _wait_begin = wait_count;
+    _waiters.resize(_deps.size());
+    for (index_t ix(0); ix < n; ++ix) {
+        for (index_t d(_dep_begin[ix]); d < _dep_begin[ix + 1]; ++d) {
+            _waiters[wait_count[_deps[d]]++] = ix;
+        }
+    }
+
+    for (compute::list::const_iterator itr(comp.begin());
+            itr != comp.end();
+            ++itr) {
+        _node.push_back(itr->get());
+        _node_cores.push_back((*itr)->get_cores());
+        _node_res.push_back((*itr)->get_resources());
+        _node_speed.push_back((*itr)->get_speed());
+    }
+}
+
+sim_model::index_t
+sim_model::task_count() const
+{
+    return _ticks.size();
+}
+
+sim_model::index_t
+sim_model::node_count() const
+{
+    return _node.size();
+}
+
+sim_model::index_t
+sim_model::task_index(const task* t) const
+{
+    return _by_id[t->get_id()];
+}
+
+sim_model::index_t
+sim_model::node_index(const compute* c) const
+{
+    std::vector<const compute*>::const_iterator itr(
+            std::find(_node.begin(), _node.end(), c));
+    return itr == _node.end() ? none : itr - _node.begin();
+}
+
+bool
+sim_model::can_host(index_t ix, index_t node) const
+{
+    return _cores[ix] <= _node_cores[node] &&
+        (_res.empty() || _res[ix].fits(_node_res[node]));
+}
+
+int64_t
+sim_model::cores_required(index_t ix) const
+{
+    return _cores[ix];
+}
+
+int64_t
+sim_model::node_cores(index_t node) const
+{
+    return _node_cores[node];
+}
+
+uint32_t
+sim_model::node_speed(index_t node) const
+{
+    return _node_speed[node];
+}
+
+bool
+sim_model::has_resources() const
+{
+    return !_res.empty();
+}
+
+const resource_set&
+sim_model::task_resources(index_t ix) const
+{
+    return _res[ix];
+}
+
+const resource_set&
+sim_model::node_resources(index_t node) const
+{
+    return _node_res[node];
+}
+
+uint64_t
+sim_model::ticks_on(index_t ix, index_t node) const
+{
+    return _ticks_at(_ticks[ix], _node_speed[node]);
+}
+
+// _ticks_at -- ticks to run a duration at a speed, rounded up
+uint64_t
+sim_model::_ticks_at(uint64_t duration, uint32_t speed)
+{
+    return (duration * task::unit_speed + speed - 1) / speed;
+}
+
+const std::vector<uint64_t>&
+sim_model::execution_times() const
+{
+    return _ticks;
+}
+
+const sim_model::index_t*
+sim_model::dependencies_begin(index_t ix) const
+{
+    return _deps.empty() ? NULL : &_deps[0] + _dep_begin[ix];
+}
+
+const sim_model::index_t*
+sim_model::dependencies_end(index_t ix) const
+{
+    return _deps.empty() ? NULL : &_deps[0] + _dep_begin[ix + 1];
+}
+
+const sim_model::index_t*
+sim_model::waiters_begin(index_t ix) const
+{
+    return _waiters.empty() ? NULL : &_waiters[0] + _wait_begin[ix];
+}
+
+const sim_model::index_t*
+sim_model::waiters_end(index_t ix) const
+{
+    return _waiters.empty() ? NULL : &_waiters[0] + _wait_begin[ix + 1];
+}
+
+std::vector<sim_model::index_t>
+sim_model::policy_rank() const
+{
+    std::vector<index_t> order(task_count());
+    for (index_t ix(0); ix < order.size(); ++ix) {
+        order[ix] = ix;
+    }
+    std::sort(order.begin(), order.end(), policy_sort(_cores, _waiter_count));
+    std::vector<index_t> rank(order.size());
+    for (index_t ix(0); ix < order.size(); ++ix) {
+        rank[order[ix]] = ix;
+    }
+    return rank;
+}
+
+//
+// simulate -- event driven list scheduling
+//
+// 1. tasks without dependencies are ready at tick 0
+// 2. start ready tasks in rank order on the best fitting (or fixed) node
+// 3. advance to the next completion, release its cores and make waiters
+//    whose dependencies are all complete ready
+// 4. repeat until every task has completed
+//
+// With fixed nodes, the nodes don't compete for tasks, so each keeps its
+// own ready tasks and step 2 only looks at the nodes that freed cores or
+// got ready tasks since it last did.  That starts the same tasks as a look
+// at every ready task, without going over the ones still waiting for a
+// busy node at every completion.
+//
+uint64_t
+sim_model::simulate(const std::vector<uint64_t>& duration,
+        const std::vector<index_t>& rank,
+        const std::vector<index_t>* fixed_node,
+        result* out) const
+{
+    index_t n(task_count());
+    index_t nodes(node_count());
+    assert(duration.size() == n && rank.size() == n);
+
+    std::vector<index_t> deps_left(n);
+    std::vector<index_t> binding_dep(n, none);   // last dependency to finish
+    std::vector<uint64_t> ready_at(n, 0);
+    std::vector<int64_t> free_cores(_node_cores);
+    std::vector<resource_set> free_res;
+    if (!_res.empty()) {
+        free_res = _node_res;
+    }
+    std::vector<index_t> last_done(nodes, none); // last task to finish per node
+    std::vector<index_t> node_of(n, none);
+    std::vector<uint64_t> start(out ? n : 0);
+    std::vector<uint64_t> finish(out ? n : 0);
+    std::vector<index_t> pred(out ? n : 0, none);
+
+    std::set<ready_entry> ready;                     // without fixed nodes
+    std::vector<std::set<ready_entry> > node_ready(fixed_node ? nodes : 0);
+    std::vector<char> changed(fixed_node ? nodes : 0, 0);
+    std::vector<index_t> changed_nodes;
+    for (index_t ix(0); ix < n; ++ix) {
+        deps_left[ix] = _dep_begin[ix + 1] - _dep_begin[ix];
+        if (deps_left[ix] == 0) {
+            if (fixed_node) {
+                index_t f((*fixed_node)[ix]);
+                node_ready[f].insert(std::make_pair(rank[ix], ix));
+                if (!changed[f]) {
+                    changed[f] = 1;
+                    changed_nodes.push_back(f);
+                }
+            } else {
+                ready.insert(std::make_pair(rank[ix], ix));
+            }
+        }
+    }
+
+    running_queue running;
+    std::vector<std::set<ready_entry>*> look;
+    uint64_t now(0);
+    index_t done(0);
+    while (done < n) {
+        look.clear();
+        if (fixed_node) {
+            for (index_t ix(0); ix < changed_nodes.size(); ++ix) {
+                look.push_back(&node_ready[changed_nodes[ix]]);
+                changed[changed_nodes[ix]] = 0;
+            }
+            changed_nodes.clear();
+        } else {
+            look.push_back(&ready);
+        }
+        for (index_t q(0); q < look.size(); ++q) {
+            std::set<ready_entry>& queue(*look[q]);
+            int64_t max_free(queue.empty() ? 0 : fixed_node ?
+                    free_cores[(*fixed_node)[queue.begin()->second]] :
+                    *std::max_element(free_cores.begin(), free_cores.end()));
+            for (std::set<ready_entry>::iterator itr(queue.begin());
+                    itr != queue.end() && max_free > 0;
+                    ) {
+                index_t t(itr->second);
+                index_t node(none);
+                if (_cores[t] <= max_free) {
+                    if (fixed_node) {
+                        index_t f((*fixed_node)[t]);
+                        if (_cores[t] <= free_cores[f] &&
+                                (_res.empty() || _res[t].fits(free_res[f]))) {
+                            node = f;
+                        }
+                    } else {
+                        for (index_t c(0); c < nodes; ++c) {
+                            if (_cores[t] <= free_cores[c] &&
+                                    (node == none || free_cores[c] < free_cores[node]) &&
+                                    (_res.empty() || _res[t].fits(free_res[c]))) {
+                                node = c;
+                            }
+                        }
+                    }
+                }
+                if (node == none) {
+                    ++itr;
+                    continue;
+                }
+
+                // start the task
+                free_cores[node] -= _cores[t];
+                if (!_res.empty()) {
+                    free_res[node] -= _res[t];
+                }
+                uint64_t ticks(_ticks_at(duration[t], _node_speed[node]));
+                running.push(std::make_pair(now + ticks, t));
+                node_of[t] = node;
+                if (out) {
+                    start[t] = now;
+                    finish[t] = now + ticks;
+                    pred[t] = (binding_dep[t] != none && ready_at[t] == now) ?
+                        binding_dep[t] : last_done[node];
+                }
+                queue.erase(itr++);
+                if (fixed_node) {
+                    max_free = free_cores[node];
+                } else if (free_cores[node] == max_free - _cores[t]) {
+                    max_free = *std::max_element(free_cores.begin(), free_cores.end());
+                }
+            }
+        }
+
+        // advance to the next completion
+        assert(!running.empty());
+        now = running.top().first;
+        while (!running.empty() && running.top().first == now) {
+            index_t t(running.top().second);
+            running.pop();
+            index_t node(node_of[t]);
+            free_cores[node] += _cores[t];
+            if (!_res.empty()) {
+                free_res[node] += _res[t];
+            }
+            last_done[node] = t;
+            ++done;
+            if (fixed_node && !changed[node]) {
+                changed[node] = 1;
+                changed_nodes.push_back(node);
+            }
+            for (index_t w(_wait_begin[t]); w < _wait_begin[t + 1]; ++w) {
+                index_t waiter(_waiters[w]);
+                binding_dep[waiter] = t;
+                ready_at[waiter] = now;
+                if (--deps_left[waiter] == 0) {
+                    if (fixed_node) {
+                        index_t f((*fixed_node)[waiter]);
+                        node_ready[f].insert(std::make_pair(rank[waiter], waiter));
+                        if (!changed[f]) {
+                            changed[f] = 1;
+                            changed_nodes.push_back(f);
+                        }
+                    } else {
+                        ready.insert(std::make_pair(rank[waiter], waiter));
+                    }
+                }
+            }
+        }
+    }
+
+    if (out) {
+        out->makespan = now;
+        out->start.swap(start);
+        out->finish.swap(finish);
+        out->node.swap(node_of);
+        out->pred.swap(pred);
+    }
+    return now;
+}
+
+void
+sim_model::critical_chain(const result& res, std::vector<index_t>* chain)
+{
+    chain->clear();
+    index_t last(none);
+    for (index_t ix(0); ix < res.finish.size(); ++ix) {
+        if (last == none || res.finish[ix] > res.finish[last]) {
+            last = ix;
+        }
+    }
+    for (index_t t(last); t != none; t = res.pred[t]) {
+        chain->push_back(t);
+    }
+}
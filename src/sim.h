@@ -0,0 +1,221 @@
+
+#ifndef _sim_h_
+#define _sim_h_
+
+#include "compute.h"
+#include "resource.h"
+#include "task.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+ * @class sim_model
+ *
+ * A compact, read-only copy of a validated task graph and compute pool for
+ * simulating many alternative plans quickly.
+ *
+ * The planner simulates by changing the state of the task and compute
+ * objects, so it can only run one plan at a time.  A sim_model keeps the
+ * graph in flat arrays indexed by task position and all simulation state
+ * on the stack of simulate(), so any number of threads may simulate against
+ * one model at once.
+ *
+ * simulate() is a list scheduler: whenever cores are released, ready tasks
+ * are started in priority order on the node with the fewest free cores that
+ * fits them, or on a fixed node when replaying a plan.
+ */
+class sim_model
+{
+public:
+    typedef uint32_t index_t;
+    static const index_t none = UINT32_MAX;
+
+    /*
+     * @struct _result
+     *
+     * The outcome of one simulation, indexed by task.  pred is the task
+     * whose completion allowed this task to start (a dependency or the task
+     * that released its cores), none if it started at tick 0.
+     */
+    struct _result {
+        uint64_t makespan;
+        std::vector<uint64_t> start;
+        std::vector<uint64_t> finish;
+        std::vector<index_t> node;
+        std::vector<index_t> pred;
+    };
+    typedef _result result;
+
+    /*
+     * sim_model
+     *
+     * Builds a model from validated tasks (dependencies mapped) and the
+     * compute nodes they run on.
+     *
+     * @param[in]  comp   compute nodes
+     * @param[in]  tasks  tasks, indexed by position in this list
+     */
+    sim_model(const compute::list& comp, const task::list& tasks);
+
+    /*
+     * task_count
+     *
+     * @return number of tasks in the model
+     */
+    index_t task_count() const;
+
+    /*
+     * node_count
+     *
+     * @return number of compute nodes in the model
+     */
+    index_t node_count() const;
+
+    /*
+     * task_index
+     *
+     * @return index of the task in the model
+     */
+    index_t task_index(const task* t) const;
+
+    /*
+     * node_index
+     *
+     * @return index of the compute node in the model, none if not found
+     */
+    index_t node_index(const compute* c) const;
+
+    /*
+     * can_host
+     *
+     * @param[in]  ix    task index
+     * @param[in]  node  node index
+     *
+     * @return true if the node has the cores and resources to run the task
+     */
+    bool can_host(index_t ix, index_t node) const;
+
+    /*
+     * cores_required, node_cores, node_speed
+     *
+     * @return cores a task needs, cores a node has, or a node's speed
+     *         factor (task::unit_speed is nominal)
+     */
+    int64_t cores_required(index_t ix) const;
+    int64_t node_cores(index_t node) const;
+    uint32_t node_speed(index_t node) const;
+
+    /*
+     * has_resources
+     *
+     * @return true if any task needs resources besides cores
+     */
+    bool has_resources() const;
+
+    /*
+     * task_resources, node_resources
+     *
+     * Only valid when has_resources() is true.
+     *
+     * @return resources a task needs, or resources a node has
+     */
+    const resource_set& task_resources(index_t ix) const;
+    const resource_set& node_resources(index_t node) const;
+
+    /*
+     * ticks_on
+     *
+     * @param[in]  ix    task index
+     * @param[in]  node  node index
+     *
+     * @return nominal execution time of the task at the node's speed, as
+     *         simulate() runs it
+     */
+    uint64_t ticks_on(index_t ix, index_t node) const;
+
+    /*
+     * execution_times
+     *
+     * @return nominal execution time of each task
+     */
+    const std::vector<uint64_t>& execution_times() const;
+
+    /*
+     * dependencies_begin, dependencies_end
+     *
+     * @param[in]  ix  task index
+     *
+     * @return range of the indexes of the task's dependencies
+     */
+    const index_t* dependencies_begin(index_t ix) const;
+    const index_t* dependencies_end(index_t ix) const;
+
+    /*
+     * waiters_begin, waiters_end
+     *
+     * @param[in]  ix  task index
+     *
+     * @return range of the indexes of the tasks depending on the task
+     */
+    const index_t* waiters_begin(index_t ix) const;
+    const index_t* waiters_end(index_t ix) const;
+
+    /*
+     * policy_rank
+     *
+     * Ranks tasks the way the greedy planner does: most cores first, then
+     * most waiters.
+     *
+     * @return priority of each task, lower values start first
+     */
+    std::vector<index_t> policy_rank() const;
+
+    /*
+     * simulate
+     *
+     * Simulates a plan.
+     *
+     * @param[in]  duration    execution time of each task on a nominal node
+     * @param[in]  rank        priority of each task, lower values start first
+     * @param[in]  fixed_node  node for each task, or NULL to pick best fit
+     * @param[out] out         per-task schedule, may be NULL
+     *
+     * @return makespan in ticks
+     */
+    uint64_t simulate(const std::vector<uint64_t>& duration,
+            const std::vector<index_t>& rank,
+            const std::vector<index_t>* fixed_node,
+            result* out) const;
+
+    /*
+     * critical_chain
+     *
+     * Follows pred links back from the last task to finish.
+     *
+     * @param[in]  res  result of simulate()
+     * @param[out] chain  tasks on the critical chain, last task first
+     */
+    static void critical_chain(const result& res, std::vector<index_t>* chain);
+
+private:
+    static uint64_t _ticks_at(uint64_t duration, uint32_t speed);
+
+    // tasks
+    std::vector<uint64_t> _ticks;
+    std::vector<int64_t> _cores;
+    std::vector<uint64_t> _waiter_count; // as declared, see task::get_waiter_count()
+    std::vector<resource_set> _res;
+    std::vector<index_t> _dep_begin;    // CSR offsets into _deps
+    std::vector<index_t> _deps;
+    std::vector<index_t> _wait_begin;   // CSR offsets into _waiters
+    std::vector<index_t> _waiters;
+    std::vector<index_t> _by_id;        // task id to index
+
+    // compute nodes
+    std::vector<const compute*> _node;
+    std::vector<int64_t> _node_cores;
+    std::vector<resource_set> _node_res;
+    std::vector<uint32_t> _node_speed;
+};
+
+#endif // _sim_h_
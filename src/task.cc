@@ -1,10 +1,13 @@
 
 #include "task.h"
+#include "parallel.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
 #include <iostream>
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
+#include <ctype.h>
 
 task::name_lookup task::by_name;
 task::id_lookup task::by_id;
@@ -16,6 +19,15 @@ const char* task::_state_str[] = {
     "no_resource"
 };
 
+const char* task::distribution_str[] = {
+    "fixed",
+    "normal",
+    "lognormal",
+    "uniform"
+};
+
+const uint64_t task::no_deadline;
+
 using namespace boost;
 
 namespace {
@@ -24,11 +36,30 @@ namespace {
     {
         return t->get_state() != task::complete;
     }
+
+    // the view without leading and trailing white space
+    boost::string_view
+    trim_view(boost::string_view s)
+    {
+        while (!s.empty() && isspace(static_cast<unsigned char>(s.front()))) {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && isspace(static_cast<unsigned char>(s.back()))) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
 }
 
 task::task(const char* name, const uint64_t& reqd_cores, const uint64_t& reqd_ticks)
     : _name(name), _reqd_cores(reqd_cores), _reqd_ticks(reqd_ticks),
-    _ticks_remaining(reqd_ticks), _id(next_id()), _state(not_started), _mapped_deps(false), _waiters(0)
+    _nominal_cores(reqd_cores), _nominal_ticks(reqd_ticks), _min_cores(reqd_cores),
+    _max_cores(reqd_cores), _serial_fraction(0), _gang(false), _max_nodes(1),
+    _work_remaining(reqd_ticks * unit_speed), _dist(fixed), _spread(0),
+    _speed(unit_speed), _id(next_id()), _state(not_started), _mapped_deps(false),
+    _output_size(0), _release_tick(0), _deadline(no_deadline),
+    _priority(1), _compute(NULL), _start_tick(0),
+    _finish_tick(0), _waiters(0)
 {
     _register_task(this);
 }
@@ -38,39 +69,120 @@ task::~task()
     _deregister_task(this); 
 }
 
+uint64_t
+task::get_execution_time() const
+{
+    return _reqd_ticks;
+}
+
+void
+task::set_duration_spread(distribution dist, uint64_t spread)
+{
+    _dist = spread ? dist : fixed;
+    _spread = spread;
+}
+
+task::distribution
+task::get_distribution() const
+{
+    return _dist;
+}
+
+uint64_t
+task::get_duration_spread() const
+{
+    return _spread;
+}
+
+bool
+task::parse_distribution(const std::string& name, distribution* dist)
+{
+    for (int ix(fixed); ix <= uniform; ++ix) {
+        if (name.compare(distribution_str[ix]) == 0) {
+            *dist = static_cast<distribution>(ix);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+task::set_speed(uint32_t speed)
+{
+    assert(speed > 0);
+    _speed = speed;
+}
+
+// run_for -- progress is scaled by the speed of the node running the task
 task::tick_stat
 task::run_for(const uint64_t& ticks)
 {
     task::tick_stat t;
+    uint64_t ticks_remaining(get_ticks_remaining());
 
-    if (_ticks_remaining == ticks) {
+    if (ticks_remaining == ticks) {
         // completed
         t.remaining_ticks = 0; 
         t.busy_ticks = ticks;
         t.idle_ticks = 0;
         _state = complete;
-        _ticks_remaining = 0;
-    } else if (_ticks_remaining < ticks) {
+        _work_remaining = 0;
+    } else if (ticks_remaining < ticks) {
         // completed with extra, idle ticks
         t.remaining_ticks = 0; 
         t.busy_ticks = ticks;
-        t.idle_ticks = ticks - _ticks_remaining;
+        t.idle_ticks = ticks - ticks_remaining;
         _state = complete;
-        _ticks_remaining = 0;
-    } else if (_ticks_remaining > ticks) {
+        _work_remaining = 0;
+    } else if (ticks_remaining > ticks) {
         // not complete
-        t.remaining_ticks = _ticks_remaining - ticks;
+        t.remaining_ticks = ticks_remaining - ticks;
         t.busy_ticks = ticks;
         t.idle_ticks = 0;
-        _ticks_remaining -= ticks;
+        _work_remaining -= ticks * _speed;
     }
     return t;
 }
 
+uint64_t
+task::get_work_remaining() const
+{
+    return _work_remaining;
+}
+
+void
+task::set_work_remaining(uint64_t work)
+{
+    _work_remaining = work;
+    if (work == 0) {
+        _state = complete;
+    }
+}
+
 uint64_t
 task::get_ticks_remaining() const
 {
-    return _ticks_remaining;
+    return get_ticks_at(_speed);
+}
+
+uint64_t
+task::get_ticks_at(uint32_t speed) const
+{
+    return (_work_remaining + speed - 1) / speed;
+}
+
+void
+task::reset()
+{
+    _state = not_started;
+    _reqd_cores = _nominal_cores;
+    _reqd_ticks = _nominal_ticks;
+    _work_remaining = _reqd_ticks * unit_speed;
+    _gang_parts.clear();
+    _speed = unit_speed;
+    _compute = NULL;
+    _start_tick = 0;
+    _finish_tick = 0;
 }
 
 bool
@@ -81,6 +193,12 @@ task::dependencies_met() const
     return itr == _deps.end();
 }
 
+std::vector<std::string>
+task::get_parent_names() const
+{
+    return _get_dep_str();
+}
+
 // Parse the dependency string for dependency mapping.
 std::vector<std::string>
 task::_get_dep_str() const
@@ -98,38 +216,384 @@ task::_get_dep_str() const
 // 
 // Dependency mapping - map depencies at the depencency level  
 //
-// 1. get a list of dependency names
+// 1. walk the dependency names in place, without copying them
 // 2. look up that dependency by name
 // 3. inform the other task that we're waiting for it
 // 4. store the pointer in this class
 //
 bool
 task::map_dependencies()
+{
+    uint64_t first(_deps.size());
+    bool found_all(resolve_dependencies());
+    for (uint64_t ix(first); ix < _deps.size(); ++ix) {
+        // tell the other task that we're waiting on it
+        _deps[ix]->_incr_waiters(this);
+    }
+    return found_all;
+}
+
+bool
+task::resolve_dependencies()
 {
     bool found_all = true;
-    std::vector<std::string> deps = _get_dep_str();
-    for (std::vector<std::string>::iterator itr(deps.begin());
-            itr != deps.end();
-            ++itr) {
-        task* t(task::lookup_task(*itr));
+    if (!_dep_str.empty()) {
+        _deps.reserve(_deps.size() + 1 +
+                std::count(_dep_str.begin(), _dep_str.end(), ','));
+    }
+    boost::string_view rest(_dep_str);
+    while (!rest.empty()) {
+        boost::string_view::size_type comma(rest.find(','));
+        task* t(task::lookup_task(trim_view(rest.substr(0, comma))));
         if (t) {
-            // tell the other task that we're waiting on it
-            t->_incr_waiters(this);
             _deps.push_back(t);
         } else {
             found_all = false;
         }
+        if (comma == boost::string_view::npos) {
+            break;
+        }
+        rest.remove_prefix(comma + 1);
+        if (rest.empty()) {
+            found_all = false;  // trailing comma, an empty name
+        }
     }
     _mapped_deps = true;
     return found_all;
 }
 
+void
+task::unresolve_dependencies()
+{
+    _deps.clear();
+    _mapped_deps = false;
+}
+
+//
+// link_waiters -- build the waiter lists of many tasks at once
+//
+// 1. count each dependency's waiters, with atomic increments
+// 2. sum the counts into each dependency's first slot
+// 3. put each waiter's index in a slot of its dependency, again claimed
+//    atomically, so the slots of a dependency fill in any order
+// 4. sort each dependency's slots back into task order and append them
+//    to its waiter list
+//
+// A dependency's slots are only touched by the thread that owns it in
+// step 4, and no waiter list is touched before then.
+//
+void
+task::link_waiters(const list& tasks, uint64_t count, unsigned threads)
+{
+    std::vector<uint64_t> offset(by_id.size() + 1, 0);
+    parallel::parallel_for(count, threads,
+            bind(&task::_count_waiters, &tasks, _1, _2, &offset));
+    for (uint64_t id(0); id < by_id.size(); ++id) {
+        offset[id + 1] += offset[id];
+    }
+
+    std::vector<uint64_t> cursor(offset.begin(), offset.end() - 1);
+    std::vector<uint64_t> slots(offset.back());
+    parallel::parallel_for(count, threads,
+            bind(&task::_place_waiters, &tasks, _1, _2, &cursor, &slots));
+    parallel::parallel_for(by_id.size(), threads,
+            bind(&task::_append_waiters, &tasks, _1, _2, &offset, &slots));
+}
+
+void
+task::_count_waiters(const list* tasks, uint64_t begin, uint64_t end,
+        std::vector<uint64_t>* offset)
+{
+    for (uint64_t ix(begin); ix < end; ++ix) {
+        const ptr_list& deps((*tasks)[ix]->_deps);
+        for (ptr_list::const_iterator dep(deps.begin()); dep != deps.end(); ++dep) {
+            __sync_fetch_and_add(&(*offset)[(*dep)->_id + 1], 1);
+        }
+    }
+}
+
+void
+task::_place_waiters(const list* tasks, uint64_t begin, uint64_t end,
+        std::vector<uint64_t>* cursor, std::vector<uint64_t>* slots)
+{
+    for (uint64_t ix(begin); ix < end; ++ix) {
+        const ptr_list& deps((*tasks)[ix]->_deps);
+        for (ptr_list::const_iterator dep(deps.begin()); dep != deps.end(); ++dep) {
+            (*slots)[__sync_fetch_and_add(&(*cursor)[(*dep)->_id], 1)] = ix;
+        }
+    }
+}
+
+void
+task::_append_waiters(const list* tasks, uint64_t begin, uint64_t end,
+        const std::vector<uint64_t>* offset, std::vector<uint64_t>* slots)
+{
+    for (uint64_t id(begin); id < end; ++id) {
+        std::vector<uint64_t>::iterator first(slots->begin() + (*offset)[id]);
+        std::vector<uint64_t>::iterator last(slots->begin() + (*offset)[id + 1]);
+        if (first == last) {
+            continue;
+        }
+        std::sort(first, last);
+        task* t(by_id[id]);
+        t->_waiter_list.reserve(t->_waiter_list.size() + (last - first));
+        for (; first != last; ++first) {
+            t->_waiter_list.push_back((*tasks)[*first].get());
+        }
+        t->_waiters += (*offset)[id + 1] - (*offset)[id];
+    }
+}
+
+void
+task::set_output_size(uint64_t size)
+{
+    _output_size = size;
+}
+
+uint64_t
+task::get_output_size() const
+{
+    return _output_size;
+}
+
+void
+task::set_release_time(uint64_t tick)
+{
+    _release_tick = tick;
+}
+
+uint64_t
+task::get_release_time() const
+{
+    return _release_tick;
+}
+
+void
+task::set_deadline(uint64_t tick)
+{
+    _deadline = tick;
+}
+
+uint64_t
+task::get_deadline() const
+{
+    return _deadline;
+}
+
+void
+task::set_priority(uint64_t priority)
+{
+    _priority = priority;
+}
+
+uint64_t
+task::get_priority() const
+{
+    return _priority;
+}
+
+uint64_t
+task::get_tardiness() const
+{
+    if (_state != complete || _finish_tick <= _deadline) {
+        return 0;
+    }
+    return _finish_tick - _deadline;
+}
+
+void
+task::set_placement(compute* c, uint64_t start)
+{
+    _compute = c;
+    _start_tick = start;
+}
+
+void
+task::set_finish_tick(uint64_t finish)
+{
+    _finish_tick = finish;
+}
+
+compute*
+task::get_compute() const
+{
+    return _compute;
+}
+
+uint64_t
+task::get_start_tick() const
+{
+    return _start_tick;
+}
+
+uint64_t
+task::get_finish_tick() const
+{
+    return _finish_tick;
+}
+
+uint64_t
+task::data_ready_on(const compute* c, const network& net) const
+{
+    uint64_t ready(0);
+    for (ptr_list::const_iterator itr(_deps.begin());
+            itr != _deps.end();
+            ++itr) {
+        assert((*itr)->_state == complete);
+        uint64_t dep_ready((*itr)->_finish_tick);
+        if ((*itr)->_compute != c) {
+            dep_ready += net.transfer_ticks((*itr)->_output_size);
+        }
+        ready = std::max(ready, dep_ready);
+    }
+    return ready;
+}
+
+uint64_t
+task::get_input_size(const compute* c) const
+{
+    uint64_t size(0);
+    for (ptr_list::const_iterator itr(_deps.begin());
+            itr != _deps.end();
+            ++itr) {
+        if (c == NULL || (*itr)->_compute == c) {
+            size += (*itr)->_output_size;
+        }
+    }
+    return size;
+}
+
 uint64_t
 task::get_cores_required() const
 {
     return _reqd_cores;
 }
 
+void
+task::set_core_range(uint64_t min, uint64_t max)
+{
+    assert(min > 0 && min <= _nominal_cores && _nominal_cores <= max);
+    _min_cores = min;
+    _max_cores = max;
+}
+
+uint64_t
+task::get_min_cores() const
+{
+    return _min_cores;
+}
+
+uint64_t
+task::get_max_cores() const
+{
+    return _max_cores;
+}
+
+bool
+task::is_moldable() const
+{
+    return _min_cores != _max_cores;
+}
+
+void
+task::set_serial_fraction(double fraction)
+{
+    assert(fraction >= 0 && fraction <= 1);
+    _serial_fraction = fraction;
+}
+
+void
+task::set_speedup_table(const speedup_table& table)
+{
+    _speedup = table;
+}
+
+// get_speedup -- Amdahl's law, or the speedup table interpolated
+double
+task::get_speedup(uint64_t cores) const
+{
+    assert(cores > 0);
+    if (_speedup.empty()) {
+        return 1.0 / (_serial_fraction + (1.0 - _serial_fraction) / cores);
+    }
+    speedup_table::const_iterator hi(_speedup.lower_bound(cores));
+    if (hi != _speedup.end() && hi->first == cores) {
+        return hi->second;
+    }
+    if (hi == _speedup.begin()) {
+        return hi->second * cores / hi->first;
+    }
+    speedup_table::const_iterator lo(hi);
+    --lo;
+    if (hi == _speedup.end()) {
+        return lo->second;
+    }
+    return lo->second + (hi->second - lo->second) *
+        (cores - lo->first) / (hi->first - lo->first);
+}
+
+uint64_t
+task::get_execution_time_on(uint64_t cores) const
+{
+    if (cores == _nominal_cores) {
+        return _nominal_ticks;
+    }
+    double ticks(_nominal_ticks * get_speedup(_nominal_cores) / get_speedup(cores));
+    return static_cast<uint64_t>(std::ceil(ticks - 1e-9));
+}
+
+void
+task::set_gang(uint64_t max_nodes)
+{
+    _gang = true;
+    _max_nodes = max_nodes;
+}
+
+bool
+task::is_gang() const
+{
+    return _gang;
+}
+
+uint64_t
+task::get_max_nodes() const
+{
+    return _max_nodes;
+}
+
+void
+task::set_gang_parts(const gang_list& parts)
+{
+    _gang_parts = parts;
+}
+
+const task::gang_list&
+task::get_gang_parts() const
+{
+    return _gang_parts;
+}
+
+void
+task::set_cores(uint64_t cores)
+{
+    assert(_state == not_started && cores >= _min_cores && cores <= _max_cores);
+    _reqd_cores = cores;
+    _reqd_ticks = get_execution_time_on(cores);
+    _work_remaining = _reqd_ticks * unit_speed;
+}
+
+void
+task::set_resources(const resource_set& res)
+{
+    _reqd_res = res;
+}
+
+const resource_set&
+task::get_resources() const
+{
+    return _reqd_res;
+}
+
 uint64_t
 task::get_waiter_count() const
 {
@@ -149,6 +613,12 @@ task::get_waiter_list() const
     return _waiter_list;
 }
 
+task::ptr_range
+task::waiters() const
+{
+    return ptr_range(_waiter_list.begin(), _waiter_list.end());
+}
+
 uint64_t
 task::get_dependency_count() const
 {
@@ -164,6 +634,34 @@ task::get_dependencies() const
     return _deps;
 }
 
+task::ptr_range
+task::dependencies() const
+{
+    return ptr_range(_deps.begin(), _deps.end());
+}
+
+uint64_t
+task::drop_dependencies(const std::vector<char>& drop)
+{
+    assert(drop.size() == _deps.size());
+    ptr_list kept;
+    kept.reserve(_deps.size());
+    for (uint64_t ix(0); ix < _deps.size(); ++ix) {
+        if (!drop[ix]) {
+            kept.push_back(_deps[ix]);
+            continue;
+        }
+        ptr_list& waiters(_deps[ix]->_waiter_list);
+        ptr_list::iterator itr(std::find(waiters.begin(), waiters.end(), this));
+        if (itr != waiters.end()) {
+            waiters.erase(itr);
+        }
+    }
+    uint64_t dropped(_deps.size() - kept.size());
+    _deps.swap(kept);
+    return dropped;
+}
+
 uint64_t
 task::get_id() const
 {
@@ -189,6 +687,12 @@ task::get_name() const
     return _name;
 }
 
+boost::string_view
+task::name() const
+{
+    return _name;
+}
+
 void
 task::set_dep_str(const char* deps)
 {
@@ -208,7 +712,7 @@ task::lookup_task(id_t id)
 }
 
 task*
-task::lookup_task(const std::string& name)
+task::lookup_task(boost::string_view name)
 {
     name_lookup::iterator itr = by_name.find(name);
     if (itr == by_name.end()) {
@@ -226,7 +730,7 @@ task::_register_task(task* t)
     }
     by_id[t->get_id()] = t;
     std::pair<name_lookup::iterator, bool> rc
-        (by_name.insert(std::make_pair(t->get_name(), t)));
+        (by_name.insert(std::make_pair(t->name(), t)));
     assert(rc.second);
 }
 
@@ -234,8 +738,9 @@ void
 task::_deregister_task(task* t)
 {
     by_id[t->get_id()] = NULL;
-    size_t erased(by_name.erase(t->get_name()));
+    size_t erased(by_name.erase(t->name()));
     assert(erased == 1);
+    release_id(t->get_id());
 }
 
 // friend ostream operator
@@ -244,10 +749,34 @@ std::ostream&
 operator<<(std::ostream& os, const task& tsk)
 {
     os << "name: " << tsk._name << "; cores_required: " << tsk._reqd_cores <<
-        "; exec_time: " << tsk._ticks_remaining << "/" << tsk._reqd_ticks <<
+        "; exec_time: " << tsk.get_ticks_remaining() << "/" << tsk._reqd_ticks <<
         "; _id: " << tsk._id << "; state: " << task::_state_str[tsk._state] <<
         "(" << tsk._state << "); dependency count: " << tsk._deps.size() <<
         "; waiters: " << tsk._waiters;
+    if (tsk._dist != task::fixed) {
+        os << "; " << task::distribution_str[tsk._dist] << " spread: " << tsk._spread;
+    }
+    if (!tsk._reqd_res.empty()) {
+        os << "; resources: " << tsk._reqd_res;
+    }
+    if (tsk._output_size) {
+        os << "; output size: " << tsk._output_size;
+    }
+    if (tsk._release_tick) {
+        os << "; release time: " << tsk._release_tick;
+    }
+    if (tsk.is_moldable()) {
+        os << "; cores: " << tsk._min_cores << "-" << tsk._max_cores;
+    }
+    if (tsk._gang) {
+        os << "; gang";
+        if (tsk._max_nodes) {
+            os << " of up to " << tsk._max_nodes << " nodes";
+        }
+    }
+    if (tsk._deadline != task::no_deadline) {
+        os << "; deadline: " << tsk._deadline << "; priority: " << tsk._priority;
+    }
     if (!tsk._dep_str.empty()) {
         os << "; parent tasks: " << tsk._dep_str;
     }
@@ -2,7 +2,10 @@
 #ifndef _task_h_
 #define _task_h_
 
+#include <boost/range/iterator_range.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/utility/string_view.hpp>
 #include <ostream>
 #include <stdint.h>
 #include <queue>
@@ -11,6 +14,10 @@
 #include <list>
 #include <map>
 #include "identity.h"
+#include "network.h"
+#include "resource.h"
+
+class compute;
 
 /*
  * @class task
@@ -30,12 +37,38 @@ public:
         no_resources
     };
 
+    /*
+     * execution time distributions, for simulating uncertain task runtimes
+     */
+    enum _distribution {
+        fixed,
+        normal,
+        lognormal,
+        uniform
+    };
+
     typedef boost::shared_ptr<task> ptr;
     typedef std::vector<ptr> list;
     typedef std::vector<task*> ptr_list;
+    typedef boost::iterator_range<ptr_list::const_iterator> ptr_range;
     typedef std::list<task*> ptr_llist;
     typedef enum task::_state  state;
+    typedef enum task::_distribution  distribution;
     typedef uint64_t id_t;
+    typedef std::map<uint64_t, double> speedup_table;  // cores to speedup
+    typedef std::pair<compute*, uint64_t> gang_part;    // node and its cores
+    typedef std::vector<gang_part> gang_list;
+
+    /*
+     * Speed factors are fixed point, in thousandths of the speed of the
+     * node that execution_time was measured on.
+     */
+    static const uint32_t unit_speed = 1000;
+
+    /*
+     * Deadline of a task that has none.
+     */
+    static const uint64_t no_deadline = UINT64_MAX;
 
     /*
      * @struct _tick_stat
@@ -58,7 +91,8 @@ public:
      *
      * Tasks are registered in two static structures associated with this class
      * that are used to look up tasks quickly based either on the id number or
-     * the task name.
+     * the task name.  Names must be unique among live tasks; the id and name
+     * of a destroyed task are free to be used again.
      *
      * @param[in]  name        task name
      * @param[in]  reqd_cores  cores required for this task
@@ -81,13 +115,214 @@ public:
      */
     std::string get_name() const;
 
+    /*
+     * name
+     *
+     * @return view of the name, valid as long as the task
+     */
+    boost::string_view name() const;
+
     /*
      * get_cores_required
      *
-     * @return cores required for this task
+     * @return cores required for this task, as placed if it is moldable
      */
     uint64_t get_cores_required() const;
 
+    /*
+     * set_core_range
+     *
+     * Makes this task moldable: it may run on any number of cores from
+     * min to max, which must include the cores it was created with.  Its
+     * execution time on other core counts is scaled by the speedup model.
+     *
+     * @param[in]  min  fewest cores the task runs on
+     * @param[in]  max  most cores the task can use
+     */
+    void set_core_range(uint64_t min, uint64_t max);
+
+    /*
+     * get_min_cores, get_max_cores
+     *
+     * @return fewest and most cores this task can run on
+     */
+    uint64_t get_min_cores() const;
+    uint64_t get_max_cores() const;
+
+    /*
+     * is_moldable
+     *
+     * @return true if the task can run on more than one core count
+     */
+    bool is_moldable() const;
+
+    /*
+     * set_serial_fraction
+     *
+     * Scales execution time by Amdahl's law: on n cores the task speeds
+     * up by 1 / (fraction + (1 - fraction) / n).  The default, 0, is a
+     * linear speedup.
+     *
+     * @param[in]  fraction  part of the work that doesn't run in parallel
+     */
+    void set_serial_fraction(double fraction);
+
+    /*
+     * set_speedup_table
+     *
+     * Scales execution time by measured speedups instead of Amdahl's law.
+     * Speedups between listed core counts are interpolated, below the
+     * smallest they are proportional and above the largest they are flat.
+     *
+     * @param[in]  table  speedup by core count
+     */
+    void set_speedup_table(const speedup_table& table);
+
+    /*
+     * get_speedup
+     *
+     * @param[in]  cores  core count
+     *
+     * @return speedup over one core on the given number of cores
+     */
+    double get_speedup(uint64_t cores) const;
+
+    /*
+     * get_execution_time_on
+     *
+     * @param[in]  cores  core count in the task's range
+     *
+     * @return ticks the task takes on the given number of cores
+     */
+    uint64_t get_execution_time_on(uint64_t cores) const;
+
+    /*
+     * set_gang
+     *
+     * Lets this task run as a gang spread over several compute nodes,
+     * e.g. an MPI job.  Its cores_required are split between the nodes,
+     * all parts start together and run as long as the part on the slowest
+     * node.
+     *
+     * @param[in]  max_nodes  most nodes the task may span, 0 for any
+     */
+    void set_gang(uint64_t max_nodes);
+
+    /*
+     * is_gang
+     *
+     * @return true if the task may span several compute nodes
+     */
+    bool is_gang() const;
+
+    /*
+     * get_max_nodes
+     *
+     * @return most nodes a gang task may span, 0 for any
+     */
+    uint64_t get_max_nodes() const;
+
+    /*
+     * set_gang_parts
+     *
+     * Records the nodes and cores a gang task was placed on.
+     *
+     * @param[in]  parts  node and cores of each part
+     */
+    void set_gang_parts(const gang_list& parts);
+
+    /*
+     * get_gang_parts
+     *
+     * @return nodes and cores of a placed gang task, empty otherwise
+     */
+    const gang_list& get_gang_parts() const;
+
+    /*
+     * set_cores
+     *
+     * Chooses the core count a moldable task that hasn't started runs on,
+     * and its execution time with it.  reset() restores the core count the
+     * task was created with.
+     *
+     * @param[in]  cores  core count in the task's range
+     */
+    void set_cores(uint64_t cores);
+
+    /*
+     * set_resources
+     *
+     * Sets the non-core resources (memory, scratch disk, ...) that this
+     * task holds while it runs.
+     *
+     * @param[in]  res  resources required
+     */
+    void set_resources(const resource_set& res);
+
+    /*
+     * get_resources
+     *
+     * @return non-core resources required for this task
+     */
+    const resource_set& get_resources() const;
+
+    /*
+     * get_execution_time
+     *
+     * @return nominal (mean) ticks required to complete this task, on
+     *         the cores it was placed with if it is moldable
+     */
+    uint64_t get_execution_time() const;
+
+    /*
+     * set_duration_spread
+     *
+     * Describes how this task's actual execution time varies around
+     * execution_time.  The planner schedules with execution_time; the
+     * spread is used by Monte Carlo simulation of the plan.
+     *
+     * @param[in]  dist    distribution of the execution time
+     * @param[in]  spread  standard deviation (normal, lognormal) or half
+     *                     width (uniform) in ticks
+     */
+    void set_duration_spread(distribution dist, uint64_t spread);
+
+    /*
+     * get_distribution
+     *
+     * @return distribution of this task's execution time
+     */
+    distribution get_distribution() const;
+
+    /*
+     * get_duration_spread
+     *
+     * @return spread of this task's execution time in ticks
+     */
+    uint64_t get_duration_spread() const;
+
+    /*
+     * parse_distribution
+     *
+     * @param[in]  name  name of a distribution (see distribution_str)
+     * @param[out] dist  distribution matching the name
+     *
+     * @return true if the name is a known distribution
+     */
+    static bool parse_distribution(const std::string& name, distribution* dist);
+    static const char* distribution_str[];
+
+    /*
+     * set_speed
+     *
+     * Sets the speed factor of the compute node running this task.  Each
+     * tick of run_for() completes speed / unit_speed ticks of the task's
+     * execution_time.
+     *
+     * @param[in]  speed  node speed factor, unit_speed is nominal
+     */
+    void set_speed(uint32_t speed);
+
     /*
      * run_for
      *
@@ -97,6 +332,24 @@ public:
      */
     tick_stat run_for(const uint64_t& ticks);
 
+    /*
+     * get_work_remaining
+     *
+     * @return work left, in ticks at unit_speed times unit_speed
+     */
+    uint64_t get_work_remaining() const;
+
+    /*
+     * set_work_remaining
+     *
+     * Records progress made outside run_for(), e.g. by a compute node
+     * advancing all of its running tasks at once.  A task with no work
+     * left is complete.
+     *
+     * @param[in]  work  work left, as returned by get_work_remaining()
+     */
+    void set_work_remaining(uint64_t work);
+
     /*
      * get_state
      *
@@ -122,6 +375,13 @@ public:
      */
     void set_dep_str(const char* deps);
 
+    /*
+     * get_parent_names
+     *
+     * @return names of this task's parent tasks, as given in the task file
+     */
+    std::vector<std::string> get_parent_names() const;
+
     /*
      * map_dependencies
      *
@@ -133,6 +393,42 @@ public:
      */
     bool map_dependencies();
 
+    /*
+     * resolve_dependencies
+     *
+     * Looks up this task's dependencies by name like map_dependencies(),
+     * without adding this task to their waiter lists.  Other tasks are
+     * only read, so tasks can resolve their dependencies concurrently and
+     * be linked to them afterward with link_waiters().
+     *
+     * @return boolean indicating whether all dependencies were found
+     */
+    bool resolve_dependencies();
+
+    /*
+     * unresolve_dependencies
+     *
+     * Forgets the dependencies found by resolve_dependencies(), e.g. of
+     * tasks after one that failed validation.  They must not have been
+     * linked yet.
+     */
+    void unresolve_dependencies();
+
+    /*
+     * link_waiters
+     *
+     * Adds each of the first count tasks to the waiter lists of the
+     * dependencies it resolved.  Waiters are counted per dependency, the
+     * counts summed into one array of slots, and the slots filled and put
+     * back in task order, so the lists are the same as mapping the tasks
+     * one by one with map_dependencies().
+     *
+     * @param[in]  tasks    tasks with resolved dependencies
+     * @param[in]  count    number of tasks to link, from the front
+     * @param[in]  threads  number of threads to link them on
+     */
+    static void link_waiters(const list& tasks, uint64_t count, unsigned threads);
+
     /* 
      * dependencies_met()
      *
@@ -152,24 +448,52 @@ public:
     /*
      * get_dependencies
      *
-     * @return list of pointers to this tasks's dependencies
+     * @return copy of the list of pointers to this tasks's dependencies
      */
     ptr_list get_dependencies() const;
 
+    /*
+     * dependencies
+     *
+     * @return view of this task's dependencies, valid until they change
+     */
+    ptr_range dependencies() const;
+
+    /*
+     * drop_dependencies
+     *
+     * Removes dependencies, e.g. ones implied by other dependencies.  The
+     * parent tasks no longer list this task as a waiter, but still count
+     * it in get_waiter_count().
+     *
+     * @param[in]  drop  for each dependency in get_dependencies() order,
+     *                   non-zero to remove it
+     *
+     * @return number of dependencies removed
+     */
+    uint64_t drop_dependencies(const std::vector<char>& drop);
+
     /*
      * get_waiter_count
      *
-     * @returns count of tasks waiting on this task
+     * @returns count of tasks that listed this task as a parent task
      */
     uint64_t get_waiter_count() const;
 
     /*
      * get_waiter_list
      *
-     * @return list of pointers to this tasks waiters
+     * @return copy of the list of pointers to this tasks waiters
      */
     ptr_list get_waiter_list() const;
 
+    /*
+     * waiters
+     *
+     * @return view of this task's waiters, valid until they change
+     */
+    ptr_range waiters() const;
+
 
     /*
      * get_ticks_remaining
@@ -178,6 +502,162 @@ public:
      */
     uint64_t get_ticks_remaining() const; 
 
+    /*
+     * get_ticks_at
+     *
+     * @param[in]  speed  node speed factor, unit_speed is nominal
+     *
+     * @return ticks required for this task to complete at the given speed
+     */
+    uint64_t get_ticks_at(uint32_t speed) const;
+
+    /*
+     * reset
+     *
+     * Returns this task to the not started state with its full execution
+     * time remaining so that it can be scheduled again.  Dependency
+     * mapping is kept.
+     */
+    void reset();
+
+
+    /*
+     * set_output_size
+     *
+     * Sets the size of the output this task leaves on its compute node
+     * for the tasks waiting on it.
+     *
+     * @param[in]  size  output size, in the network's bandwidth units
+     */
+    void set_output_size(uint64_t size);
+
+    /*
+     * get_output_size
+     *
+     * @return size of this task's output
+     */
+    uint64_t get_output_size() const;
+
+    /*
+     * set_release_time
+     *
+     * Sets the planner tick before which this task can't start, e.g.
+     * because it hasn't been submitted yet.  The default is 0.
+     *
+     * @param[in]  tick  release tick
+     */
+    void set_release_time(uint64_t tick);
+
+    /*
+     * get_release_time
+     *
+     * @return planner tick this task is released on
+     */
+    uint64_t get_release_time() const;
+
+    /*
+     * set_deadline
+     *
+     * Sets the planner tick this task should finish by.  The default is
+     * no_deadline.
+     *
+     * @param[in]  tick  deadline tick
+     */
+    void set_deadline(uint64_t tick);
+
+    /*
+     * get_deadline
+     *
+     * @return planner tick this task should finish by, or no_deadline
+     */
+    uint64_t get_deadline() const;
+
+    /*
+     * set_priority
+     *
+     * Sets the weight of this task's tardiness: each tick it finishes
+     * after its deadline costs priority.  The default is 1.
+     *
+     * @param[in]  priority  tardiness weight
+     */
+    void set_priority(uint64_t priority);
+
+    /*
+     * get_priority
+     *
+     * @return tardiness weight of this task
+     */
+    uint64_t get_priority() const;
+
+    /*
+     * get_tardiness
+     *
+     * @return ticks this task finished after its deadline, 0 if it
+     *         finished in time, has no deadline or hasn't finished
+     */
+    uint64_t get_tardiness() const;
+
+    /*
+     * set_placement
+     *
+     * Records where and when the planner started this task.
+     *
+     * @param[in]  c      compute node running this task
+     * @param[in]  start  planner tick the task started on
+     */
+    void set_placement(compute* c, uint64_t start);
+
+    /*
+     * set_finish_tick
+     *
+     * Records the planner tick this task completed on.
+     */
+    void set_finish_tick(uint64_t finish);
+
+    /*
+     * get_compute
+     *
+     * @return compute node this task was placed on, NULL if not started
+     */
+    compute* get_compute() const;
+
+    /*
+     * get_start_tick
+     *
+     * @return planner tick this task started on
+     */
+    uint64_t get_start_tick() const;
+
+    /*
+     * get_finish_tick
+     *
+     * @return planner tick this task completed on
+     */
+    uint64_t get_finish_tick() const;
+
+    /*
+     * data_ready_on
+     *
+     * Finds when all of this task's inputs could be on a compute node:
+     * each dependency's output is ready when the dependency finishes, plus
+     * the transfer time if it ran on another node.  All dependencies must
+     * be complete.
+     *
+     * @param[in]  c    compute node to run this task on
+     * @param[in]  net  network model for transfers
+     *
+     * @return planner tick at which the inputs are available on c
+     */
+    uint64_t data_ready_on(const compute* c, const network& net) const;
+
+    /*
+     * get_input_size
+     *
+     * @param[in]  c  compute node, or NULL for all dependencies
+     *
+     * @return total output size of the dependencies that ran on c
+     */
+    uint64_t get_input_size(const compute* c = NULL) const;
 
     /*
      * lookup_task
@@ -193,20 +673,40 @@ public:
      *
      * @return pointer to specified task or NULL if not found
      */
-    static task* lookup_task(const std::string& name);
+    static task* lookup_task(boost::string_view name);
 
     friend std::ostream& operator<<(std::ostream& os, const task& tsk);
 
 private:
     std::string _name;
     uint64_t _reqd_cores;
+    resource_set _reqd_res;
     uint64_t _reqd_ticks;
-    uint64_t _ticks_remaining;
+    uint64_t _nominal_cores;   // cores and ticks the task was created with
+    uint64_t _nominal_ticks;
+    uint64_t _min_cores;
+    uint64_t _max_cores;
+    double _serial_fraction;
+    speedup_table _speedup;
+    bool _gang;
+    uint64_t _max_nodes;
+    gang_list _gang_parts;
+    uint64_t _work_remaining;  // execution_time * unit_speed
+    distribution _dist;
+    uint64_t _spread;
+    uint32_t _speed;
     id_t _id;
     std::string _dep_str;
     ptr_list _deps;
     state _state;
     bool _mapped_deps;
+    uint64_t _output_size;
+    uint64_t _release_tick;
+    uint64_t _deadline;
+    uint64_t _priority;
+    compute* _compute;
+    uint64_t _start_tick;
+    uint64_t _finish_tick;
 
     uint64_t _waiters;         // tasks waiting on this
     ptr_list _waiter_list;     // list of the above
@@ -214,12 +714,19 @@ private:
     void _add_task_id_mapping(id_t);
     uint64_t _incr_waiters(task*);
 
+    static void _count_waiters(const list* tasks, uint64_t begin, uint64_t end,
+            std::vector<uint64_t>* offset);
+    static void _place_waiters(const list* tasks, uint64_t begin, uint64_t end,
+            std::vector<uint64_t>* cursor, std::vector<uint64_t>* slots);
+    static void _append_waiters(const list* tasks, uint64_t begin, uint64_t end,
+            const std::vector<uint64_t>* offset, std::vector<uint64_t>* slots);
+
     std::vector<std::string> _get_dep_str() const;
 
     void _register_task(task*);
     void _deregister_task(task*);
 
-    typedef std::map<std::string, task*> name_lookup;
+    typedef boost::unordered_map<boost::string_view, task*> name_lookup;   // views of _name
     typedef std::vector<task*> id_lookup;
 
     static name_lookup by_name;
@@ -0,0 +1,166 @@
+
+//
+// tick_bench -- time the bulk tick kernels against the per-task tick path
+//
+// A dense node runs one single core task per core.  The node ticks to the
+// next completion until every task is done, so each pass advances all of
+// the tasks still running.  The per-task path is the std::list walk over
+// task::run_for() that compute::tick() used before tick_kernel; every run
+// must produce the same completions and core ticks.
+//
+
+#include "compute.h"
+#include "task.h"
+#include "tick_kernel.h"
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <time.h>
+
+namespace {
+    struct run_totals {
+        uint64_t ticks;
+        uint64_t busy;
+        uint64_t idle;
+        uint64_t checksum;      // completions weighted by completion tick
+        double seconds;
+    };
+
+    double
+    now_seconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    task::list
+    make_tasks(uint64_t count, const std::string& prefix)
+    {
+        boost::random::mt19937 gen(1);
+        boost::random::uniform_int_distribution<uint64_t> ticks(1, 10000);
+        task::list tasks;
+        for (uint64_t ix(0); ix < count; ++ix) {
+            std::ostringstream name;
+            name << prefix << ix;
+            tasks.push_back(task::ptr(new task(name.str().c_str(), 1, ticks(gen))));
+        }
+        return tasks;
+    }
+
+    // the per-task path
+    run_totals
+    run_list(uint64_t cores)
+    {
+        task::list tasks(make_tasks(cores, "list_"));
+        std::list<task*> running;
+        for (task::list::iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            (*itr)->set_state(task::running);
+            running.push_back(itr->get());
+        }
+
+        run_totals tot = { 0, 0, 0, 0, 0.0 };
+        double start(now_seconds());
+        while (!running.empty()) {
+            uint64_t skip(0);
+            for (std::list<task*>::iterator itr(running.begin()); itr != running.end(); ++itr) {
+                uint64_t rem((*itr)->get_ticks_remaining());
+                skip = skip == 0 ? rem : std::min(skip, rem);
+            }
+            int64_t cores_used(0);
+            uint64_t completed(0);
+            for (std::list<task*>::iterator itr(running.begin()); itr != running.end(); ) {
+                task::tick_stat ts((*itr)->run_for(skip));
+                cores_used += (*itr)->get_cores_required();
+                if (ts.remaining_ticks == 0) {
+                    itr = running.erase(itr);
+                    ++completed;
+                    continue;
+                }
+                ++itr;
+            }
+            tot.ticks += skip;
+            tot.busy += cores_used * skip;
+            tot.idle += (cores - cores_used) * skip;
+            tot.checksum += completed * tot.ticks;
+        }
+        tot.seconds = now_seconds() - start;
+        return tot;
+    }
+
+    // the bulk path, through compute::tick()
+    run_totals
+    run_kernel(uint64_t cores, tick_kernel::kind k)
+    {
+        std::string prefix(std::string(tick_kernel::kind_str[k]) + "_");
+        task::list tasks(make_tasks(cores, prefix));
+        compute node(prefix + "node", cores);
+        for (task::list::iterator itr(tasks.begin()); itr != tasks.end(); ++itr) {
+            node.assign_task(itr->get());
+        }
+
+        run_totals tot = { 0, 0, 0, 0, 0.0 };
+        double start(now_seconds());
+        for (;;) {
+            uint64_t skip(node.get_ticks_to_completion());
+            if (skip == compute::never_fits) {
+                break;
+            }
+            uint64_t completed(node.tick(skip));
+            tot.ticks += skip;
+            tot.checksum += completed * tot.ticks;
+        }
+        tot.seconds = now_seconds() - start;
+        tot.busy = node.get_busy_ticks();
+        tot.idle = node.get_idle_ticks();
+        return tot;
+    }
+
+    bool
+    same(const run_totals& lhs, const run_totals& rhs)
+    {
+        return lhs.ticks == rhs.ticks && lhs.busy == rhs.busy &&
+            lhs.idle == rhs.idle && lhs.checksum == rhs.checksum;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint64_t sizes[] = { 256, 1024, 4096, 8192 };
+    const tick_kernel::kind kernels[] = {
+        tick_kernel::scalar, tick_kernel::sse42, tick_kernel::avx2 };
+    int rc(0);
+
+    std::cout << std::left << std::setw(8) << "cores" << std::setw(10) << "kernel"
+        << std::right << std::setw(12) << "seconds" << std::setw(10) << "speedup" << "\n";
+    for (unsigned sx(0); sx < sizeof(sizes) / sizeof(sizes[0]); ++sx) {
+        run_totals ref(run_list(sizes[sx]));
+        std::cout << std::left << std::setw(8) << sizes[sx] << std::setw(10) << "list"
+            << std::right << std::fixed << std::setprecision(4)
+            << std::setw(12) << ref.seconds << std::setw(10) << "1.00" << "\n";
+        for (unsigned kx(0); kx < sizeof(kernels) / sizeof(kernels[0]); ++kx) {
+            tick_kernel::kind k(tick_kernel::select(kernels[kx]));
+            if (k != kernels[kx]) {
+                std::cout << std::left << std::setw(8) << sizes[sx]
+                    << std::setw(10) << tick_kernel::kind_str[kernels[kx]]
+                    << "not supported\n";
+                continue;
+            }
+            run_totals tot(run_kernel(sizes[sx], k));
+            std::cout << std::left << std::setw(8) << sizes[sx]
+                << std::setw(10) << tick_kernel::kind_str[k] << std::right
+                << std::setw(12) << tot.seconds << std::setw(10)
+                << std::setprecision(2) << ref.seconds / tot.seconds
+                << std::setprecision(4);
+            if (!same(ref, tot)) {
+                std::cout << "  MISMATCH";
+                rc = 1;
+            }
+            std::cout << "\n";
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,223 @@
+
+#include "tick_kernel.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TICK_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+const char* tick_kernel::kind_str[] = {
+    "auto",
+    "scalar",
+    "sse4.2",
+    "avx2"
+};
+
+namespace {
+    typedef tick_kernel::advance_result (*advance_fn)(int64_t*, const int64_t*,
+            uint64_t, int64_t);
+    typedef int64_t (*min_work_fn)(const int64_t*, uint64_t);
+
+    //
+    // scalar kernels, also used for the tails of the vector kernels
+    //
+    tick_kernel::advance_result
+    advance_scalar(int64_t* work, const int64_t* cores, uint64_t count, int64_t step)
+    {
+        tick_kernel::advance_result res = { 0, 0, 0 };
+        for (uint64_t ix(0); ix < count; ++ix) {
+            res.cores_used += cores[ix];
+            if (work[ix] <= step) {
+                work[ix] = 0;
+                ++res.completed;
+                res.cores_released += cores[ix];
+            } else {
+                work[ix] -= step;
+            }
+        }
+        return res;
+    }
+
+    int64_t
+    min_work_scalar(const int64_t* work, uint64_t count)
+    {
+        int64_t least(INT64_MAX);
+        for (uint64_t ix(0); ix < count; ++ix) {
+            if (work[ix] < least) {
+                least = work[ix];
+            }
+        }
+        return least;
+    }
+
+#ifdef TICK_KERNEL_X86
+    //
+    // SSE4.2 kernels, two entries per instruction
+    //
+    __attribute__((target("sse4.2"))) tick_kernel::advance_result
+    advance_sse42(int64_t* work, const int64_t* cores, uint64_t count, int64_t step)
+    {
+        const __m128i vstep(_mm_set1_epi64x(step));
+        const __m128i one(_mm_set1_epi64x(1));
+        __m128i used(_mm_setzero_si128());
+        __m128i released(_mm_setzero_si128());
+        __m128i completed(_mm_setzero_si128());
+        uint64_t ix(0);
+        for (; ix + 2 <= count; ix += 2) {
+            __m128i w(_mm_loadu_si128(reinterpret_cast<const __m128i*>(work + ix)));
+            __m128i c(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cores + ix)));
+            __m128i more(_mm_cmpgt_epi64(w, vstep));    // all ones if not done
+            w = _mm_and_si128(more, _mm_sub_epi64(w, vstep));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(work + ix), w);
+            used = _mm_add_epi64(used, c);
+            released = _mm_add_epi64(released, _mm_andnot_si128(more, c));
+            completed = _mm_add_epi64(completed, _mm_andnot_si128(more, one));
+        }
+        int64_t lanes[2];
+        tick_kernel::advance_result res(advance_scalar(work + ix, cores + ix,
+                    count - ix, step));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), used);
+        res.cores_used += lanes[0] + lanes[1];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), released);
+        res.cores_released += lanes[0] + lanes[1];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), completed);
+        res.completed += lanes[0] + lanes[1];
+        return res;
+    }
+
+    __attribute__((target("sse4.2"))) int64_t
+    min_work_sse42(const int64_t* work, uint64_t count)
+    {
+        __m128i least(_mm_set1_epi64x(INT64_MAX));
+        uint64_t ix(0);
+        for (; ix + 2 <= count; ix += 2) {
+            __m128i w(_mm_loadu_si128(reinterpret_cast<const __m128i*>(work + ix)));
+            least = _mm_blendv_epi8(least, w, _mm_cmpgt_epi64(least, w));
+        }
+        int64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), least);
+        int64_t tail(min_work_scalar(work + ix, count - ix));
+        return std::min(std::min(lanes[0], lanes[1]), tail);
+    }
+
+    //
+    // AVX2 kernels, four entries per instruction
+    //
+    __attribute__((target("avx2"))) tick_kernel::advance_result
+    advance_avx2(int64_t* work, const int64_t* cores, uint64_t count, int64_t step)
+    {
+        const __m256i vstep(_mm256_set1_epi64x(step));
+        const __m256i one(_mm256_set1_epi64x(1));
+        __m256i used(_mm256_setzero_si256());
+        __m256i released(_mm256_setzero_si256());
+        __m256i completed(_mm256_setzero_si256());
+        uint64_t ix(0);
+        for (; ix + 4 <= count; ix += 4) {
+            __m256i w(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + ix)));
+            __m256i c(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(cores + ix)));
+            __m256i more(_mm256_cmpgt_epi64(w, vstep)); // all ones if not done
+            w = _mm256_and_si256(more, _mm256_sub_epi64(w, vstep));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(work + ix), w);
+            used = _mm256_add_epi64(used, c);
+            released = _mm256_add_epi64(released, _mm256_andnot_si256(more, c));
+            completed = _mm256_add_epi64(completed, _mm256_andnot_si256(more, one));
+        }
+        int64_t lanes[4];
+        tick_kernel::advance_result res(advance_scalar(work + ix, cores + ix,
+                    count - ix, step));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), used);
+        res.cores_used += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), released);
+        res.cores_released += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), completed);
+        res.completed += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        return res;
+    }
+
+    __attribute__((target("avx2"))) int64_t
+    min_work_avx2(const int64_t* work, uint64_t count)
+    {
+        __m256i least(_mm256_set1_epi64x(INT64_MAX));
+        uint64_t ix(0);
+        for (; ix + 4 <= count; ix += 4) {
+            __m256i w(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + ix)));
+            least = _mm256_blendv_epi8(least, w, _mm256_cmpgt_epi64(least, w));
+        }
+        int64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), least);
+        int64_t tail(min_work_scalar(work + ix, count - ix));
+        return std::min(std::min(std::min(lanes[0], lanes[1]),
+                    std::min(lanes[2], lanes[3])), tail);
+    }
+#endif
+
+    // the first call picks the fastest kernel
+    tick_kernel::advance_result advance_first(int64_t*, const int64_t*, uint64_t, int64_t);
+    int64_t min_work_first(const int64_t*, uint64_t);
+
+    advance_fn advance_impl(advance_first);
+    min_work_fn min_work_impl(min_work_first);
+
+    tick_kernel::advance_result
+    advance_first(int64_t* work, const int64_t* cores, uint64_t count, int64_t step)
+    {
+        tick_kernel::select(tick_kernel::automatic);
+        return advance_impl(work, cores, count, step);
+    }
+
+    int64_t
+    min_work_first(const int64_t* work, uint64_t count)
+    {
+        tick_kernel::select(tick_kernel::automatic);
+        return min_work_impl(work, count);
+    }
+}
+
+tick_kernel::kind
+tick_kernel::select(kind k)
+{
+#ifdef TICK_KERNEL_X86
+    __builtin_cpu_init();
+    if (k == automatic || k == avx2) {
+        if (__builtin_cpu_supports("avx2")) {
+            advance_impl = advance_avx2;
+            min_work_impl = min_work_avx2;
+            return avx2;
+        }
+        k = sse42;
+    }
+    if (k == sse42 && __builtin_cpu_supports("sse4.2")) {
+        advance_impl = advance_sse42;
+        min_work_impl = min_work_sse42;
+        return sse42;
+    }
+#endif
+    advance_impl = advance_scalar;
+    min_work_impl = min_work_scalar;
+    return scalar;
+}
+
+bool
+tick_kernel::parse_kind(const std::string& name, kind* k)
+{
+    for (int ix(0); ix < kind_count; ++ix) {
+        if (name == kind_str[ix]) {
+            *k = static_cast<kind>(ix);
+            return true;
+        }
+    }
+    return false;
+}
+
+tick_kernel::advance_result
+tick_kernel::advance(int64_t* work, const int64_t* cores, uint64_t count, int64_t step)
+{
+    return advance_impl(work, cores, count, step);
+}
+
+int64_t
+tick_kernel::min_work(const int64_t* work, uint64_t count)
+{
+    return min_work_impl(work, count);
+}
@@ -0,0 +1,88 @@
+
+#ifndef _tick_kernel_h_
+#define _tick_kernel_h_
+
+#include <stdint.h>
+#include <string>
+
+/*
+ * tick_kernel
+ *
+ * Bulk arithmetic over the running tasks of a compute node.  The node keeps
+ * each running task's remaining work and core count in contiguous arrays,
+ * and every task on the node advances by the same amount of work in a
+ * tick, so one pass can update all of them.
+ *
+ * The pass is implemented with AVX2, SSE4.2 and plain C++.  The fastest
+ * kernel the CPU supports is chosen at run time unless one is selected.
+ * All kernels give identical results.
+ */
+namespace tick_kernel {
+    /*
+     * @struct _advance_result
+     *
+     * Totals of one advance() pass.
+     */
+    struct _advance_result {
+        uint64_t completed;         // entries that reached zero work
+        int64_t cores_used;         // cores of all entries
+        int64_t cores_released;     // cores of the completed entries
+    };
+    typedef _advance_result advance_result;
+
+    enum _kind {
+        automatic,
+        scalar,
+        sse42,
+        avx2,
+        kind_count
+    };
+    typedef _kind kind;
+    extern const char* kind_str[];
+
+    /*
+     * select
+     *
+     * Selects the kernel used by advance() and min_work().  A kernel the
+     * CPU doesn't support falls back to the next best one.
+     *
+     * @param[in]  k  kernel, automatic for the fastest supported
+     *
+     * @return kernel in use
+     */
+    kind select(kind k);
+
+    /*
+     * parse_kind
+     *
+     * @param[in]  name  kernel name (see kind_str)
+     * @param[out] k     kernel matching the name
+     *
+     * @return true if the name is a known kernel
+     */
+    bool parse_kind(const std::string& name, kind* k);
+
+    /*
+     * advance
+     *
+     * Subtracts step from each work entry, stopping at zero.
+     *
+     * @param[in,out]  work   remaining work of each entry, non-negative
+     * @param[in]      cores  cores of each entry
+     * @param[in]      count  number of entries
+     * @param[in]      step   work done by every entry
+     *
+     * @return totals of the pass
+     */
+    advance_result advance(int64_t* work, const int64_t* cores, uint64_t count,
+            int64_t step);
+
+    /*
+     * min_work
+     *
+     * @return smallest work entry, INT64_MAX if count is 0
+     */
+    int64_t min_work(const int64_t* work, uint64_t count);
+}
+
+#endif // _tick_kernel_h_
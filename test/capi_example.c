@@ -0,0 +1,138 @@
+/*
+ * Plans a small task graph through the planner's C interface.  Build and
+ * run it from src/ with "make test_capi"; it exits with 1 if a status,
+ * makespan or slot isn't the expected one.
+ */
+#include "planner_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const planner_node nodes[] = {
+    { "big", 4, 1.0 },
+    { "small", 2, 0 }
+};
+
+static const uint64_t after_load[] = { 0 };
+static const uint64_t after_both[] = { 1, 2 };
+
+static const planner_task tasks[] = {
+    /* cores, execution time, release, deadline, priority, deps */
+    { 4, 100, 0, 0, 0, NULL, 0 },           /* load */
+    { 2, 50, 0, 0, 0, after_load, 1 },      /* left */
+    { 2, 80, 0, 0, 0, after_load, 1 },      /* right */
+    { 4, 30, 0, 0, 0, after_both, 2 }       /* merge */
+};
+
+/* the plan of tasks, in start order */
+static const planner_slot expected[] = {
+    /* task, node, start, finish */
+    { 0, 0, 0, 100 },
+    { 2, 1, 100, 180 },
+    { 1, 1, 180, 230 },
+    { 3, 0, 230, 260 }
+};
+
+/* a task alone, so the task graph has no edges */
+static const planner_task single[] = {
+    { 2, 40, 0, 0, 0, NULL, 0 }
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static int failures = 0;
+
+static void
+check(int ok, const char* what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/* plan the graph, with a dependency replaced if missing is set */
+static planner_ctx*
+plan(const planner_task* graph, unsigned count, int missing, planner_status* rc,
+        uint64_t* makespan)
+{
+    planner_ctx* ctx = planner_create();
+    planner_task broken[COUNT(tasks)];
+    const uint64_t nowhere[] = { 7 };
+    uint64_t failed = 0;
+    unsigned ix;
+
+    for (ix = 0; ix < count; ++ix) {
+        broken[ix] = graph[ix];
+    }
+    if (missing) {
+        broken[2].deps = nowhere;
+    }
+    planner_add_nodes(ctx, nodes, COUNT(nodes));
+    planner_add_tasks(ctx, broken, count);
+    *makespan = 0;
+    *rc = planner_schedule(ctx, makespan);
+    if (*rc != PLANNER_OK) {
+        planner_failed_task(ctx, &failed);
+        printf("status: %s (task %lu)\n", planner_status_str(*rc), (unsigned long)failed);
+        return ctx;
+    }
+    printf("makespan: %lu\n", (unsigned long)*makespan);
+    return ctx;
+}
+
+int
+main(void)
+{
+    planner_ctx* first;
+    planner_ctx* second;
+    planner_slot* slots;
+    planner_status rc;
+    uint64_t makespan;
+    uint64_t failed = 0;
+    uint64_t count;
+    uint64_t ix;
+
+    first = plan(tasks, COUNT(tasks), 0, &rc, &makespan);
+    check(rc == PLANNER_OK, "graph status");
+    check(makespan == 260, "graph makespan");
+
+    /* ask for the size, then read the plan */
+    check(planner_get_schedule(first, NULL, 0, &count) == PLANNER_BUFFER_TOO_SMALL,
+            "schedule size status");
+    check(count == COUNT(expected), "schedule size");
+    slots = malloc(count * sizeof(*slots));
+    check(planner_get_schedule(first, slots, count, &count) == PLANNER_OK, "schedule status");
+    for (ix = 0; ix < count; ++ix) {
+        printf("task %lu: %s %lu-%lu\n", (unsigned long)slots[ix].task,
+                nodes[slots[ix].node].name, (unsigned long)slots[ix].start,
+                (unsigned long)slots[ix].finish);
+        check(ix < COUNT(expected) &&
+                slots[ix].task == expected[ix].task &&
+                slots[ix].node == expected[ix].node &&
+                slots[ix].start == expected[ix].start &&
+                slots[ix].finish == expected[ix].finish, "schedule slot");
+    }
+    free(slots);
+
+    /* the same graph in other contexts alongside the first */
+    second = plan(tasks, COUNT(tasks), 1, &rc, &makespan);
+    check(rc == PLANNER_MISSING_DEPENDENCY, "missing dependency status");
+    check(planner_failed_task(second, &failed) == PLANNER_OK && failed == 2,
+            "missing dependency task");
+    check(planner_schedule(second, &makespan) == PLANNER_MISSING_DEPENDENCY,
+            "missing dependency status again");
+    planner_destroy(second);
+    second = plan(tasks, COUNT(tasks), 0, &rc, &makespan);
+    check(rc == PLANNER_OK && makespan == 260, "second graph");
+    planner_destroy(second);
+
+    second = plan(single, COUNT(single), 0, &rc, &makespan);
+    check(rc == PLANNER_OK, "single task status");
+    check(makespan == 40, "single task makespan");
+    planner_destroy(second);
+    planner_destroy(first);
+
+    check(planner_failed_task(NULL, &failed) == PLANNER_INVALID_ARGUMENT, "NULL context");
+    check(planner_status_str((planner_status)99)[0] == 'U', "unknown status string");
+    return failures ? 1 : 0;
+}
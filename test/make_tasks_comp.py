@@ -60,6 +60,15 @@ parser.add_argument('--max-time', type=int, dest="max_time", default=1000,
                     help="maximum task time")
 parser.add_argument('--prob-deps', type=int, dest="prob_deps", default=80,
                     help="create dependencies for each task with this probability (0-100)")
+parser.add_argument('--shape', dest="shape", default="random",
+                    choices=["random", "chain", "wide", "forkjoin", "layered"],
+                    help="dependency graph shape")
+parser.add_argument('--min-task-cores', type=int, dest="min_task_cores", default=None,
+                    help="minimum task cores (default: --min-cores)")
+parser.add_argument('--max-task-cores', type=int, dest="max_task_cores", default=None,
+                    help="maximum task cores (default: --max-cores)")
+parser.add_argument('--seed', type=int, dest="seed", default=None,
+                    help="random seed; the same seed gives the same files")
 
 # compute options
 parser.add_argument('--num-compute', type = int, dest = "num_compute", default = 6,
@@ -72,19 +81,57 @@ parser.add_argument('--max-cores', type=int, dest="max_cores", default=8,
                     help="maximum task cores")
 
 args = parser.parse_args()
+if args.min_task_cores is None:
+    args.min_task_cores = args.min_cores
+if args.max_task_cores is None:
+    args.max_task_cores = args.max_cores
+
+# random.randint() draws differently between python versions; this only
+# uses random(), so a seed gives the same files on any version
+rng = random.Random(args.seed)
+def randint(lo, hi):
+    return lo + int(rng.random() * (hi - lo + 1))
 
 task_file=open(args.task_file, 'w')
 compute_file=open(args.compute_file, 'w')
 
+def parents(i, tasks):
+    """Names of the tasks that task i depends on, by graph shape."""
+    if args.shape == "chain":
+        return [tasks[i-1].name] if i else []
+    if args.shape == "wide":
+        return []
+    if args.shape == "forkjoin":
+        # a fork task, up to 8 branches waiting on it, a join waiting on them
+        width = 8
+        pos = i % (width + 2)
+        base = i - pos
+        if pos == 0:
+            return [tasks[base-1].name] if base else []
+        if pos <= width:
+            return [tasks[base].name]
+        return [tasks[j].name for j in range(base + 1, i)]
+    if args.shape == "layered":
+        # 10 layers, each task waiting on 1-3 tasks of the layer before
+        per_layer = max(1, args.num_tasks // 10)
+        layer = i // per_layer
+        if layer == 0:
+            return []
+        prev = range((layer - 1) * per_layer, layer * per_layer)
+        return [tasks[prev[randint(0, len(prev) - 1)]].name
+                for _ in range(randint(1, 3))]
+    dep_names = []
+    while randint(0, 100) < args.prob_deps and len(tasks) > 1:
+        dep_names.append(tasks[randint(0, len(tasks)-1)].name)
+    return dep_names
+
 tasks = []
 for i in range(args.num_tasks):
-    dep_names = []
-    while random.randint(0, 100) < args.prob_deps and len(tasks) > 1:
-        dep_names.append(tasks[random.randint(0, len(tasks)-1)].name)
+    dep_names = parents(i, tasks)
 
     t = task("task_%03d" % i,
-        random.randint(args.min_time, args.max_time),
-        random.randint(args.min_cores, args.max_cores),
+        randint(args.min_time, args.max_time),
+        randint(args.min_task_cores, args.max_task_cores),
         dep_names)
 
     tasks.append(t)
@@ -94,7 +141,7 @@ compute = []
 compute.append(comp("compute_%03d" % 1, args.max_cores))
 compute.append
 for i in range(2, args.num_compute):
-    c = comp("compute_%03d" % i, random.randint(args.min_cores, args.max_cores))
+    c = comp("compute_%03d" % i, randint(args.min_cores, args.max_cores))
     compute.append(c)
 
 task_file.write("\n".join(str(x) for x in tasks))
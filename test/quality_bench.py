@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Plan quality benchmark.
+
+Generates a fixed corpus of seeded task graphs and clusters, plans each one
+in every scheduling mode and records the makespan (planner ticks), idle
+core ticks, core utilization, the gap to a lower bound on the makespan and
+the planning time, the fastest of --repeat runs, in a results file.  The
+modes are the ones the planner's --help lists, plus node-class planning.
+The lower bound is the longer of the critical path and the total work
+spread over all cores.
+
+With --baseline, each result is compared with the stored one, and the run
+fails if a plan got longer or planning got slower beyond the thresholds.
+--update writes the results as the new baseline instead.
+
+For example, from src/:
+
+    ../test/quality_bench.py --planner ./planner --baseline ../test/quality_baseline.txt
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+GENERATOR = os.path.join(HERE, "make_tasks_comp.py")
+
+# name, generator arguments
+CORPUS = [
+    ("small_random", ["--num-tasks", "200", "--num-compute", "8", "--seed", "1"]),
+    ("medium_random", ["--num-tasks", "1500", "--num-compute", "24", "--seed", "2"]),
+    ("large_layered", ["--num-tasks", "4000", "--num-compute", "48", "--shape", "layered",
+                       "--seed", "3"]),
+    ("forkjoin", ["--num-tasks", "1000", "--num-compute", "12", "--shape", "forkjoin",
+                  "--seed", "4"]),
+    ("wide", ["--num-tasks", "2000", "--num-compute", "16", "--shape", "wide", "--seed", "5"]),
+    # adversarial: no parallelism at all
+    ("chain", ["--num-tasks", "300", "--num-compute", "4", "--shape", "chain", "--seed", "6"]),
+    # adversarial: tasks nearly as big as the biggest nodes, most nodes too small
+    ("big_tasks", ["--num-tasks", "800", "--num-compute", "16", "--min-task-cores", "6",
+                   "--prob-deps", "50", "--seed", "7"]),
+    # adversarial: everything on one node
+    ("one_node", ["--num-tasks", "300", "--num-compute", "2", "--seed", "8"]),
+]
+
+# name, planner arguments; run as well as every mode the planner lists
+EXTRA_MODES = [
+    ("node_classes", ["--mode", "greedy", "--node-classes"]),
+]
+
+COLUMNS = ["case", "mode", "ticks", "idle", "utilization", "gap", "seconds"]
+
+
+def generate(workdir, name, gen_args):
+    tasks = os.path.join(workdir, name + "_tasks.yaml")
+    comp = os.path.join(workdir, name + "_compute.yaml")
+    subprocess.check_call([sys.executable, GENERATOR, "--task-file", tasks,
+                           "--compute-file", comp] + gen_args)
+    return tasks, comp
+
+
+def planner_modes(planner):
+    """(name, planner arguments) for each mode in the planner's --help."""
+    # --help exits with 1, so only the output is checked
+    proc = subprocess.Popen([planner, "--help"], stdout=subprocess.PIPE,
+                            universal_newlines=True)
+    out = proc.communicate()[0]
+    match = re.search(r"--mode arg.*?scheduling mode \((.*?)\)", out, re.DOTALL)
+    if not match:
+        raise ValueError("no mode list in planner --help")
+    names = [name.strip() for name in match.group(1).split(",")]
+    return [(name, ["--mode", name]) for name in names] + EXTRA_MODES
+
+
+def value(pattern, text):
+    match = re.search(pattern, text, re.MULTILINE)
+    if not match:
+        raise ValueError("no match for %r in planner output" % pattern)
+    return int(match.group(1))
+
+
+def run(planner, tasks, comp, mode_args, repeat):
+    # the plan is the same every time; the fastest run is the planning time
+    seconds = None
+    for _ in range(repeat):
+        start = time.time()
+        proc = subprocess.Popen([planner, "--tasks", tasks, "--compute", comp, "--analyze",
+                                 "--threads", "1"] + mode_args,
+                                stdout=subprocess.PIPE, universal_newlines=True)
+        out = proc.communicate()[0]
+        elapsed = time.time() - start
+        if proc.returncode:
+            raise RuntimeError("planner failed on %s %s" % (tasks, " ".join(mode_args)))
+        seconds = elapsed if seconds is None else min(seconds, elapsed)
+
+    ticks = value(r"^Planner ticks: (\d+)", out)
+    busy = value(r"^    busy ticks: (\d+)", out)
+    idle = value(r"^    idle ticks: (\d+)", out)
+    cores = value(r"^Total core count: (\d+)", out)
+    critical = value(r"^Critical path: (\d+) ticks", out)
+    bound = max(critical, (busy + cores - 1) // cores)
+    return {
+        "ticks": ticks,
+        "idle": idle,
+        "utilization": float(busy) / (busy + idle) if busy + idle else 0.0,
+        "gap": float(ticks) / bound - 1.0 if bound else 0.0,
+        "seconds": seconds,
+    }
+
+
+def write_results(path, results):
+    with open(path, "w") as out:
+        out.write("\t".join(COLUMNS) + "\n")
+        for row in results:
+            out.write("%s\t%s\t%d\t%d\t%.4f\t%.4f\t%.3f\n" % (
+                row["case"], row["mode"], row["ticks"], row["idle"],
+                row["utilization"], row["gap"], row["seconds"]))
+
+
+def read_results(path):
+    rows = {}
+    with open(path) as results:
+        header = results.readline().rstrip("\n").split("\t")
+        for line in results:
+            fields = dict(zip(header, line.rstrip("\n").split("\t")))
+            rows[(fields["case"], fields["mode"])] = {
+                "ticks": int(fields["ticks"]),
+                "seconds": float(fields["seconds"]),
+            }
+    return rows
+
+
+def compare(results, baseline, args):
+    failures = []
+    for row in results:
+        base = baseline.get((row["case"], row["mode"]))
+        if base is None:
+            continue
+        if row["ticks"] > base["ticks"] * (1.0 + args.plan_threshold):
+            failures.append("%s %s: makespan %d, baseline %d" % (
+                row["case"], row["mode"], row["ticks"], base["ticks"]))
+        if row["seconds"] > base["seconds"] * (1.0 + args.time_threshold) + args.time_slack:
+            failures.append("%s %s: %.3f seconds, baseline %.3f" % (
+                row["case"], row["mode"], row["seconds"], base["seconds"]))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="plan quality benchmark")
+    parser.add_argument("--planner", default="./planner", help="planner binary")
+    parser.add_argument("--workdir", default="quality", help="directory for the corpus")
+    parser.add_argument("--results", default="quality_results.txt", help="results file")
+    parser.add_argument("--baseline", help="baseline results to compare with")
+    parser.add_argument("--update", action="store_true",
+                        help="write the results to --baseline instead of comparing")
+    parser.add_argument("--plan-threshold", type=float, default=0.01,
+                        help="allowed makespan increase, as a fraction (default: 0.01)")
+    parser.add_argument("--time-threshold", type=float, default=1.0,
+                        help="allowed planning time increase, as a fraction (default: 1.0)")
+    parser.add_argument("--time-slack", type=float, default=0.25,
+                        help="planning time increase always allowed, in seconds (default: 0.25)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per case and mode, the fastest is kept (default: 3)")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.workdir):
+        os.makedirs(args.workdir)
+    modes = planner_modes(args.planner)
+    results = []
+    for name, gen_args in CORPUS:
+        tasks, comp = generate(args.workdir, name, gen_args)
+        for mode, mode_args in modes:
+            row = run(args.planner, tasks, comp, mode_args, max(1, args.repeat))
+            row["case"] = name
+            row["mode"] = mode
+            results.append(row)
+            print("%-14s %-22s ticks %8d  utilization %6.2f%%  gap %6.2f%%  %7.3fs" % (
+                name, mode, row["ticks"], 100 * row["utilization"], 100 * row["gap"],
+                row["seconds"]))
+    write_results(args.results, results)
+
+    if args.baseline and args.update:
+        write_results(args.baseline, results)
+    elif args.baseline:
+        failures = compare(results, read_results(args.baseline), args)
+        for failure in failures:
+            print("WORSE: " + failure)
+        if failures:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())